@@ -0,0 +1,137 @@
+/**
+ * @file ac_energy.c
+ * @brief Integrador de energía (Wh/kWh) con checkpoints espaciados en flash
+ */
+
+#include <string.h>
+#include "freertos/FreeRTOS.h"
+#include "esp_log.h"
+#include "esp_system.h"
+#include "ac_energy.h"
+#include "ac_storage.h"
+
+static const char *TAG = "AC_ENERGY";
+
+#define ENERGY_NVS_NS        "energy"
+#define ENERGY_NVS_KEY       "counters"
+#define ENERGY_VERSION       1
+#define ENERGY_CHECKPOINT_S  900      // 15 min entre escrituras a flash
+#define ENERGY_MAX_GAP_US    5000000  // Huecos mayores no se integran (tarea trabada)
+#define MJ_PER_KWH           3600000000.0f
+
+// Contadores en mJ (uint64: siglos de margen a potencia de un aire)
+typedef struct {
+    uint32_t version;
+    uint32_t period_resets;
+    uint64_t total_on_mj;
+    uint64_t total_off_mj;
+    uint64_t period_on_mj;
+    uint64_t period_off_mj;
+} energy_record_t;
+
+static portMUX_TYPE s_lock = portMUX_INITIALIZER_UNLOCKED;
+static energy_record_t s_rec;
+static uint32_t s_residual_uj = 0;    // Fracción de mJ aún no volcada
+static int64_t s_last_us = -1;
+static int64_t s_last_checkpoint_us = 0;
+static bool s_dirty = false;
+
+static void energy_save(void) {
+    energy_record_t snap;
+
+    portENTER_CRITICAL(&s_lock);
+    snap = s_rec;
+    s_dirty = false;
+    portEXIT_CRITICAL(&s_lock);
+
+    if (!storage_data_save(ENERGY_NVS_NS, ENERGY_NVS_KEY, &snap, sizeof(snap))) {
+        ESP_LOGW(TAG, "No se pudo guardar el checkpoint de energía");
+        portENTER_CRITICAL(&s_lock);
+        s_dirty = true;
+        portEXIT_CRITICAL(&s_lock);
+    }
+}
+
+static void energy_shutdown_handler(void) {
+    ac_energy_flush();
+}
+
+void ac_energy_init(void) {
+    energy_record_t rec;
+
+    if (storage_data_load(ENERGY_NVS_NS, ENERGY_NVS_KEY, &rec, sizeof(rec)) && rec.version == ENERGY_VERSION) {
+        s_rec = rec;
+        ESP_LOGI(TAG, "Energía restaurada: %.3f kWh totales",
+                 (float)(rec.total_on_mj + rec.total_off_mj) / MJ_PER_KWH);
+    } else {
+        memset(&s_rec, 0, sizeof(s_rec));
+        s_rec.version = ENERGY_VERSION;
+        ESP_LOGI(TAG, "Sin checkpoint de energía, contadores en cero");
+    }
+    esp_register_shutdown_handler(energy_shutdown_handler);
+}
+
+void ac_energy_add(float watts, bool comp_on, int64_t now_us) {
+    bool checkpoint = false;
+
+    portENTER_CRITICAL(&s_lock);
+    if (s_last_us >= 0 && watts > 0.0f) {
+        int64_t dt_us = now_us - s_last_us;
+        if (dt_us > 0 && dt_us <= ENERGY_MAX_GAP_US) {
+            // W * us = uJ
+            uint64_t uj = (uint64_t)(watts * (float)dt_us) + s_residual_uj;
+            uint64_t mj = uj / 1000;
+            s_residual_uj = (uint32_t)(uj % 1000);
+            if (comp_on) {
+                s_rec.total_on_mj += mj;
+                s_rec.period_on_mj += mj;
+            } else {
+                s_rec.total_off_mj += mj;
+                s_rec.period_off_mj += mj;
+            }
+            if (mj) s_dirty = true;
+        }
+    }
+    s_last_us = now_us;
+    if (s_dirty && (now_us - s_last_checkpoint_us) >= (int64_t)ENERGY_CHECKPOINT_S * 1000000) {
+        s_last_checkpoint_us = now_us;
+        checkpoint = true;
+    }
+    portEXIT_CRITICAL(&s_lock);
+
+    // La escritura a flash se hace fuera del spinlock
+    if (checkpoint) energy_save();
+}
+
+void ac_energy_get(ac_energy_t *out) {
+    portENTER_CRITICAL(&s_lock);
+    energy_record_t r = s_rec;
+    portEXIT_CRITICAL(&s_lock);
+
+    out->total_on_kwh = (float)r.total_on_mj / MJ_PER_KWH;
+    out->total_off_kwh = (float)r.total_off_mj / MJ_PER_KWH;
+    out->total_kwh = (float)(r.total_on_mj + r.total_off_mj) / MJ_PER_KWH;
+    out->period_on_kwh = (float)r.period_on_mj / MJ_PER_KWH;
+    out->period_off_kwh = (float)r.period_off_mj / MJ_PER_KWH;
+    out->period_kwh = (float)(r.period_on_mj + r.period_off_mj) / MJ_PER_KWH;
+}
+
+void ac_energy_reset_period(void) {
+    portENTER_CRITICAL(&s_lock);
+    s_rec.period_on_mj = 0;
+    s_rec.period_off_mj = 0;
+    s_rec.period_resets++;
+    s_dirty = true;
+    portEXIT_CRITICAL(&s_lock);
+
+    ESP_LOGI(TAG, "Período de energía reiniciado");
+    energy_save();
+}
+
+void ac_energy_flush(void) {
+    portENTER_CRITICAL(&s_lock);
+    bool dirty = s_dirty;
+    portEXIT_CRITICAL(&s_lock);
+
+    if (dirty) energy_save();
+}
@@ -0,0 +1,51 @@
+#pragma once
+#include <stdint.h>
+#include <stdbool.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// Energía acumulada en kWh, separada por estado del compresor
+typedef struct {
+    float total_kwh;        // De por vida (no se resetea)
+    float total_on_kwh;     // De por vida con compresor encendido
+    float total_off_kwh;    // De por vida con compresor apagado
+    float period_kwh;       // Período actual (reseteable)
+    float period_on_kwh;
+    float period_off_kwh;
+} ac_energy_t;
+
+/**
+ * @brief Carga el último checkpoint desde la partición de datos y registra
+ *        el guardado al apagar (esp_restart).
+ */
+void ac_energy_init(void);
+
+/**
+ * @brief Integra una lectura de potencia activa.
+ * @param watts Potencia activa (W). Valores negativos se ignoran.
+ * @param comp_on true si el compresor estaba encendido
+ * @param now_us Marca de tiempo (esp_timer_get_time)
+ * Guarda en flash cada ENERGY_CHECKPOINT_S, no en cada muestra.
+ */
+void ac_energy_add(float watts, bool comp_on, int64_t now_us);
+
+/**
+ * @brief Copia los contadores actuales en kWh.
+ */
+void ac_energy_get(ac_energy_t *out);
+
+/**
+ * @brief Pone a cero los contadores del período y guarda inmediatamente.
+ */
+void ac_energy_reset_period(void);
+
+/**
+ * @brief Fuerza un checkpoint en flash (ej. antes de reiniciar).
+ */
+void ac_energy_flush(void);
+
+#ifdef __cplusplus
+}
+#endif
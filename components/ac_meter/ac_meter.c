@@ -1,107 +1,248 @@
-#include <math.h>
 #include <string.h>
+#include <math.h>
 #include "freertos/FreeRTOS.h"
 #include "freertos/task.h"
 #include "esp_log.h"
-#include "esp_timer.h" 
 #include "ac_meter.h"
-#include "esp_adc/adc_oneshot.h"
+#include "ac_meter_calc.h"
+#include "ac_meter_adc.h"
+#include "ac_meter_inrush.h"
 
 static const char *TAG = "AC_METER";
 
-// Configuración ADC
-#define ADC_ATTEN ADC_ATTEN_DB_12 
-#define ADC_WIDTH ADC_BITWIDTH_DEFAULT
+// Ciclo de trabajo adaptativo: sin cargas conmutadas y con la corriente
+// estable, el ADC se detiene y solo se despierta en ráfagas cortas.
+// Cualquier cambio de relés o salto de corriente vuelve a tasa completa.
+#define AC_METER_IDLE_AFTER_WINDOWS 100    // ~2 s estable antes de reducir
+#define AC_METER_IDLE_PERIOD_MS     2000   // Pausa entre ráfagas
+#define AC_METER_IDLE_BURST_WINDOWS 5      // Ventanas por ráfaga (~200 ms)
+#define AC_METER_LOAD_STEP_A        0.2f   // Salto de corriente que despierta
+
+// Reanudación de la fuente tras el reposo
+#define AC_METER_START_RETRIES      3
+#define AC_METER_START_RETRY_MS     50
+
+#define AC_METER_BLOCK_PAIRS    AC_METER_ADC_FRAME_PAIRS
+#define AC_METER_TASK_STACK     3072
+#define AC_METER_TASK_PRIO      4
+#define AC_METER_READ_TIMEOUT_MS 1000
+
+static ac_meter_source_t s_src;
+static ac_meter_calc_t s_calc;
+static ac_meter_inrush_cap_t s_inrush;
+static volatile bool s_inrush_req = false;
+static TaskHandle_t s_task = NULL;
+
+// Estado del ciclo de trabajo
+static volatile bool s_loads_on = true;   // Hasta que set_relays diga lo contrario
+static volatile bool s_wake_req = false;
+static bool s_src_running = false;
+static volatile bool s_src_failed = false; // La fuente no arranca: lecturas congeladas
+static uint32_t s_steady_windows = 0;
+static float s_ref_i = 0.0f;
+
+// Última lectura publicada (protegida por spinlock: se copia en microsegundos)
+static portMUX_TYPE s_result_lock = portMUX_INITIALIZER_UNLOCKED;
+static ac_meter_reading_t s_last = {0};
+static ac_meter_harmonics_t s_last_harm = {0};
+static ac_meter_inrush_t s_last_inrush = {0};
+static bool s_inrush_ready = false;
+
+static void capture_inrush(const uint16_t *pairs, size_t n_pairs) {
+    if (s_inrush_req) {
+        s_inrush_req = false;
+        ac_meter_inrush_trigger(&s_inrush, s_calc.offset_i);
+    }
+    if (ac_meter_inrush_feed(&s_inrush, pairs, n_pairs)) {
+        ac_meter_inrush_t ev;
+        ac_meter_inrush_reduce(&s_inrush, s_calc.samples_per_cycle, &ev);
+        portENTER_CRITICAL(&s_result_lock);
+        s_last_inrush = ev;
+        s_inrush_ready = true;
+        portEXIT_CRITICAL(&s_result_lock);
+    }
+}
+
+// Cuenta ventanas con corriente estable; un salto pide volver a tasa completa
+static void track_load(const ac_meter_reading_t *r) {
+    if (fabsf(r->i - s_ref_i) > AC_METER_LOAD_STEP_A) {
+        s_ref_i = r->i;
+        s_steady_windows = 0;
+        s_wake_req = true;
+    } else if (s_steady_windows < AC_METER_IDLE_AFTER_WINDOWS) {
+        s_steady_windows++;
+    }
+}
 
-// CALIBRACIÓN (Ajustar con Multímetro)
-// Si mide de más, bajar este número. Si mide de menos, subirlo.
-#define CAL_V 0.773
-#define CAL_I 0.024
+static void on_window(const ac_meter_reading_t *r, void *ctx) {
+    track_load(r);
+    portENTER_CRITICAL(&s_result_lock);
+    s_last = *r;
+    if (r->harm.valid) s_last_harm = r->harm;
+    portEXIT_CRITICAL(&s_result_lock);
+}
 
-static adc_oneshot_unit_handle_t adc1_handle;
-static adc_channel_t chan_v;
-static adc_channel_t chan_i;
+// Devuelve la cantidad de ventanas cerradas en el bloque
+static uint32_t process_block(const uint16_t *pairs, size_t n_pairs) {
+    capture_inrush(pairs, n_pairs);
+    return ac_meter_calc_block(&s_calc, pairs, n_pairs, on_window, NULL);
+}
 
-void ac_meter_init(int pin_v, int pin_i) {
-    adc_unit_t unit;
-    adc_channel_t chan;
-
-    // 1. Iniciar Unidad ADC1
-    adc_oneshot_unit_init_cfg_t init_config1 = {
-        .unit_id = ADC_UNIT_1,
-    };
-    ESP_ERROR_CHECK(adc_oneshot_new_unit(&init_config1, &adc1_handle));
-
-    // 2. Configurar Voltaje (GPIO 34)
-    ESP_ERROR_CHECK(adc_oneshot_io_to_channel(pin_v, &unit, &chan));
-    chan_v = chan;
-                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                            
-    // 3. Configurar Corriente (GPIO 35)
-    ESP_ERROR_CHECK(adc_oneshot_io_to_channel(pin_i, &unit, &chan));
-    chan_i = chan;
-
-    // 4. Configurar Canales
-    adc_oneshot_chan_cfg_t config = {
-        .bitwidth = ADC_WIDTH,
-        .atten = ADC_ATTEN,
-    };
-    ESP_ERROR_CHECK(adc_oneshot_config_channel(adc1_handle, chan_v, &config));
-    ESP_ERROR_CHECK(adc_oneshot_config_channel(adc1_handle, chan_i, &config));
-
-    ESP_LOGI(TAG, "ADC Iniciado. V:Ch%d I:Ch%d", chan_v, chan_i);
+static bool can_idle(void) {
+    return s_src.stop && !s_loads_on && !s_inrush.triggered &&
+           s_steady_windows >= AC_METER_IDLE_AFTER_WINDOWS;
 }
 
-void ac_meter_read_rms(float *v, float *i, float *w) {
-    int raw_v = 0;
-    int raw_i = 0;
-    double sum_sq_v = 0.0;
-    double sum_v = 0.0;
-    double sum_sq_i = 0.0;
-    double sum_i = 0.0;
-    int samples = 0;
-
-    int64_t start_time = esp_timer_get_time();
-    
-    // Muestreo de 200ms (10 ciclos de red)
-    while ((esp_timer_get_time() - start_time) < 200000) {
-        if (adc_oneshot_read(adc1_handle, chan_v, &raw_v) == ESP_OK &&
-            adc_oneshot_read(adc1_handle, chan_i, &raw_i) == ESP_OK) {
-            sum_v += raw_v;
-            sum_sq_v += (raw_v * raw_v);
-            
-            sum_i += raw_i;
-            sum_sq_i += (raw_i * raw_i);
-            samples++;
+// Arranca la fuente con algunos reintentos. Si no hay caso queda en error
+// (ac_meter_is_ok() = false) y el llamador reintenta más tarde.
+static bool source_start(void) {
+    for (int k = 0; k < AC_METER_START_RETRIES; k++) {
+        if (s_src.start(s_src.ctx) == 0) {
+            if (s_src_failed) ESP_LOGI(TAG, "✅ Fuente de muestras recuperada");
+            s_src_running = true;
+            s_src_failed = false;
+            return true;
+        }
+        vTaskDelay(pdMS_TO_TICKS(AC_METER_START_RETRY_MS));
+    }
+    if (!s_src_failed) ESP_LOGE(TAG, "❌ No se pudo reanudar la fuente de muestras");
+    s_src_failed = true;
+    return false;
+}
+
+// Detiene la fuente: lo que venga después no es continuo con lo anterior
+static void source_stop(void) {
+    s_src.stop(s_src.ctx);
+    s_src_running = false;
+    ac_meter_calc_resync(&s_calc);
+    ac_meter_inrush_gap(&s_inrush);
+}
+
+// Modo reposo: ADC detenido, una ráfaga de pocas ventanas cada
+// AC_METER_IDLE_PERIOD_MS. Sale ante un cambio de relés o un salto de carga,
+// siempre con la fuente andando. No limpia s_wake_req: lo hace el llamador
+// antes de evaluar can_idle(), así un pedido que llegue en el medio no se
+// pierde. s_loads_on se mira igual por si acaso.
+static void run_idle(uint16_t *pairs) {
+    ESP_LOGI(TAG, "💤 Sin carga estable: medición en ráfagas cada %d ms", AC_METER_IDLE_PERIOD_MS);
+
+    while (!s_wake_req && !s_loads_on) {
+        if (s_src_running) source_stop();
+        ulTaskNotifyTake(pdTRUE, pdMS_TO_TICKS(AC_METER_IDLE_PERIOD_MS));
+        if (!source_start()) continue;
+
+        uint32_t windows = 0;
+        while (windows < AC_METER_IDLE_BURST_WINDOWS && !s_wake_req && !s_loads_on) {
+            int n = s_src.read(s_src.ctx, pairs, AC_METER_BLOCK_PAIRS, AC_METER_READ_TIMEOUT_MS);
+            if (n <= 0) break;
+            windows += process_block(pairs, (size_t)n);
+        }
+    }
+
+    // El despertar pudo llegar con la fuente detenida (arranque fallido):
+    // no volver a tasa completa hasta que arranque
+    while (!s_src_running && !source_start()) {
+        ulTaskNotifyTake(pdTRUE, pdMS_TO_TICKS(AC_METER_IDLE_PERIOD_MS));
+    }
+
+    s_steady_windows = 0;
+    ESP_LOGI(TAG, "⚡ Medición a tasa completa");
+}
+
+// Consumidor: duerme en la fuente hasta que hay un bloque listo y acumula.
+// Nunca hace espera activa.
+static void ac_meter_task(void *pv) {
+    static uint16_t pairs[AC_METER_BLOCK_PAIRS * 2];
+
+    while (1) {
+        // Limpiar antes de evaluar: un set_loads posterior vuelve a levantarlo
+        s_wake_req = false;
+        if (can_idle()) run_idle(pairs);
+
+        int n = s_src.read(s_src.ctx, pairs, AC_METER_BLOCK_PAIRS, AC_METER_READ_TIMEOUT_MS);
+        if (n > 0) {
+            process_block(pairs, (size_t)n);
+        } else if (n == 0) {
+            ESP_LOGW(TAG, "Sin datos de la fuente en %d ms", AC_METER_READ_TIMEOUT_MS);
+        } else {
+            ESP_LOGE(TAG, "Fuente de muestras agotada o con error, medidor detenido");
+            s_src_failed = true;
+            if (s_src.stop) s_src.stop(s_src.ctx);
+            vTaskDelete(NULL);
         }
     }
+}
 
-    if (samples > 0) {
-        // Cálculo RMS eliminando Offset DC
-        double mean_v = sum_v / samples;
-        double variance_v = (sum_sq_v / samples) - (mean_v * mean_v);
-        if (variance_v < 0) variance_v = 0;
-        
-        float rms_adc = sqrt(variance_v);
-        
-        // Filtro de ruido base
-        if (rms_adc < 8.0) rms_adc = 0.0;
-
-        *v = rms_adc * CAL_V;
-
-        // Cálculo RMS Corriente
-        double mean_i = sum_i / samples;
-        double variance_i = (sum_sq_i / samples) - (mean_i * mean_i);
-        if (variance_i < 0) variance_i = 0;
-
-        float rms_i_adc = sqrt(variance_i);
-        // Filtro de ruido más agresivo para corriente (umbral mayor para eliminar ruido sin carga)
-        if (rms_i_adc < 35.0) rms_i_adc = 0.0;
-
-        *i = rms_i_adc * CAL_I;
-    } else {
-        *v = 0.0;
-        *i = 0.0;
+void ac_meter_start(const ac_meter_source_t *src) {
+    s_src = *src;
+    ac_meter_calc_init(&s_calc, s_src.pair_rate_hz, AC_METER_WINDOW_CYCLES,
+                       AC_METER_MAX_WINDOW_MS, AC_METER_PHASE_CAL_Q8,
+                       AC_METER_HARMONICS_EVERY);
+    ac_meter_inrush_init(&s_inrush, s_src.pair_rate_hz, AC_METER_INRUSH_DECIM,
+                         AC_METER_INRUSH_PRE_MS, AC_METER_INRUSH_POST_MS);
+
+    if (s_src.start(s_src.ctx) != 0) {
+        ESP_LOGE(TAG, "No se pudo arrancar la fuente de muestras");
+        s_src_failed = true;
+        return;
     }
+    s_src_running = true;
+    xTaskCreate(ac_meter_task, "AcMeter", AC_METER_TASK_STACK, NULL, AC_METER_TASK_PRIO, &s_task);
+}
+
+void ac_meter_init(int pin_v, int pin_i) {
+    ac_meter_source_t src;
+
+    ESP_ERROR_CHECK(ac_meter_adc_source_create(pin_v, pin_i, &src));
+    ac_meter_start(&src);
+}
+
+void ac_meter_read_rms(float *v, float *i, float *w) {
+    portENTER_CRITICAL(&s_result_lock);
+    ac_meter_reading_t r = s_last;
+    portEXIT_CRITICAL(&s_result_lock);
+
+    *v = r.v;
+    *i = r.i;
+    *w = r.w;
+}
 
-    *w = (*v) * (*i); 
+void ac_meter_get_reading(ac_meter_reading_t *out) {
+    portENTER_CRITICAL(&s_result_lock);
+    *out = s_last;
+    portEXIT_CRITICAL(&s_result_lock);
+}
+
+void ac_meter_get_harmonics(ac_meter_harmonics_t *out) {
+    portENTER_CRITICAL(&s_result_lock);
+    *out = s_last_harm;
+    portEXIT_CRITICAL(&s_result_lock);
+}
+
+void ac_meter_trigger_inrush(void) {
+    s_inrush_req = true;
+}
+
+void ac_meter_set_loads(bool loads_on) {
+    if (loads_on == s_loads_on) return;
+    s_loads_on = loads_on;
+    s_steady_windows = 0;
+    s_wake_req = true;
+    if (s_task) xTaskNotifyGive(s_task);
+}
+
+bool ac_meter_is_ok(void) {
+    return !s_src_failed;
+}
+
+bool ac_meter_get_inrush(ac_meter_inrush_t *out) {
+    bool ready;
+    portENTER_CRITICAL(&s_result_lock);
+    ready = s_inrush_ready;
+    if (ready) {
+        *out = s_last_inrush;
+        s_inrush_ready = false;
+    }
+    portEXIT_CRITICAL(&s_result_lock);
+    return ready;
 }
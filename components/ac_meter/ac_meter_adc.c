@@ -0,0 +1,135 @@
+#include "freertos/FreeRTOS.h"
+#include "esp_log.h"
+#include "esp_attr.h"
+#include "esp_adc/adc_continuous.h"
+#include "ac_meter_adc.h"
+#include "ac_meter_lut.h"
+
+static const char *TAG = "AC_METER_ADC";
+
+// Configuración ADC
+#define ADC_ATTEN ADC_ATTEN_DB_12
+#define ADC_WIDTH SOC_ADC_DIGI_MAX_BITWIDTH
+
+// Muestreo continuo por DMA: la frecuencia se reparte entre los dos canales
+// (20 kHz es el mínimo del ESP32 → 10 kHz por canal)
+#define ADC_SAMPLE_FREQ_HZ 20000
+#define ADC_PAIR_FREQ_HZ   (ADC_SAMPLE_FREQ_HZ / 2)
+
+// Cada frame DMA trae AC_METER_ADC_FRAME_PAIRS pares V/I intercalados.
+// El driver los guarda en un ring buffer de ADC_RING_FRAMES frames.
+#define ADC_FRAME_BYTES    (AC_METER_ADC_FRAME_PAIRS * 2 * SOC_ADC_DIGI_RESULT_BYTES)
+#define ADC_RING_FRAMES    8
+
+static adc_continuous_handle_t s_adc = NULL;
+static adc_channel_t chan_v;
+static adc_channel_t chan_i;
+static int s_pending_v = -1;      // Muestra V esperando su par I (puede cruzar frames)
+static volatile uint32_t s_ring_overflows = 0;
+static uint32_t s_reported_overflows = 0;
+
+static bool IRAM_ATTR on_pool_ovf(adc_continuous_handle_t handle, const adc_continuous_evt_data_t *edata, void *user_data) {
+    s_ring_overflows++;
+    return false;
+}
+
+// Convierte un frame DMA en pares [V, I] intercalados y linealizados.
+// Devuelve la cantidad de pares.
+static size_t decode_frame(const uint8_t *frame, uint32_t len, uint16_t *pairs) {
+    size_t n = 0;
+    for (uint32_t k = 0; k + SOC_ADC_DIGI_RESULT_BYTES <= len; k += SOC_ADC_DIGI_RESULT_BYTES) {
+        const adc_digi_output_data_t *p = (const adc_digi_output_data_t *)&frame[k];
+        // ESP32: formato TYPE1
+        adc_channel_t chan = (adc_channel_t)p->type1.channel;
+        int data = ac_meter_adc_lut[p->type1.data];
+
+        if (chan == chan_v) {
+            s_pending_v = data;
+        } else if (chan == chan_i && s_pending_v >= 0) {
+            pairs[2 * n] = (uint16_t)s_pending_v;
+            pairs[2 * n + 1] = (uint16_t)data;
+            n++;
+            s_pending_v = -1;
+        }
+    }
+    return n;
+}
+
+static int adc_source_start(void *ctx) {
+    // Descartar lo que quedó en el ring buffer de antes de detenerse
+    adc_continuous_flush_pool(s_adc);
+    return (adc_continuous_start(s_adc) == ESP_OK) ? 0 : -1;
+}
+
+static void adc_source_stop(void *ctx) {
+    adc_continuous_stop(s_adc);
+    s_pending_v = -1;
+}
+
+// Lectura bloqueante sobre el ring buffer del driver (sin espera activa)
+static int adc_source_read(void *ctx, uint16_t *pairs, size_t max_pairs, uint32_t timeout_ms) {
+    static uint8_t frame[ADC_FRAME_BYTES];
+    uint32_t want = (uint32_t)max_pairs * 2 * SOC_ADC_DIGI_RESULT_BYTES;
+    uint32_t len = 0;
+
+    if (want > sizeof(frame)) want = sizeof(frame);
+
+    if (s_ring_overflows != s_reported_overflows) {
+        s_reported_overflows = s_ring_overflows;
+        ESP_LOGW(TAG, "Ring buffer ADC desbordado (%lu)", (unsigned long)s_reported_overflows);
+    }
+
+    esp_err_t err = adc_continuous_read(s_adc, frame, want, &len, timeout_ms);
+    if (err == ESP_ERR_TIMEOUT) return 0;
+    if (err != ESP_OK) return -1;
+    return (int)decode_frame(frame, len, pairs);
+}
+
+esp_err_t ac_meter_adc_source_create(int pin_v, int pin_i, ac_meter_source_t *out) {
+    adc_unit_t unit;
+    adc_channel_t chan;
+
+    // 1. Canales de Voltaje (GPIO 34) y Corriente (GPIO 35)
+    ESP_ERROR_CHECK(adc_continuous_io_to_channel(pin_v, &unit, &chan));
+    chan_v = chan;
+    ESP_ERROR_CHECK(adc_continuous_io_to_channel(pin_i, &unit, &chan));
+    chan_i = chan;
+
+    // 2. Driver continuo con ring buffer interno
+    adc_continuous_handle_cfg_t handle_cfg = {
+        .max_store_buf_size = ADC_FRAME_BYTES * ADC_RING_FRAMES,
+        .conv_frame_size = ADC_FRAME_BYTES,
+    };
+    esp_err_t err = adc_continuous_new_handle(&handle_cfg, &s_adc);
+    if (err != ESP_OK) return err;
+
+    // 3. Patrón V, I intercalado
+    adc_digi_pattern_config_t pattern[2] = {
+        { .atten = ADC_ATTEN, .channel = chan_v, .unit = ADC_UNIT_1, .bit_width = ADC_WIDTH },
+        { .atten = ADC_ATTEN, .channel = chan_i, .unit = ADC_UNIT_1, .bit_width = ADC_WIDTH },
+    };
+    adc_continuous_config_t dig_cfg = {
+        .pattern_num = 2,
+        .adc_pattern = pattern,
+        .sample_freq_hz = ADC_SAMPLE_FREQ_HZ,
+        .conv_mode = ADC_CONV_SINGLE_UNIT_1,
+        .format = ADC_DIGI_OUTPUT_FORMAT_TYPE1,
+    };
+    err = adc_continuous_config(s_adc, &dig_cfg);
+    if (err != ESP_OK) return err;
+
+    adc_continuous_evt_cbs_t cbs = {
+        .on_pool_ovf = on_pool_ovf,
+    };
+    err = adc_continuous_register_event_callbacks(s_adc, &cbs, NULL);
+    if (err != ESP_OK) return err;
+
+    out->ctx = NULL;
+    out->pair_rate_hz = ADC_PAIR_FREQ_HZ;
+    out->start = adc_source_start;
+    out->read = adc_source_read;
+    out->stop = adc_source_stop;
+
+    ESP_LOGI(TAG, "ADC continuo listo. V:Ch%d I:Ch%d @ %d Hz/canal", chan_v, chan_i, ADC_PAIR_FREQ_HZ);
+    return ESP_OK;
+}
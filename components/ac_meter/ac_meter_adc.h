@@ -0,0 +1,12 @@
+#pragma once
+#include "esp_err.h"
+#include "ac_meter_source.h"
+
+// Pares por frame DMA (tamaño máximo de un read() de la fuente ADC)
+#define AC_METER_ADC_FRAME_PAIRS 128
+
+/**
+ * @brief Configura el ADC continuo (DMA) sobre los pines indicados y
+ *        completa la interfaz de fuente. No arranca la conversión.
+ */
+esp_err_t ac_meter_adc_source_create(int pin_v, int pin_i, ac_meter_source_t *out);
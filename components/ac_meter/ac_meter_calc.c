@@ -0,0 +1,329 @@
+#include <math.h>
+#include <string.h>
+#include "ac_meter_calc.h"
+
+// Filtros de ruido en cuentas ADC RMS, expresados en Q8
+#define NOISE_GATE_V_Q8 (8 << 8)
+#define NOISE_GATE_I_Q8 (35 << 8)   // Más agresivo: elimina ruido sin carga
+
+#ifndef M_PI
+#define M_PI 3.14159265358979323846
+#endif
+
+static const uint8_t HARM_ORDER[AC_METER_CALC_N_HARM] = { 1, 3, 5, 7 };
+
+// Histéresis del detector de cruce (cuentas ADC). Evita cruces falsos por ruido.
+#define ZC_HYSTERESIS 20
+#define ADC_MIDSCALE  2048
+
+// Acumuladores parciales de un tramo (caben en 32 bits)
+typedef struct {
+    int32_t sum_v;
+    uint32_t sum_sq_v;
+    int32_t sum_i;
+    uint32_t sum_sq_i;
+    int32_t sum_vi;
+    uint32_t n;
+} calc_chunk_t;
+
+static void calc_reset_window(ac_meter_calc_t *c) {
+    c->n = 0;
+    c->cycles = 0;
+    c->sum_v = 0;
+    c->sum_sq_v = 0;
+    c->sum_i = 0;
+    c->sum_sq_i = 0;
+    c->sum_vi = 0;
+}
+
+static inline void calc_flush_chunk(ac_meter_calc_t *c, calc_chunk_t *k) {
+    c->sum_v += k->sum_v;
+    c->sum_sq_v += k->sum_sq_v;
+    c->sum_i += k->sum_i;
+    c->sum_sq_i += k->sum_sq_i;
+    c->sum_vi += k->sum_vi;
+    c->n += k->n;
+    memset(k, 0, sizeof(*k));
+}
+
+// Raíz cuadrada entera (redondeo hacia abajo)
+static uint32_t isqrt64(uint64_t x) {
+    uint64_t res = 0;
+    uint64_t bit = 1ULL << 62;
+
+    while (bit > x) bit >>= 2;
+    while (bit != 0) {
+        if (x >= res + bit) {
+            x -= res + bit;
+            res = (res >> 1) + bit;
+        } else {
+            res >>= 1;
+        }
+        bit >>= 2;
+    }
+    return (uint32_t)res;
+}
+
+// RMS sin componente DC, en cuentas ADC Q8
+static uint32_t calc_rms_q8(int64_t sum, uint64_t sum_sq, uint32_t n) {
+    // n * var = sum_sq - sum^2 / n  (en cuentas^2)
+    int64_t n_var = (int64_t)sum_sq - (sum * sum) / (int64_t)n;
+    if (n_var < 0) n_var = 0;
+    uint64_t var_q16 = ((uint64_t)n_var << 16) / n;
+    return isqrt64(var_q16);
+}
+
+// Media redondeada de la ventana: offset + sum / n
+static int32_t calc_mean(int32_t offset, int64_t sum, uint32_t n) {
+    int64_t half = (sum >= 0) ? (int64_t)(n / 2) : -(int64_t)(n / 2);
+    return offset + (int32_t)((sum + half) / (int64_t)n);
+}
+
+// Muestra retrasada d_q8/256 posiciones, interpolando entre las dos vecinas
+static inline int32_t calc_delayed(const int16_t *hist, uint32_t pos, int32_t d_q8) {
+    uint32_t d = (uint32_t)d_q8 >> 8;
+    int32_t frac = d_q8 & 0xFF;
+    int32_t a = hist[(pos - d) & (AC_METER_CALC_DELAY_LEN - 1)];
+    int32_t b = hist[(pos - d - 1) & (AC_METER_CALC_DELAY_LEN - 1)];
+    return a + (((b - a) * frac) >> 8);
+}
+
+// Al abrir una ventana sincronizada: decidir si se analizan armónicos y
+// preparar los coeficientes con el período medido en la ventana anterior
+static void calc_start_harmonics(ac_meter_calc_t *c) {
+    c->harm_active = false;
+    if (c->harmonics_every == 0 || c->samples_per_cycle <= 0.0f) return;
+    if (c->harm_countdown > 1) {
+        c->harm_countdown--;
+        return;
+    }
+    c->harm_countdown = c->harmonics_every;
+    for (int h = 0; h < AC_METER_CALC_N_HARM; h++) {
+        float w = 2.0f * (float)M_PI * (float)HARM_ORDER[h] / c->samples_per_cycle;
+        c->harm_coeff[h] = 2.0f * cosf(w);
+        c->harm_s1[h] = 0.0f;
+        c->harm_s2[h] = 0.0f;
+    }
+    c->harm_active = true;
+}
+
+// Magnitudes de Goertzel → RMS por armónico y THD
+static void calc_close_harmonics(const ac_meter_calc_t *c, uint32_t samples, bool i_gated,
+                                 ac_meter_harmonics_t *harm) {
+    float rms[AC_METER_CALC_N_HARM];
+
+    memset(harm, 0, sizeof(*harm));
+    if (!c->harm_active || samples == 0) return;
+
+    harm->valid = true;
+    if (i_gated) return;  // Sin carga: todo en cero
+
+    for (int h = 0; h < AC_METER_CALC_N_HARM; h++) {
+        float s1 = c->harm_s1[h];
+        float s2 = c->harm_s2[h];
+        float power = s1 * s1 + s2 * s2 - c->harm_coeff[h] * s1 * s2;
+        if (power < 0.0f) power = 0.0f;
+        // |X| = A * N / 2  →  RMS = |X| * sqrt(2) / N
+        rms[h] = sqrtf(2.0f * power) / (float)samples * AC_METER_CAL_I;
+    }
+
+    harm->i1 = rms[0];
+    if (rms[0] > 0.0f) {
+        harm->h3 = 100.0f * rms[1] / rms[0];
+        harm->h5 = 100.0f * rms[2] / rms[0];
+        harm->h7 = 100.0f * rms[3] / rms[0];
+        harm->thd = sqrtf(harm->h3 * harm->h3 + harm->h5 * harm->h5 + harm->h7 * harm->h7);
+    }
+}
+
+void ac_meter_calc_init(ac_meter_calc_t *c, uint32_t pair_rate_hz,
+                        uint32_t window_cycles, uint32_t max_window_ms,
+                        int32_t phase_q8, uint32_t harmonics_every) {
+    memset(c, 0, sizeof(*c));
+    if (phase_q8 > AC_METER_CALC_MAX_PHASE_Q8) phase_q8 = AC_METER_CALC_MAX_PHASE_Q8;
+    if (phase_q8 < -AC_METER_CALC_MAX_PHASE_Q8) phase_q8 = -AC_METER_CALC_MAX_PHASE_Q8;
+    c->phase_q8 = phase_q8;
+    c->pair_rate_hz = pair_rate_hz;
+    c->window_cycles = window_cycles ? window_cycles : 1;
+    c->max_pairs = (pair_rate_hz * max_window_ms) / 1000;
+    if (c->max_pairs == 0) c->max_pairs = 1;
+    c->offset_v = ADC_MIDSCALE;
+    c->offset_i = ADC_MIDSCALE;
+    c->harmonics_every = harmonics_every;
+    c->harm_countdown = harmonics_every;
+}
+
+void ac_meter_calc_resync(ac_meter_calc_t *c) {
+    calc_reset_window(c);
+    memset(c->hist_v, 0, sizeof(c->hist_v));
+    memset(c->hist_i, 0, sizeof(c->hist_i));
+    c->synced = false;
+    c->armed = false;
+    c->harm_active = false;
+}
+
+static void calc_close_window(ac_meter_calc_t *c, ac_meter_reading_t *out, float end_frac) {
+    uint32_t samples = c->n;
+
+    out->samples = samples;
+    out->hz = 0.0f;
+    if (samples > 0) {
+        uint32_t rms_v_q8 = calc_rms_q8(c->sum_v, c->sum_sq_v, samples);
+        if (rms_v_q8 < NOISE_GATE_V_Q8) rms_v_q8 = 0;
+        out->v = (float)rms_v_q8 * (AC_METER_CAL_V / 256.0f);
+
+        uint32_t rms_i_q8 = calc_rms_q8(c->sum_i, c->sum_sq_i, samples);
+        if (rms_i_q8 < NOISE_GATE_I_Q8) rms_i_q8 = 0;
+        out->i = (float)rms_i_q8 * (AC_METER_CAL_I / 256.0f);
+
+        // Potencia activa: media de v·i menos el producto de las medias
+        if (rms_v_q8 && rms_i_q8) {
+            int64_t n_cov = c->sum_vi - (c->sum_v * c->sum_i) / (int64_t)samples;
+            out->w = ((float)n_cov / (float)samples) * (AC_METER_CAL_V * AC_METER_CAL_I);
+        } else {
+            out->w = 0.0f;
+        }
+
+        // Frecuencia de línea: ciclos enteros sobre la duración exacta entre cruces
+        if (c->synced && c->cycles > 0 && out->v > 0.0f) {
+            float span = (float)samples + end_frac - c->start_frac;
+            if (span > 0.0f) {
+                out->hz = (float)c->cycles * (float)c->pair_rate_hz / span;
+                c->samples_per_cycle = span / (float)c->cycles;
+            }
+        } else {
+            c->samples_per_cycle = 0.0f;
+        }
+
+        calc_close_harmonics(c, samples, rms_i_q8 == 0, &out->harm);
+
+        // Los offsets de esta ventana centran la siguiente (y el detector de cruces)
+        c->offset_v = calc_mean(c->offset_v, c->sum_v, samples);
+        c->offset_i = calc_mean(c->offset_i, c->sum_i, samples);
+    } else {
+        out->v = 0.0f;
+        out->i = 0.0f;
+        out->w = 0.0f;
+        memset(&out->harm, 0, sizeof(out->harm));
+    }
+    c->harm_active = false;
+
+    // Aparente, reactiva y factor de potencia a partir de lo anterior
+    out->va = out->v * out->i;
+    if (out->w > out->va) out->w = out->va;
+    if (out->w < -out->va) out->w = -out->va;
+    out->var = sqrtf(out->va * out->va - out->w * out->w);
+    out->pf = (out->va > 0.0f) ? (out->w / out->va) : 0.0f;
+}
+
+size_t ac_meter_calc_feed(ac_meter_calc_t *c, const uint16_t *pairs, size_t n_pairs,
+                          ac_meter_reading_t *out, bool *ready) {
+    calc_chunk_t chunk = {0};
+    int32_t off_v = c->offset_v;
+    int32_t off_i = c->offset_i;
+    int32_t d_v = (c->phase_q8 > 0) ? c->phase_q8 : 0;
+    int32_t d_i = (c->phase_q8 < 0) ? -c->phase_q8 : 0;
+
+    *ready = false;
+
+    for (size_t k = 0; k < n_pairs; k++) {
+        int32_t v = (int32_t)pairs[2 * k] - off_v;
+        int32_t i = (int32_t)pairs[2 * k + 1] - off_i;
+        bool crossing = false;
+        float frac = 0.0f;
+
+        // Cruce ascendente con histéresis
+        if (v < -ZC_HYSTERESIS) {
+            c->armed = true;
+        } else if (c->armed && v >= 0 && c->prev_v < 0) {
+            c->armed = false;
+            crossing = true;
+            // Interpolación lineal: el cruce ocurrió entre la muestra anterior y ésta
+            frac = (float)(-c->prev_v) / (float)(v - c->prev_v);
+        }
+        c->prev_v = v;
+
+        if (crossing) {
+            if (!c->synced) {
+                // Primer cruce: la ventana arranca acá (se descarta lo previo)
+                memset(&chunk, 0, sizeof(chunk));
+                calc_reset_window(c);
+                c->synced = true;
+                c->start_frac = frac;
+                calc_start_harmonics(c);
+            } else if (++c->cycles >= c->window_cycles) {
+                calc_flush_chunk(c, &chunk);
+                calc_close_window(c, out, frac);
+                calc_reset_window(c);
+                c->start_frac = frac;
+                calc_start_harmonics(c);
+                *ready = true;
+                // La muestra actual abre la ventana nueva, ya con los offsets nuevos
+                v = (int32_t)pairs[2 * k] - c->offset_v;
+                i = (int32_t)pairs[2 * k + 1] - c->offset_i;
+                c->prev_v = v;
+            }
+        }
+
+        // Línea de retardo: |v|,|i| <= 4095 y la interpolación no extrapola,
+        // así que el producto entra en el tramo de 32 bits
+        uint32_t pos = ++c->hist_pos;
+        c->hist_v[pos & (AC_METER_CALC_DELAY_LEN - 1)] = (int16_t)v;
+        c->hist_i[pos & (AC_METER_CALC_DELAY_LEN - 1)] = (int16_t)i;
+        int32_t v_al = d_v ? calc_delayed(c->hist_v, pos, d_v) : v;
+        int32_t i_al = d_i ? calc_delayed(c->hist_i, pos, d_i) : i;
+
+        chunk.sum_v += v;
+        chunk.sum_sq_v += (uint32_t)(v * v);
+        chunk.sum_i += i;
+        chunk.sum_sq_i += (uint32_t)(i * i);
+        chunk.sum_vi += v_al * i_al;
+        chunk.n++;
+
+        if (c->harm_active) {
+            float x = (float)i;
+            for (int h = 0; h < AC_METER_CALC_N_HARM; h++) {
+                float s0 = x + c->harm_coeff[h] * c->harm_s1[h] - c->harm_s2[h];
+                c->harm_s2[h] = c->harm_s1[h];
+                c->harm_s1[h] = s0;
+            }
+        }
+
+        if (*ready) {
+            calc_flush_chunk(c, &chunk);
+            return k + 1;
+        }
+
+        if (chunk.n >= AC_METER_CALC_CHUNK) calc_flush_chunk(c, &chunk);
+
+        // Sin cruces (sin tensión o ruido): cerrar por tiempo y re-sincronizar
+        if (c->n + chunk.n >= c->max_pairs) {
+            calc_flush_chunk(c, &chunk);
+            calc_close_window(c, out, 0.0f);
+            calc_reset_window(c);
+            c->synced = false;
+            *ready = true;
+            return k + 1;
+        }
+    }
+    calc_flush_chunk(c, &chunk);
+    return n_pairs;
+}
+
+uint32_t ac_meter_calc_block(ac_meter_calc_t *c, const uint16_t *pairs, size_t n_pairs,
+                             ac_meter_calc_window_cb_t on_window, void *ctx) {
+    uint32_t windows = 0;
+
+    while (n_pairs > 0) {
+        ac_meter_reading_t r;
+        bool ready = false;
+        size_t used = ac_meter_calc_feed(c, pairs, n_pairs, &r, &ready);
+        if (ready) {
+            windows++;
+            if (on_window) on_window(&r, ctx);
+        }
+        pairs += 2 * used;
+        n_pairs -= used;
+    }
+    return windows;
+}
@@ -0,0 +1,137 @@
+#include <math.h>
+#include <string.h>
+#include "ac_meter_inrush.h"
+#include "ac_meter_calc.h"
+
+// Ciclos finales promediados para la corriente de régimen
+#define STEADY_CYCLES  5
+// Banda de asentamiento alrededor del régimen (%)
+#define SETTLE_BAND_PCT 10
+
+void ac_meter_inrush_init(ac_meter_inrush_cap_t *c, uint32_t pair_rate_hz,
+                          uint32_t decim, uint32_t pre_ms, uint32_t post_ms) {
+    memset(c, 0, sizeof(*c));
+    c->decim = decim ? decim : 1;
+    c->rate_hz = pair_rate_hz / c->decim;
+
+    uint32_t pre = (c->rate_hz * pre_ms) / 1000;
+    uint32_t post = (c->rate_hz * post_ms) / 1000;
+    if (post > AC_METER_INRUSH_MAX_SAMPLES) post = AC_METER_INRUSH_MAX_SAMPLES;
+    if (pre + post > AC_METER_INRUSH_MAX_SAMPLES) pre = AC_METER_INRUSH_MAX_SAMPLES - post;
+    c->post = post;
+    c->len = pre + post;
+}
+
+void ac_meter_inrush_trigger(ac_meter_inrush_cap_t *c, int32_t offset) {
+    if (c->triggered || c->post == 0) return;
+    c->offset = offset;
+    c->remaining = c->post;
+    c->triggered = true;
+}
+
+void ac_meter_inrush_gap(ac_meter_inrush_cap_t *c) {
+    // Una captura en curso también queda cortada: se descarta
+    c->triggered = false;
+    c->remaining = 0;
+    c->pos = 0;
+    c->filled = 0;
+    c->decim_count = 0;
+}
+
+bool ac_meter_inrush_feed(ac_meter_inrush_cap_t *c, const uint16_t *pairs, size_t n_pairs) {
+    if (c->len == 0) return false;
+
+    for (size_t k = 0; k < n_pairs; k++) {
+        if (++c->decim_count < c->decim) continue;
+        c->decim_count = 0;
+
+        c->buf[c->pos] = pairs[2 * k + 1];
+        if (++c->pos == c->len) c->pos = 0;
+        if (c->filled < c->len) c->filled++;
+
+        if (c->triggered && --c->remaining == 0) {
+            // Congelar: lo que siga en el bloque no se guarda hasta el próximo feed
+            c->triggered = false;
+            return true;
+        }
+    }
+    return false;
+}
+
+// Muestra centrada en orden cronológico (0 = la más antigua)
+static int32_t sample_at(const ac_meter_inrush_cap_t *c, uint32_t k) {
+    uint32_t first = (c->filled < c->len) ? 0 : c->pos;
+    uint32_t idx = first + k;
+    if (idx >= c->len) idx -= c->len;
+    return (int32_t)c->buf[idx] - c->offset;
+}
+
+void ac_meter_inrush_reduce(const ac_meter_inrush_cap_t *c, float pairs_per_cycle,
+                            ac_meter_inrush_t *out) {
+    memset(out, 0, sizeof(*out));
+    if (c->filled < c->post || c->post == 0) return;
+
+    uint32_t trig = c->filled - c->post;   // Índice del disparo
+    float cycle = (pairs_per_cycle > 0.0f) ? pairs_per_cycle / (float)c->decim
+                                           : (float)c->rate_hz / 50.0f;
+    uint32_t cycle_len = (uint32_t)(cycle + 0.5f);
+    if (cycle_len == 0) cycle_len = 1;
+
+    // Carga previa (ventilador, etc.): solo si hay al menos un ciclo continuo
+    // antes del disparo (tras el reposo la historia empieza en el despertar)
+    uint64_t sum_sq = 0;
+    for (uint32_t k = 0; k < trig; k++) {
+        int32_t x = sample_at(c, k);
+        sum_sq += (uint64_t)((int64_t)x * x);
+    }
+    out->pre_valid = trig >= cycle_len;
+    if (out->pre_valid) out->pre_a = sqrtf((float)sum_sq / (float)trig) * AC_METER_CAL_I;
+
+    // Post-disparo: pico, I²t y RMS por ciclo
+    uint32_t n_cycles = c->post / cycle_len;
+    float cycle_rms[AC_METER_INRUSH_MAX_SAMPLES / 50];
+    uint32_t max_cycles = sizeof(cycle_rms) / sizeof(cycle_rms[0]);
+    if (n_cycles > max_cycles) n_cycles = max_cycles;
+
+    int32_t peak = 0;
+    uint64_t total_sq = 0;
+    uint64_t cyc_sq = 0;
+    uint32_t cyc = 0, in_cyc = 0;
+    for (uint32_t k = 0; k < c->post; k++) {
+        int32_t x = sample_at(c, trig + k);
+        uint64_t sq = (uint64_t)((int64_t)x * x);
+        if (x < 0) x = -x;
+        if (x > peak) peak = x;
+        total_sq += sq;
+
+        if (cyc < n_cycles) {
+            cyc_sq += sq;
+            if (++in_cyc == cycle_len) {
+                cycle_rms[cyc++] = sqrtf((float)cyc_sq / (float)cycle_len) * AC_METER_CAL_I;
+                cyc_sq = 0;
+                in_cyc = 0;
+            }
+        }
+    }
+
+    out->peak_a = (float)peak * AC_METER_CAL_I;
+    out->i2t = (float)total_sq * (AC_METER_CAL_I * AC_METER_CAL_I) / (float)c->rate_hz;
+    if (n_cycles == 0) return;
+
+    uint32_t steady_from = (n_cycles > STEADY_CYCLES) ? n_cycles - STEADY_CYCLES : 0;
+    float steady = 0.0f;
+    for (uint32_t k = 0; k < n_cycles; k++) {
+        if (cycle_rms[k] > out->peak_rms_a) out->peak_rms_a = cycle_rms[k];
+        if (k >= steady_from) steady += cycle_rms[k];
+    }
+    steady /= (float)(n_cycles - steady_from);
+    out->steady_a = steady;
+
+    // Asentado = a partir del último ciclo fuera de la banda
+    float band = steady * (SETTLE_BAND_PCT / 100.0f);
+    uint32_t settled = 0;
+    for (uint32_t k = 0; k < n_cycles; k++) {
+        if (fabsf(cycle_rms[k] - steady) > band) settled = k + 1;
+    }
+    out->settle_ms = (uint32_t)(((uint64_t)settled * cycle_len * 1000) / c->rate_hz);
+}
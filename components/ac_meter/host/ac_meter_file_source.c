@@ -0,0 +1,62 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include "ac_meter_file_source.h"
+
+// Decodifica pares little-endian en el lugar (el host puede ser big-endian)
+static void decode_le(uint16_t *pairs, size_t n_values) {
+    uint8_t *b = (uint8_t *)pairs;
+    for (size_t k = 0; k < n_values; k++) {
+        pairs[k] = (uint16_t)(b[2 * k] | (b[2 * k + 1] << 8));
+    }
+}
+
+static int file_source_start(void *ctx) {
+    return ctx ? 0 : -1;
+}
+
+static int file_source_read(void *ctx, uint16_t *pairs, size_t max_pairs, uint32_t timeout_ms) {
+    (void)timeout_ms;
+    size_t n = fread(pairs, 2 * sizeof(uint16_t), max_pairs, (FILE *)ctx);
+    if (n == 0) return -1;   // Captura agotada
+    decode_le(pairs, 2 * n);
+    return (int)n;
+}
+
+int ac_meter_file_source_open(const char *path, uint32_t pair_rate_hz, ac_meter_source_t *out) {
+    FILE *f = fopen(path, "rb");
+    if (!f) return -1;
+
+    out->ctx = f;
+    out->pair_rate_hz = pair_rate_hz;
+    out->start = file_source_start;
+    out->read = file_source_read;
+    out->stop = NULL;
+    return 0;
+}
+
+void ac_meter_file_source_close(ac_meter_source_t *src) {
+    if (src->ctx) fclose((FILE *)src->ctx);
+    src->ctx = NULL;
+}
+
+uint16_t *ac_meter_capture_load(const char *path, size_t *n_pairs) {
+    FILE *f = fopen(path, "rb");
+    if (!f) return NULL;
+
+    fseek(f, 0, SEEK_END);
+    long bytes = ftell(f);
+    fseek(f, 0, SEEK_SET);
+    size_t n = (bytes > 0) ? (size_t)bytes / (2 * sizeof(uint16_t)) : 0;
+
+    uint16_t *pairs = (n > 0) ? malloc(n * 2 * sizeof(uint16_t)) : NULL;
+    if (pairs && fread(pairs, 2 * sizeof(uint16_t), n, f) != n) {
+        free(pairs);
+        pairs = NULL;
+    }
+    fclose(f);
+    if (!pairs) return NULL;
+
+    decode_le(pairs, 2 * n);
+    *n_pairs = n;
+    return pairs;
+}
@@ -0,0 +1,36 @@
+#pragma once
+#include <stdint.h>
+#include <stddef.h>
+#include "ac_meter_source.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/*
+ * Fuente de muestras sobre un archivo de captura (solo host).
+ * Formato: pares [V, I] uint16 little-endian, sin encabezado, en cuentas
+ * lineales (lo mismo que entrega la fuente ADC tras la tabla de corrección).
+ */
+
+/**
+ * @brief Abre la captura y completa la interfaz de fuente.
+ * @return 0 si el archivo se pudo abrir
+ */
+int ac_meter_file_source_open(const char *path, uint32_t pair_rate_hz, ac_meter_source_t *out);
+
+/**
+ * @brief Cierra el archivo de una fuente abierta con ac_meter_file_source_open.
+ */
+void ac_meter_file_source_close(ac_meter_source_t *src);
+
+/**
+ * @brief Carga una captura completa en memoria (para pruebas con acceso
+ *        aleatorio). Liberar con free().
+ * @return Pares intercalados, o NULL si no se pudo leer
+ */
+uint16_t *ac_meter_capture_load(const char *path, size_t *n_pairs);
+
+#ifdef __cplusplus
+}
+#endif
@@ -0,0 +1,107 @@
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include "ac_meter_calc.h"
+#include "host_common.h"
+
+#ifndef M_PI
+#define M_PI 3.14159265358979323846
+#endif
+
+// Campos numéricos de reference.csv en el orden de las columnas (tras name)
+static float *ref_field(host_ref_t *r, int col) {
+    float *fields[] = {
+        &r->seconds, &r->v, &r->i, &r->w, &r->pf, &r->hz, &r->trigger_s,
+        &r->pre_a, &r->peak_a, &r->peak_rms_a, &r->steady_a, &r->settle_ms,
+    };
+    int n = (int)(sizeof(fields) / sizeof(fields[0]));
+    return (col >= 1 && col <= n) ? fields[col - 1] : NULL;
+}
+
+int host_load_refs(const char *dir, host_ref_t *refs, int max_refs) {
+    char path[512];
+    char line[512];
+    int count = 0;
+    bool header = true;
+
+    snprintf(path, sizeof(path), "%s/reference.csv", dir);
+    FILE *f = fopen(path, "r");
+    if (!f) return -1;
+
+    while (count < max_refs && fgets(line, sizeof(line), f)) {
+        if (line[0] == '#' || line[0] == '\n') continue;
+        if (header) {
+            header = false;   // name,seconds,v,...
+            continue;
+        }
+
+        host_ref_t *r = &refs[count];
+        for (int col = 0; col <= 12; col++) {
+            float *dst = ref_field(r, col);
+            if (dst) *dst = NAN;
+        }
+
+        // strtok saltea campos vacíos: se separa a mano
+        char *p = line;
+        for (int col = 0; p; col++) {
+            char *end = strpbrk(p, ",\r\n");
+            size_t len = end ? (size_t)(end - p) : strlen(p);
+            if (col == 0) {
+                if (len >= sizeof(r->name)) len = sizeof(r->name) - 1;
+                memcpy(r->name, p, len);
+                r->name[len] = '\0';
+            } else if (len > 0 && ref_field(r, col)) {
+                *ref_field(r, col) = strtof(p, NULL);
+            }
+            p = (end && *end == ',') ? end + 1 : NULL;
+        }
+        count++;
+    }
+    fclose(f);
+    return count;
+}
+
+void host_capture_path(const char *dir, const char *name, char *out, size_t len) {
+    snprintf(out, len, "%s/%s.bin", dir, name);
+}
+
+static uint16_t synth_clamp(double x) {
+    long v = lround(x);
+    if (v < 0) v = 0;
+    if (v > 4095) v = 4095;
+    return (uint16_t)v;
+}
+
+void host_synth(const host_synth_t *s, uint32_t pair_rate_hz, uint16_t *pairs, size_t n_pairs) {
+    const double w = 2.0 * M_PI * s->hz;
+    const double phi = acos(s->pf);
+    const double pct[3] = { s->h3 / 100.0, s->h5 / 100.0, s->h7 / 100.0 };
+
+    for (size_t k = 0; k < n_pairs; k++) {
+        double t = (double)k / pair_rate_hz;
+        double t_i = t + 0.5 / pair_rate_hz;
+        double a = w * t_i - phi;
+        double i = sin(a) + pct[0] * sin(3 * a) + pct[1] * sin(5 * a) + pct[2] * sin(7 * a);
+        double v = sqrt(2.0) * s->v_rms * sin(w * t);
+
+        pairs[2 * k] = synth_clamp(s->off_v + v / AC_METER_CAL_V);
+        pairs[2 * k + 1] = synth_clamp(s->off_i + sqrt(2.0) * s->i1_rms * i / AC_METER_CAL_I);
+    }
+}
+
+uint64_t host_now_ns(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000ULL + (uint64_t)ts.tv_nsec;
+}
+
+bool host_check(const char *what, float got, float want, float tol_abs, float tol_rel) {
+    if (isnan(want)) return true;
+
+    float tol = fmaxf(tol_abs, tol_rel * fabsf(want));
+    bool ok = fabsf(got - want) <= tol;
+    printf("  %s %-10s %10.4f  ref %10.4f  (±%.4f)\n", ok ? "✅" : "❌", what, got, want, tol);
+    return ok;
+}
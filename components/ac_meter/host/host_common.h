@@ -0,0 +1,70 @@
+#pragma once
+#include <stdint.h>
+#include <stddef.h>
+#include <stdbool.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/*
+ * Utilidades compartidas por las pruebas de host del medidor: lista de
+ * capturas con sus referencias, señales sintéticas, reloj monotónico y
+ * comparación con tolerancia.
+ */
+
+#define HOST_PAIR_RATE_HZ 10000   // Igual que la fuente ADC (20 kHz / 2 canales)
+#define HOST_BLOCK_PAIRS  128     // Igual que AC_METER_ADC_FRAME_PAIRS
+#define HOST_MAX_CAPTURES 16
+
+// Fila de captures/reference.csv. NAN = el campo no se verifica.
+typedef struct {
+    char name[32];
+    float seconds;
+    float v, i, w, pf, hz;
+    float trigger_s;     // Disparo de la captura de arranque (s)
+    float pre_a, peak_a, peak_rms_a, steady_a, settle_ms;
+} host_ref_t;
+
+// Señal sintética: tensión senoidal y corriente con armónicos impares
+typedef struct {
+    float hz;
+    float v_rms;
+    float i1_rms;       // Fundamental de la corriente (A)
+    float pf;           // Factor de desplazamiento de la fundamental (inductivo)
+    float h3, h5, h7;   // Armónicos de corriente (% de la fundamental)
+    int off_v, off_i;   // Offset DC (cuentas)
+} host_synth_t;
+
+/**
+ * @brief Lee <dir>/reference.csv.
+ * @return Cantidad de capturas, o -1 si no se pudo leer
+ */
+int host_load_refs(const char *dir, host_ref_t *refs, int max_refs);
+
+/**
+ * @brief Arma la ruta <dir>/<name>.bin
+ */
+void host_capture_path(const char *dir, const char *name, char *out, size_t len);
+
+/**
+ * @brief Genera n_pairs pares [V, I] en cuentas lineales. Como el ADC, la
+ *        corriente se toma medio período de par después que la tensión.
+ */
+void host_synth(const host_synth_t *s, uint32_t pair_rate_hz, uint16_t *pairs, size_t n_pairs);
+
+/**
+ * @brief Reloj monotónico en nanosegundos.
+ */
+uint64_t host_now_ns(void);
+
+/**
+ * @brief Compara got contra want con tolerancia max(tol_abs, tol_rel·|want|)
+ *        e imprime el resultado. Un want NAN no se verifica.
+ * @return true si está dentro de tolerancia (o no se verifica)
+ */
+bool host_check(const char *what, float got, float want, float tol_abs, float tol_rel);
+
+#ifdef __cplusplus
+}
+#endif
@@ -0,0 +1,229 @@
+/*
+ * Reproduce las capturas de host/captures a través del mismo cálculo que
+ * corre en el equipo (ac_meter_calc + ac_meter_inrush, leídas con la fuente
+ * de archivo en bloques del tamaño de un frame DMA) y compara contra los
+ * valores de referencia. Al final mide el rendimiento del pipeline.
+ *
+ * Uso: ac_meter_replay <directorio_capturas>
+ */
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include "ac_meter_calc.h"
+#include "ac_meter_inrush.h"
+#include "ac_meter_file_source.h"
+#include "host_common.h"
+
+// Ventanas descartadas al principio (offset inicial en media escala)
+#define WARMUP_WINDOWS 2
+// Pasadas sobre la captura en memoria para medir el rendimiento
+#define BENCH_REPS 50
+
+// Tolerancias contra el modelo (incluyen cuantización y ruido de la captura)
+#define TOL_V_REL   0.005f
+#define TOL_I_ABS   0.03f
+#define TOL_I_REL   0.01f
+#define TOL_W_ABS   2.0f
+#define TOL_W_REL   0.015f
+#define TOL_PF_ABS  0.015f
+#define TOL_HZ_ABS  0.05f
+#define TOL_INRUSH_REL   0.05f
+#define TOL_SETTLE_MS    25.0f
+
+typedef struct {
+    double v, i, w, pf, hz;
+    uint32_t n, n_hz;
+    uint32_t windows;
+} replay_avg_t;
+
+static ac_meter_inrush_cap_t s_inrush;
+
+static void replay_init(ac_meter_calc_t *calc, uint32_t rate) {
+    ac_meter_calc_init(calc, rate, AC_METER_WINDOW_CYCLES, AC_METER_MAX_WINDOW_MS,
+                       AC_METER_PHASE_CAL_Q8, AC_METER_HARMONICS_EVERY);
+    ac_meter_inrush_init(&s_inrush, rate, AC_METER_INRUSH_DECIM,
+                         AC_METER_INRUSH_PRE_MS, AC_METER_INRUSH_POST_MS);
+}
+
+static void replay_window(const ac_meter_reading_t *r, void *ctx) {
+    replay_avg_t *avg = ctx;
+    if (++avg->windows <= WARMUP_WINDOWS) return;
+
+    avg->v += r->v;
+    avg->i += r->i;
+    avg->w += r->w;
+    avg->pf += r->pf;
+    avg->n++;
+    if (r->hz > 0.0f) {
+        avg->hz += r->hz;
+        avg->n_hz++;
+    }
+}
+
+// Un bloque, igual que process_block en el equipo: captura de arranque
+// (disparo en el par trig_at, si cae en el bloque) y consumidor por bloque.
+// Devuelve true si la captura de arranque se completó.
+static bool replay_block(ac_meter_calc_t *calc, const uint16_t *pairs, size_t n_pairs,
+                         size_t trig_at, replay_avg_t *avg) {
+    bool done;
+
+    if (trig_at < n_pairs) {
+        done = ac_meter_inrush_feed(&s_inrush, pairs, trig_at);
+        ac_meter_inrush_trigger(&s_inrush, calc->offset_i);
+        done |= ac_meter_inrush_feed(&s_inrush, pairs + 2 * trig_at, n_pairs - trig_at);
+    } else {
+        done = ac_meter_inrush_feed(&s_inrush, pairs, n_pairs);
+    }
+
+    ac_meter_calc_block(calc, pairs, n_pairs, avg ? replay_window : NULL, avg);
+    return done;
+}
+
+static bool replay_check(const char *dir, const host_ref_t *ref) {
+    char path[512];
+    ac_meter_source_t src;
+    ac_meter_calc_t calc;
+    replay_avg_t avg = {0};
+    ac_meter_inrush_t ev = {0};
+    bool have_ev = false;
+    size_t pos = 0;
+    size_t trig = isnan(ref->trigger_s) ? (size_t)-1
+                                        : (size_t)(ref->trigger_s * HOST_PAIR_RATE_HZ);
+    static uint16_t pairs[HOST_BLOCK_PAIRS * 2];
+
+    host_capture_path(dir, ref->name, path, sizeof(path));
+    if (ac_meter_file_source_open(path, HOST_PAIR_RATE_HZ, &src) != 0 || src.start(src.ctx) != 0) {
+        printf("❌ %s: no se pudo abrir %s\n", ref->name, path);
+        return false;
+    }
+    replay_init(&calc, src.pair_rate_hz);
+
+    int n;
+    while ((n = src.read(src.ctx, pairs, HOST_BLOCK_PAIRS, 0)) > 0) {
+        size_t trig_at = (trig >= pos) ? trig - pos : (size_t)-1;
+        if (replay_block(&calc, pairs, (size_t)n, trig_at, &avg)) {
+            ac_meter_inrush_reduce(&s_inrush, calc.samples_per_cycle, &ev);
+            have_ev = true;
+        }
+        pos += (size_t)n;
+    }
+    ac_meter_file_source_close(&src);
+
+    printf("📼 %s: %zu pares, %u ventanas\n", ref->name, pos, avg.windows);
+    if (avg.n == 0) {
+        printf("  ❌ sin ventanas completas\n");
+        return false;
+    }
+
+    bool ok = true;
+    ok &= host_check("V", (float)(avg.v / avg.n), ref->v, 0.0f, TOL_V_REL);
+    ok &= host_check("I", (float)(avg.i / avg.n), ref->i, TOL_I_ABS, TOL_I_REL);
+    ok &= host_check("W", (float)(avg.w / avg.n), ref->w, TOL_W_ABS, TOL_W_REL);
+    ok &= host_check("FP", (float)(avg.pf / avg.n), ref->pf, TOL_PF_ABS, 0.0f);
+    ok &= host_check("Hz", avg.n_hz ? (float)(avg.hz / avg.n_hz) : 0.0f, ref->hz, TOL_HZ_ABS, 0.0f);
+
+    if (!isnan(ref->trigger_s)) {
+        if (!have_ev) {
+            printf("  ❌ la captura de arranque no se completó\n");
+            return false;
+        }
+        if (!ev.pre_valid) {
+            printf("  ❌ carga previa marcada inválida con historia continua\n");
+            ok = false;
+        }
+        ok &= host_check("pre_a", ev.pre_a, ref->pre_a, 0.05f, TOL_INRUSH_REL);
+        ok &= host_check("peak_a", ev.peak_a, ref->peak_a, 0.0f, TOL_INRUSH_REL);
+        ok &= host_check("peak_rms", ev.peak_rms_a, ref->peak_rms_a, 0.0f, TOL_INRUSH_REL);
+        ok &= host_check("steady_a", ev.steady_a, ref->steady_a, 0.0f, TOL_INRUSH_REL);
+        ok &= host_check("settle_ms", (float)ev.settle_ms, ref->settle_ms, TOL_SETTLE_MS, 0.0f);
+    }
+    return ok;
+}
+
+// Arranque desde el reposo: el ADC estaba detenido hasta el disparo, así que
+// la captura no debe informar una carga previa (sería historia vieja)
+static bool replay_after_idle(const char *dir, const host_ref_t *ref) {
+    char path[512];
+    size_t n_pairs = 0;
+    ac_meter_calc_t calc;
+    ac_meter_inrush_t ev = {0};
+    bool have_ev = false;
+    size_t trig = (size_t)(ref->trigger_s * HOST_PAIR_RATE_HZ);
+
+    host_capture_path(dir, ref->name, path, sizeof(path));
+    uint16_t *pairs = ac_meter_capture_load(path, &n_pairs);
+    if (!pairs) return false;
+
+    replay_init(&calc, HOST_PAIR_RATE_HZ);
+    // Historia vieja (como antes de entrar en reposo), luego el hueco
+    replay_block(&calc, pairs, trig / 2, (size_t)-1, NULL);
+    ac_meter_calc_resync(&calc);
+    ac_meter_inrush_gap(&s_inrush);
+    // Al despertar el primer bloque ya trae el disparo
+    for (size_t pos = trig; pos < n_pairs && !have_ev; pos += HOST_BLOCK_PAIRS) {
+        size_t n = (n_pairs - pos < HOST_BLOCK_PAIRS) ? n_pairs - pos : HOST_BLOCK_PAIRS;
+        if (replay_block(&calc, pairs + 2 * pos, n, (pos == trig) ? 0 : (size_t)-1, NULL)) {
+            ac_meter_inrush_reduce(&s_inrush, calc.samples_per_cycle, &ev);
+            have_ev = true;
+        }
+    }
+    free(pairs);
+
+    bool ok = have_ev && !ev.pre_valid;
+    printf("  %s tras reposo: %s\n", ok ? "✅" : "❌",
+           !have_ev ? "sin captura" : (ev.pre_valid ? "informa carga previa vieja" : "pre inválido"));
+    ok &= have_ev && host_check("steady_a", ev.steady_a, ref->steady_a, 0.0f, TOL_INRUSH_REL);
+    return ok;
+}
+
+// Rendimiento: la captura completa en memoria, BENCH_REPS pasadas por bloques
+static void replay_bench(const char *dir, const host_ref_t *ref) {
+    char path[512];
+    size_t n_pairs = 0;
+    ac_meter_calc_t calc;
+
+    host_capture_path(dir, ref->name, path, sizeof(path));
+    uint16_t *pairs = ac_meter_capture_load(path, &n_pairs);
+    if (!pairs) return;
+
+    replay_init(&calc, HOST_PAIR_RATE_HZ);
+    uint64_t t0 = host_now_ns();
+    for (int rep = 0; rep < BENCH_REPS; rep++) {
+        for (size_t pos = 0; pos < n_pairs; pos += HOST_BLOCK_PAIRS) {
+            size_t n = (n_pairs - pos < HOST_BLOCK_PAIRS) ? n_pairs - pos : HOST_BLOCK_PAIRS;
+            replay_block(&calc, pairs + 2 * pos, n, (size_t)-1, NULL);
+        }
+    }
+    double ns = (double)(host_now_ns() - t0);
+    double total = (double)n_pairs * BENCH_REPS;
+
+    printf("⏱️  %-17s %6.2f Mmuestras/s  %6.2f ns/muestra  (%.0fx tiempo real a %d Hz)\n",
+           ref->name, 2.0 * total / ns * 1000.0, ns / (2.0 * total),
+           total / (ns / 1e9) / HOST_PAIR_RATE_HZ, HOST_PAIR_RATE_HZ);
+    free(pairs);
+}
+
+int main(int argc, char **argv) {
+    static host_ref_t refs[HOST_MAX_CAPTURES];
+
+    if (argc != 2) {
+        fprintf(stderr, "uso: %s <directorio_capturas>\n", argv[0]);
+        return 2;
+    }
+    int n = host_load_refs(argv[1], refs, HOST_MAX_CAPTURES);
+    if (n <= 0) {
+        fprintf(stderr, "No se pudo leer %s/reference.csv\n", argv[1]);
+        return 2;
+    }
+
+    int failed = 0;
+    for (int k = 0; k < n; k++) {
+        bool ok = replay_check(argv[1], &refs[k]);
+        if (!isnan(refs[k].trigger_s)) ok &= replay_after_idle(argv[1], &refs[k]);
+        if (!ok) failed++;
+    }
+    for (int k = 0; k < n; k++) replay_bench(argv[1], &refs[k]);
+
+    printf("%s %d/%d capturas dentro de tolerancia\n", failed ? "❌" : "✅", n - failed, n);
+    return failed ? 1 : 0;
+}
@@ -0,0 +1,155 @@
+/*
+ * Tabla de linealización (ac_meter_adc_lut, generada por CMake igual que en el
+ * firmware) contra la curva de calibración evaluada en double.
+ *
+ * Se generan tensiones senoidales en el pin, se pasan a lectura cruda con la
+ * inversa de la curva del CSV (lo que leería el ADC) y se compara el RMS de:
+ *   - la lectura corregida con la tabla (lo que hace el firmware),
+ *   - la lectura corregida con la curva por tramos en double.
+ * Además se pasa la lectura corregida por ac_meter_calc y se compara V.
+ *
+ * Uso: ac_meter_test_lut <adc_cal_points.csv>
+ */
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include "ac_meter_calc.h"
+#include "ac_meter_lut.h"
+#include "host_common.h"
+
+#ifndef M_PI
+#define M_PI 3.14159265358979323846
+#endif
+
+// Tabla vs curva: solo difieren en el redondeo a cuentas enteras
+#define TOL_LUT_REL   0.001
+// ac_meter_calc (raíz entera, ventanas sincronizadas) vs RMS de la curva
+#define TOL_CALC_REL  0.002f
+
+#define MAX_POINTS 64
+#define N_PAIRS    HOST_PAIR_RATE_HZ   // 1 s
+
+typedef struct {
+    double raw[MAX_POINTS];
+    double mv[MAX_POINTS];
+    int n;
+} cal_curve_t;
+
+static uint16_t s_raw[N_PAIRS];
+static uint16_t s_pairs[N_PAIRS * 2];
+
+static bool load_curve(const char *path, cal_curve_t *c) {
+    char line[256];
+    bool header = true;
+    FILE *f = fopen(path, "r");
+    if (!f) return false;
+
+    c->n = 0;
+    while (c->n < MAX_POINTS && fgets(line, sizeof(line), f)) {
+        if (line[0] == '#' || line[0] == '\n') continue;
+        if (header) {
+            header = false;   // raw,mv
+            continue;
+        }
+        if (sscanf(line, "%lf,%lf", &c->raw[c->n], &c->mv[c->n]) == 2) c->n++;
+    }
+    fclose(f);
+    return c->n >= 2;
+}
+
+// Igual que curve_mv de gen_adc_lut.py (extrapola con el tramo extremo)
+static double curve_mv(const cal_curve_t *c, double raw) {
+    int k = 0;
+    while (k < c->n - 2 && raw > c->raw[k + 1]) k++;
+    return c->mv[k] + (c->mv[k + 1] - c->mv[k]) * (raw - c->raw[k]) / (c->raw[k + 1] - c->raw[k]);
+}
+
+// Inversa: tensión en el pin → lectura cruda (cuantizada como el ADC)
+static uint16_t curve_raw(const cal_curve_t *c, double mv) {
+    int k = 0;
+    while (k < c->n - 2 && mv > c->mv[k + 1]) k++;
+    double raw = c->raw[k] + (c->raw[k + 1] - c->raw[k]) * (mv - c->mv[k]) / (c->mv[k + 1] - c->mv[k]);
+    long r = lround(raw);
+    return (uint16_t)(r < 0 ? 0 : (r > 4095 ? 4095 : r));
+}
+
+static double rms_of(const double *x, size_t n) {
+    double sum = 0, sum_sq = 0;
+    for (size_t k = 0; k < n; k++) {
+        sum += x[k];
+        sum_sq += x[k] * x[k];
+    }
+    double mean = sum / n;
+    return sqrt(fmax(sum_sq / n - mean * mean, 0.0));
+}
+
+static bool check_case(const cal_curve_t *cal, double bias_mv, double peak_mv) {
+    static double lut[N_PAIRS], curve[N_PAIRS], raw[N_PAIRS];
+    const double a = ac_meter_adc_lut_mv_per_count;
+    const double b = ac_meter_adc_lut_mv_offset;
+
+    for (size_t k = 0; k < N_PAIRS; k++) {
+        double mv = bias_mv + peak_mv * sin(2.0 * M_PI * 50.0 * k / HOST_PAIR_RATE_HZ);
+        s_raw[k] = curve_raw(cal, mv);
+        raw[k] = s_raw[k];
+        lut[k] = ac_meter_adc_lut[s_raw[k]];
+        curve[k] = (curve_mv(cal, s_raw[k]) - b) / a;
+        s_pairs[2 * k] = ac_meter_adc_lut[s_raw[k]];
+        s_pairs[2 * k + 1] = 2048;
+    }
+
+    double true_rms = peak_mv / sqrt(2.0) / a;   // Cuentas lineales ideales
+    double rms_lut = rms_of(lut, N_PAIRS);
+    double rms_curve = rms_of(curve, N_PAIRS);
+    double rms_raw = rms_of(raw, N_PAIRS);
+
+    // Pipeline completo: lectura corregida → ventanas del medidor
+    ac_meter_calc_t c;
+    ac_meter_reading_t r;
+    double v_sum = 0;
+    uint32_t v_n = 0, windows = 0;
+    ac_meter_calc_init(&c, HOST_PAIR_RATE_HZ, AC_METER_WINDOW_CYCLES, AC_METER_MAX_WINDOW_MS,
+                       AC_METER_PHASE_CAL_Q8, 0);
+    for (size_t pos = 0; pos < N_PAIRS;) {
+        bool ready = false;
+        pos += ac_meter_calc_feed(&c, s_pairs + 2 * pos, N_PAIRS - pos, &r, &ready);
+        // Las primeras ventanas usan el offset inicial (media escala)
+        if (ready && ++windows > 2 && c.synced) {
+            v_sum += r.v;
+            v_n++;
+        }
+    }
+
+    double err = fabs(rms_lut - rms_curve) / rms_curve;
+    bool ok = err <= TOL_LUT_REL;
+    printf("📈 %4.0f ± %4.0f mV: RMS tabla %.2f, curva %.2f cuentas (error %.4f %%, tol %.2f %%); "
+           "sin corregir %+.2f %%\n", bias_mv, peak_mv, rms_lut, rms_curve, err * 100.0,
+           TOL_LUT_REL * 100.0, (rms_raw / true_rms - 1.0) * 100.0);
+    if (!ok) printf("  ❌ la tabla se aparta de la curva\n");
+
+    if (v_n > 0) {
+        ok &= host_check("V calc", (float)(v_sum / v_n),
+                         (float)(rms_curve * AC_METER_CAL_V), 0.0f, TOL_CALC_REL);
+    } else {
+        printf("  ❌ sin ventanas sincronizadas\n");
+        ok = false;
+    }
+    return ok;
+}
+
+int main(int argc, char **argv) {
+    cal_curve_t cal;
+
+    if (argc != 2 || !load_curve(argv[1], &cal)) {
+        fprintf(stderr, "uso: %s <adc_cal_points.csv>\n", argc > 0 ? argv[0] : "test_lut");
+        return 2;
+    }
+
+    bool ok = true;
+    ok &= check_case(&cal, 1600.0, 700.0);    // Solo zona lineal
+    ok &= check_case(&cal, 1650.0, 1400.0);   // Entra en ambos extremos
+    ok &= check_case(&cal, 2200.0, 900.0);    // Compresión superior
+
+    printf("%s tabla de linealización vs curva\n", ok ? "✅" : "❌");
+    return ok ? 0 : 1;
+}
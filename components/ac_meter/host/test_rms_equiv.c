@@ -0,0 +1,217 @@
+/*
+ * Equivalencia del núcleo entero (ac_meter_calc) contra la versión en doble
+ * precisión que usaba ac_meter_read_rms, ventana por ventana y sobre las
+ * capturas de host/captures, más un micro-benchmark de ambos.
+ *
+ * La referencia en double usa exactamente las mismas muestras de cada
+ * ventana, la misma calibración (AC_METER_CAL_V/I), los mismos umbrales de
+ * ruido y, para la potencia activa, la misma compensación de fase.
+ *
+ * Uso: ac_meter_test_rms_equiv <directorio_capturas>
+ */
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include "ac_meter_calc.h"
+#include "ac_meter_file_source.h"
+#include "host_common.h"
+
+// Error máximo admitido entre el núcleo entero y la referencia en double.
+// La raíz entera en Q8 trunca a 1/256 de cuenta (0.003 V, 0.0001 A); la
+// interpolación entera de la línea de retardo redondea a 1 cuenta.
+#define TOL_V_ABS   0.01f
+#define TOL_I_ABS   0.001f
+#define TOL_W_ABS   0.5f
+#define TOL_W_REL   0.001f
+
+// Umbrales de ruido de ac_meter_calc.c (cuentas RMS)
+#define GATE_V 8.0
+#define GATE_I 35.0
+// Ventanas a menos de esto de un umbral no se comparan (el redondeo decide)
+#define GATE_MARGIN 0.5
+
+#define MAX_WINDOWS 512
+#define BENCH_REPS  50
+
+typedef struct {
+    size_t start;
+    uint32_t len;
+    ac_meter_reading_t r;
+} window_t;
+
+typedef struct {
+    float v, i, w;
+    double rms_v, rms_i;   // Cuentas, antes del umbral
+} ref_reading_t;
+
+// Versión original: sumas en double sobre las muestras crudas
+static void rms_double(const uint16_t *pairs, size_t start, uint32_t n, ref_reading_t *out) {
+    const double d = -(double)AC_METER_PHASE_CAL_Q8 / 256.0;   // Retardo de I (muestras)
+    double sum_v = 0, sum_sq_v = 0, sum_i = 0, sum_sq_i = 0;
+    double sum_vi = 0, sum_ia = 0;
+
+    for (size_t k = start; k < start + n; k++) {
+        double v = pairs[2 * k];
+        double i = pairs[2 * k + 1];
+        double i_prev = pairs[2 * (k - 1) + 1];
+        double i_al = i + (i_prev - i) * d;
+
+        sum_v += v;
+        sum_sq_v += v * v;
+        sum_i += i;
+        sum_sq_i += i * i;
+        sum_vi += v * i_al;
+        sum_ia += i_al;
+    }
+
+    double mean_v = sum_v / n;
+    double mean_i = sum_i / n;
+    double var_v = sum_sq_v / n - mean_v * mean_v;
+    double var_i = sum_sq_i / n - mean_i * mean_i;
+    out->rms_v = sqrt(var_v > 0 ? var_v : 0);
+    out->rms_i = sqrt(var_i > 0 ? var_i : 0);
+
+    double rv = out->rms_v < GATE_V ? 0.0 : out->rms_v;
+    double ri = out->rms_i < GATE_I ? 0.0 : out->rms_i;
+    out->v = (float)(rv * AC_METER_CAL_V);
+    out->i = (float)(ri * AC_METER_CAL_I);
+    out->w = (rv > 0 && ri > 0)
+           ? (float)((sum_vi / n - mean_v * (sum_ia / n)) * AC_METER_CAL_V * AC_METER_CAL_I)
+           : 0.0f;
+}
+
+// Corre el núcleo entero y anota dónde empieza cada ventana
+static uint32_t run_integer(const uint16_t *pairs, size_t n_pairs, uint32_t harmonics_every,
+                            window_t *win, uint32_t max_win) {
+    ac_meter_calc_t c;
+    uint32_t n_win = 0;
+    size_t pos = 0;
+
+    ac_meter_calc_init(&c, HOST_PAIR_RATE_HZ, AC_METER_WINDOW_CYCLES, AC_METER_MAX_WINDOW_MS,
+                       AC_METER_PHASE_CAL_Q8, harmonics_every);
+    while (pos < n_pairs) {
+        ac_meter_reading_t r;
+        bool ready = false;
+        size_t used = ac_meter_calc_feed(&c, pairs + 2 * pos, n_pairs - pos, &r, &ready);
+        pos += used;
+        if (ready && win && n_win < max_win) {
+            // Cierre por cruce: la última muestra ya abre la ventana siguiente
+            size_t end = c.synced ? pos - 1 : pos;
+            win[n_win].start = end - r.samples;
+            win[n_win].len = r.samples;
+            win[n_win].r = r;
+        }
+        if (ready) n_win++;
+    }
+    return n_win;
+}
+
+static bool check_capture(const char *dir, const host_ref_t *ref) {
+    static window_t win[MAX_WINDOWS];
+    char path[512];
+    size_t n_pairs = 0;
+    uint32_t compared = 0, skipped = 0;
+    float err_v = 0, err_i = 0, err_w = 0;
+    bool ok = true;
+
+    host_capture_path(dir, ref->name, path, sizeof(path));
+    uint16_t *pairs = ac_meter_capture_load(path, &n_pairs);
+    if (!pairs) {
+        printf("❌ %s: no se pudo leer %s\n", ref->name, path);
+        return false;
+    }
+
+    uint32_t n_win = run_integer(pairs, n_pairs, 0, win, MAX_WINDOWS);
+    if (n_win > MAX_WINDOWS) n_win = MAX_WINDOWS;
+
+    for (uint32_t k = 0; k < n_win; k++) {
+        ref_reading_t d;
+        if (win[k].start == 0) continue;   // Sin muestra previa para el retardo
+        rms_double(pairs, win[k].start, win[k].len, &d);
+
+        if (fabs(d.rms_v - GATE_V) < GATE_MARGIN || fabs(d.rms_i - GATE_I) < GATE_MARGIN) {
+            skipped++;
+            continue;
+        }
+        float ev = fabsf(win[k].r.v - d.v);
+        float ei = fabsf(win[k].r.i - d.i);
+        float ew = fabsf(win[k].r.w - d.w);
+        if (ev > err_v) err_v = ev;
+        if (ei > err_i) err_i = ei;
+        if (ew > err_w) err_w = ew;
+        if (ev > TOL_V_ABS || ei > TOL_I_ABS || ew > fmaxf(TOL_W_ABS, TOL_W_REL * fabsf(d.w))) {
+            printf("  ❌ ventana %u: V %.4f/%.4f  I %.5f/%.5f  W %.3f/%.3f (entero/double)\n",
+                   k, win[k].r.v, d.v, win[k].r.i, d.i, win[k].r.w, d.w);
+            ok = false;
+        }
+        compared++;
+    }
+
+    printf("%s %s: %u ventanas comparadas (%u junto a un umbral), error máx "
+           "V %.4f V, I %.5f A, W %.3f W\n",
+           ok ? "✅" : "❌", ref->name, compared, skipped, err_v, err_i, err_w);
+    free(pairs);
+    return ok && compared > 0;
+}
+
+// Micro-benchmark: ns por par del núcleo entero (con detección de cruces y
+// línea de retardo) y de las sumas en double sobre las mismas ventanas
+static void bench_capture(const char *dir, const host_ref_t *ref) {
+    static window_t win[MAX_WINDOWS];
+    char path[512];
+    size_t n_pairs = 0;
+    volatile float sink = 0;
+
+    host_capture_path(dir, ref->name, path, sizeof(path));
+    uint16_t *pairs = ac_meter_capture_load(path, &n_pairs);
+    if (!pairs) return;
+
+    uint32_t n_win = run_integer(pairs, n_pairs, 0, win, MAX_WINDOWS);
+    if (n_win > MAX_WINDOWS) n_win = MAX_WINDOWS;
+
+    uint64_t t0 = host_now_ns();
+    for (int rep = 0; rep < BENCH_REPS; rep++) run_integer(pairs, n_pairs, 0, NULL, 0);
+    double ns_int = (double)(host_now_ns() - t0) / ((double)n_pairs * BENCH_REPS);
+
+    size_t covered = 0;
+    t0 = host_now_ns();
+    for (int rep = 0; rep < BENCH_REPS; rep++) {
+        covered = 0;
+        for (uint32_t k = 0; k < n_win; k++) {
+            ref_reading_t d;
+            if (win[k].start == 0) continue;
+            rms_double(pairs, win[k].start, win[k].len, &d);
+            sink += d.v;
+            covered += win[k].len;
+        }
+    }
+    double ns_dbl = covered ? (double)(host_now_ns() - t0) / ((double)covered * BENCH_REPS) : 0.0;
+
+    printf("⏱️  %-17s entero %5.2f ns/par   double %5.2f ns/par\n", ref->name, ns_int, ns_dbl);
+    (void)sink;
+    free(pairs);
+}
+
+int main(int argc, char **argv) {
+    static host_ref_t refs[HOST_MAX_CAPTURES];
+
+    if (argc != 2) {
+        fprintf(stderr, "uso: %s <directorio_capturas>\n", argv[0]);
+        return 2;
+    }
+    int n = host_load_refs(argv[1], refs, HOST_MAX_CAPTURES);
+    if (n <= 0) {
+        fprintf(stderr, "No se pudo leer %s/reference.csv\n", argv[1]);
+        return 2;
+    }
+
+    printf("🔢 Núcleo entero vs double (tolerancia V %.3f V, I %.4f A, W max(%.1f W, %.1f%%))\n",
+           TOL_V_ABS, TOL_I_ABS, TOL_W_ABS, TOL_W_REL * 100.0f);
+    int failed = 0;
+    for (int k = 0; k < n; k++) {
+        if (!check_capture(argv[1], &refs[k])) failed++;
+    }
+    for (int k = 0; k < n; k++) bench_capture(argv[1], &refs[k]);
+
+    return failed ? 1 : 0;
+}
@@ -1,22 +1,101 @@
 #pragma once
 #include <stdint.h>
+#include <stdbool.h>
+#include "ac_meter_source.h"
 
 #ifdef __cplusplus
 extern "C" {
 #endif
 
+// Armónicos impares de la corriente (Goertzel sobre ventanas de ciclos enteros)
+typedef struct {
+    bool valid;       // false si la ventana no se analizó
+    float i1;         // Fundamental (A RMS)
+    float h3;         // 3er armónico (% de la fundamental)
+    float h5;         // 5to armónico (%)
+    float h7;         // 7mo armónico (%)
+    float thd;        // Distorsión armónica total hasta el 7mo (%)
+} ac_meter_harmonics_t;
+
+// Resultado de una ventana de medición
+typedef struct {
+    float v;          // Tensión RMS (V)
+    float i;          // Corriente RMS (A)
+    float w;          // Potencia activa (W)
+    float va;         // Potencia aparente (VA)
+    float var;        // Potencia reactiva (VAR, sin signo)
+    float pf;         // Factor de potencia (W / VA)
+    float hz;         // Frecuencia de línea (0 si no hay cruces por cero)
+    uint32_t samples; // Pares V/I usados en la ventana
+    ac_meter_harmonics_t harm;
+} ac_meter_reading_t;
+
+// Resumen de un arranque del compresor (captura de ~1 s alrededor del disparo)
+typedef struct {
+    float peak_a;       // Pico instantáneo de corriente (A)
+    float peak_rms_a;   // Máximo RMS de un ciclo (A)
+    float steady_a;     // RMS de régimen al final de la captura (A)
+    float pre_a;        // RMS antes del disparo (carga previa, ej. ventilador)
+    bool pre_valid;     // false si el ADC venía detenido (reposo): pre_a no vale
+    float i2t;          // Integral de i² desde el disparo (A²s)
+    uint32_t settle_ms; // Tiempo hasta quedar dentro de ±10% del régimen
+} ac_meter_inrush_t;
+
 /**
- * @brief Inicializa el ADC OneShot en los pines indicados.
+ * @brief Inicializa el ADC en modo continuo (DMA) en los pines indicados
+ *        y arranca la tarea que calcula RMS por bloque (ac_meter_start).
  * @param pin_v GPIO del sensor de voltaje (ZMPT101B)
  * @param pin_i GPIO del sensor de corriente (SCT)
  */
 void ac_meter_init(int pin_v, int pin_i);
 
 /**
- * @brief Toma muestras reales durante 200ms y calcula RMS.
+ * @brief Arranca el medidor sobre una fuente de muestras arbitraria
+ *        (ej. una captura grabada) en lugar del ADC.
+ */
+void ac_meter_start(const ac_meter_source_t *src);
+
+/**
+ * @brief Devuelve la última lectura calculada (no bloquea ni muestrea).
  */
 void ac_meter_read_rms(float *v, float *i, float *w);
 
+/**
+ * @brief Copia la última lectura completa (incluye frecuencia de línea).
+ */
+void ac_meter_get_reading(ac_meter_reading_t *out);
+
+/**
+ * @brief Copia el último análisis de armónicos de la corriente.
+ *        Se recalcula una vez por segundo aprox. (ver AC_METER_HARMONICS_EVERY).
+ */
+void ac_meter_get_harmonics(ac_meter_harmonics_t *out);
+
+/**
+ * @brief Dispara la captura de arranque (llamar en el flanco de encendido
+ *        del compresor). Seguro desde cualquier tarea; no bloquea.
+ */
+void ac_meter_trigger_inrush(void);
+
+/**
+ * @brief Informa si hay cargas conmutadas (compresor o ventilador).
+ *        Sin cargas y con corriente estable el medidor pasa a ráfagas
+ *        espaciadas; cualquier cambio lo devuelve a tasa completa al instante.
+ */
+void ac_meter_set_loads(bool loads_on);
+
+/**
+ * @brief false si la fuente de muestras no pudo arrancar (ej. al salir del
+ *        reposo): las lecturas quedan congeladas hasta que se recupere.
+ */
+bool ac_meter_is_ok(void);
+
+/**
+ * @brief Entrega el último arranque capturado, una sola vez por evento.
+ * @return true si había un evento nuevo en *out
+ */
+bool ac_meter_get_inrush(ac_meter_inrush_t *out);
+
 #ifdef __cplusplus
 }
 #endif
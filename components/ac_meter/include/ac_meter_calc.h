@@ -0,0 +1,151 @@
+#pragma once
+#include <stdint.h>
+#include <stddef.h>
+#include <stdbool.h>
+#include "ac_meter.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/*
+ * Núcleo de cálculo del medidor (sin dependencias de ESP-IDF).
+ * Recibe bloques de muestras crudas intercaladas [V0, I0, V1, I1, ...]
+ * y entrega una lectura RMS cada vez que se completa una ventana.
+ *
+ * Las ventanas se sincronizan con los cruces por cero ascendentes de la
+ * tensión: cada una abarca exactamente window_cycles ciclos de red. Si no
+ * hay cruces (sin tensión), la ventana se cierra por tiempo (max_pairs).
+ *
+ * Toda la acumulación es entera (el ESP32 no tiene FPU de doble precisión):
+ * las muestras se centran con el offset de la ventana anterior, se suman en
+ * int32 por tramos de AC_METER_CALC_CHUNK pares y se vuelcan a int64. La raíz
+ * final también es entera (Q8); solo la calibración se aplica en float.
+ *
+ * En la misma pasada se acumula el producto instantáneo v·i (potencia
+ * activa). Para compensar el desfase entre canales (el ADC muestrea I medio
+ * período después que V, más el desfase propio de ZMPT/SCT) uno de los dos
+ * canales pasa por una línea de retardo con interpolación lineal.
+ *
+ * Cada harmonics_every ventanas sincronizadas, un banco de Goertzel corre
+ * sobre la corriente para la fundamental y los armónicos 3, 5 y 7. Como la
+ * ventana abarca ciclos enteros, cada armónico cae justo en un bin.
+ */
+
+// CALIBRACIÓN (Ajustar con Multímetro)
+// Si mide de más, bajar este número. Si mide de menos, subirlo.
+// Unidades: voltios/amperes por cuenta ADC centrada.
+#define AC_METER_CAL_V 0.773f
+#define AC_METER_CAL_I 0.024f
+
+// Configuración del pipeline (la comparten ac_meter.c y el arnés de host)
+// Ventanas sincronizadas con la red: ciclos completos entre cruces por cero.
+// Si no hay tensión (sin cruces) la ventana se cierra por tiempo.
+#define AC_METER_WINDOW_CYCLES  2
+#define AC_METER_MAX_WINDOW_MS  100
+
+// Compensación de fase V/I en muestras Q8 (256 = 1 muestra = 1.8° a 50 Hz).
+// El ADC toma I medio período de par después que V: se retrasa I 0.5 muestras.
+// Ajustar con carga resistiva pura hasta que el factor de potencia dé 1.00.
+// Positivo retrasa la tensión, negativo retrasa la corriente.
+#define AC_METER_PHASE_CAL_Q8   (-128)
+
+// Armónicos de corriente: 1 de cada N ventanas (25 x 2 ciclos ≈ 1 s a 50 Hz)
+#define AC_METER_HARMONICS_EVERY 25
+
+// Pares por tramo de acumulación en 32 bits: 128 * 4095^2 < 2^31
+#define AC_METER_CALC_CHUNK 128
+
+// Línea de retardo para la compensación de fase (potencia de 2)
+#define AC_METER_CALC_DELAY_LEN 16
+#define AC_METER_CALC_MAX_PHASE_Q8 ((AC_METER_CALC_DELAY_LEN - 2) << 8)
+
+// Armónicos analizados: 1 (fundamental), 3, 5, 7
+#define AC_METER_CALC_N_HARM 4
+
+typedef struct {
+    // Configuración
+    uint32_t pair_rate_hz;   // Pares V/I por segundo
+    uint32_t window_cycles;  // Ciclos de red por ventana
+    uint32_t max_pairs;      // Cierre forzado si no hay cruces
+    int32_t phase_q8;        // Retardo en muestras (Q8): >0 retrasa V, <0 retrasa I
+
+    // Línea de retardo (muestras centradas)
+    int16_t hist_v[AC_METER_CALC_DELAY_LEN];
+    int16_t hist_i[AC_METER_CALC_DELAY_LEN];
+    uint32_t hist_pos;
+
+    // Detector de cruce por cero (sobre la tensión sin offset)
+    int32_t offset_v;        // Offset DC estimado (media de la ventana anterior)
+    int32_t offset_i;
+    int32_t prev_v;          // Muestra anterior ya centrada
+    bool armed;              // La señal bajó de -histéresis: se espera un cruce
+    bool synced;             // La ventana actual arrancó en un cruce
+    uint32_t cycles;         // Cruces contados en la ventana actual
+    float start_frac;        // Posición fraccional del cruce de inicio
+    float samples_per_cycle; // Medido en la última ventana sincronizada (0 = desconocido)
+
+    // Banco de Goertzel (corriente)
+    uint32_t harmonics_every;  // Analizar 1 de cada N ventanas (0 = nunca)
+    uint32_t harm_countdown;
+    bool harm_active;          // La ventana actual se está analizando
+    float harm_coeff[AC_METER_CALC_N_HARM];
+    float harm_s1[AC_METER_CALC_N_HARM];
+    float harm_s2[AC_METER_CALC_N_HARM];
+
+    // Acumuladores de la ventana actual (muestras centradas en offset_*)
+    uint32_t n;
+    int64_t sum_v;
+    uint64_t sum_sq_v;
+    int64_t sum_i;
+    uint64_t sum_sq_i;
+    int64_t sum_vi;          // Producto instantáneo (con compensación de fase)
+} ac_meter_calc_t;
+
+/**
+ * @brief Prepara el acumulador.
+ * @param pair_rate_hz Pares V/I por segundo que entrega el ADC
+ * @param window_cycles Ciclos de red completos por ventana (ej. 2)
+ * @param max_window_ms Duración máxima de una ventana sin cruces por cero
+ * @param phase_q8 Compensación de fase en muestras Q8 (256 = 1 muestra).
+ *                 Positivo retrasa la tensión, negativo retrasa la corriente.
+ * @param harmonics_every Analizar armónicos en 1 de cada N ventanas (0 = nunca)
+ */
+void ac_meter_calc_init(ac_meter_calc_t *c, uint32_t pair_rate_hz,
+                        uint32_t window_cycles, uint32_t max_window_ms,
+                        int32_t phase_q8, uint32_t harmonics_every);
+
+/**
+ * @brief Descarta la ventana en curso tras un hueco en las muestras (ADC
+ *        detenido). Conserva offsets y período medido; la próxima ventana
+ *        arranca en el siguiente cruce por cero.
+ */
+void ac_meter_calc_resync(ac_meter_calc_t *c);
+
+/**
+ * @brief Consume muestras hasta cerrar una ventana o agotar el bloque.
+ * @param pairs Muestras crudas intercaladas (2 * n_pairs valores)
+ * @param out Lectura resultante (solo válida si *ready == true)
+ * @return Cantidad de pares consumidos. Si es menor que n_pairs, volver a
+ *         llamar con el resto del bloque.
+ */
+size_t ac_meter_calc_feed(ac_meter_calc_t *c, const uint16_t *pairs, size_t n_pairs,
+                          ac_meter_reading_t *out, bool *ready);
+
+/**
+ * @brief Ventana cerrada dentro de ac_meter_calc_block.
+ */
+typedef void (*ac_meter_calc_window_cb_t)(const ac_meter_reading_t *r, void *ctx);
+
+/**
+ * @brief Consumidor por bloque: procesa un bloque completo (ej. un frame DMA)
+ *        llamando a ac_meter_calc_feed hasta agotarlo.
+ * @param on_window Se invoca por cada ventana cerrada (puede ser NULL)
+ * @return Cantidad de ventanas cerradas en el bloque
+ */
+uint32_t ac_meter_calc_block(ac_meter_calc_t *c, const uint16_t *pairs, size_t n_pairs,
+                             ac_meter_calc_window_cb_t on_window, void *ctx);
+
+#ifdef __cplusplus
+}
+#endif
@@ -0,0 +1,74 @@
+#pragma once
+#include <stdint.h>
+#include <stddef.h>
+#include <stdbool.h>
+#include "ac_meter.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/*
+ * Captura disparada del arranque del compresor (sin dependencias de ESP-IDF).
+ * La corriente cruda se guarda continuamente en un ring buffer diezmado.
+ * Al dispararse se siguen guardando post_ms y la captura queda congelada con
+ * pre_ms de historia previa, lista para reducirse a unos pocos números.
+ */
+
+// 200 ms + 800 ms a 5 kHz (10 kHz / 2)
+#define AC_METER_INRUSH_MAX_SAMPLES 5000
+
+// Captura de arranque: 200 ms antes y 800 ms después del disparo, a 5 kHz
+#define AC_METER_INRUSH_DECIM   2
+#define AC_METER_INRUSH_PRE_MS  200
+#define AC_METER_INRUSH_POST_MS 800
+
+typedef struct {
+    uint32_t rate_hz;        // Muestras por segundo guardadas (tras diezmar)
+    uint32_t decim;          // Guarda 1 de cada decim pares
+    uint32_t decim_count;
+    uint32_t len;            // pre + post
+    uint32_t post;           // Muestras a guardar tras el disparo
+    uint16_t buf[AC_METER_INRUSH_MAX_SAMPLES];  // Corriente cruda (cuentas ADC)
+    uint32_t pos;            // Próxima escritura
+    uint32_t filled;         // Muestras válidas en el buffer
+    uint32_t remaining;      // Muestras post-disparo pendientes
+    bool triggered;
+    int32_t offset;          // Offset DC de la corriente al momento del disparo
+} ac_meter_inrush_cap_t;
+
+/**
+ * @brief Prepara la captura. pre_ms + post_ms no debe superar
+ *        AC_METER_INRUSH_MAX_SAMPLES a la frecuencia diezmada (se recorta).
+ */
+void ac_meter_inrush_init(ac_meter_inrush_cap_t *c, uint32_t pair_rate_hz,
+                          uint32_t decim, uint32_t pre_ms, uint32_t post_ms);
+
+/**
+ * @brief Dispara la captura. Se ignora si ya hay una en curso.
+ * @param offset Offset DC de la corriente en cuentas ADC
+ */
+void ac_meter_inrush_trigger(ac_meter_inrush_cap_t *c, int32_t offset);
+
+/**
+ * @brief Descarta la historia tras un hueco en las muestras (ADC detenido).
+ *        Un disparo inmediato queda sin carga previa (pre_valid = false).
+ */
+void ac_meter_inrush_gap(ac_meter_inrush_cap_t *c);
+
+/**
+ * @brief Guarda la corriente de un bloque de pares [V, I] intercalados.
+ * @return true cuando la captura en curso acaba de completarse
+ */
+bool ac_meter_inrush_feed(ac_meter_inrush_cap_t *c, const uint16_t *pairs, size_t n_pairs);
+
+/**
+ * @brief Reduce una captura completa a pico, tiempo de asentamiento e I²t.
+ * @param pairs_per_cycle Pares por ciclo de red medidos (0 = asumir 50 Hz)
+ */
+void ac_meter_inrush_reduce(const ac_meter_inrush_cap_t *c, float pairs_per_cycle,
+                            ac_meter_inrush_t *out);
+
+#ifdef __cplusplus
+}
+#endif
@@ -0,0 +1,23 @@
+#pragma once
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define AC_METER_LUT_SIZE 4096
+
+/*
+ * Linealización del ADC: lectura cruda → cuentas lineales (misma escala que
+ * la zona lineal del ADC). Se genera al compilar desde cal/adc_cal_points.csv
+ * (ver tools/gen_adc_lut.py); aplicar una entrada cuesta una sola carga.
+ */
+extern const uint16_t ac_meter_adc_lut[AC_METER_LUT_SIZE];
+
+// Recta de referencia de la tabla: mv = cuentas_lineales * mv_per_count + mv_offset
+extern const float ac_meter_adc_lut_mv_per_count;
+extern const float ac_meter_adc_lut_mv_offset;
+
+#ifdef __cplusplus
+}
+#endif
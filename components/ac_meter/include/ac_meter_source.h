@@ -0,0 +1,39 @@
+#pragma once
+#include <stdint.h>
+#include <stddef.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/*
+ * Fuente de muestras del medidor. Desacopla el cálculo del hardware: el ADC
+ * continuo es la fuente por defecto, pero cualquier productor de pares
+ * [V, I] intercalados (archivo grabado, UART, generador sintético) puede
+ * alimentar el mismo pipeline.
+ */
+typedef struct {
+    void *ctx;
+    uint32_t pair_rate_hz;  // Pares V/I por segundo
+
+    /**
+     * @brief Arranca la adquisición. Devuelve 0 si todo fue bien.
+     */
+    int (*start)(void *ctx);
+
+    /**
+     * @brief Espera hasta timeout_ms y copia hasta max_pairs pares intercalados.
+     * @return Pares copiados, 0 si venció el timeout, negativo si hubo error
+     *         o la fuente se agotó.
+     */
+    int (*read)(void *ctx, uint16_t *pairs, size_t max_pairs, uint32_t timeout_ms);
+
+    /**
+     * @brief Detiene la adquisición (opcional, puede ser NULL).
+     */
+    void (*stop)(void *ctx);
+} ac_meter_source_t;
+
+#ifdef __cplusplus
+}
+#endif
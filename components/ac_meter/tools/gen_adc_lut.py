@@ -0,0 +1,102 @@
+#!/usr/bin/env python3
+"""Genera la tabla de linealización del ADC (4096 entradas) desde un CSV de
+puntos de calibración (raw, mv).
+
+La salida queda en "cuentas lineales": la tensión real se reescala con la
+pendiente de la zona lineal de la curva, de modo que CAL_V/CAL_I siguen
+valiendo y solo se corrigen la zona muerta inferior y la compresión superior.
+
+Uso: gen_adc_lut.py <puntos.csv> <salida.c>
+"""
+import csv
+import sys
+
+ADC_MAX = 4095
+# Zona lineal usada para la pendiente de referencia (cuentas crudas)
+LINEAR_FROM = 500
+LINEAR_TO = 3000
+# Error declarado de los puntos de calibración (mV): la tabla debe
+# reproducir cada punto del CSV dentro de este margen
+CAL_TOL_MV = 2.0
+
+
+def load_points(path):
+    points = []
+    with open(path, newline="") as f:
+        rows = (line for line in f if not line.lstrip().startswith("#"))
+        for row in csv.DictReader(rows):
+            points.append((int(row["raw"]), float(row["mv"])))
+    points.sort()
+    if len(points) < 2:
+        sys.exit("gen_adc_lut: se necesitan al menos 2 puntos de calibración")
+    for (r0, m0), (r1, m1) in zip(points, points[1:]):
+        if r0 == r1:
+            sys.exit("gen_adc_lut: punto raw=%d repetido" % r0)
+        if m1 <= m0:
+            sys.exit("gen_adc_lut: mv no crece entre raw=%d y raw=%d" % (r0, r1))
+    return points
+
+
+def curve_mv(points, raw):
+    """Interpolación lineal por tramos (extrapola con el tramo extremo)."""
+    if raw <= points[0][0]:
+        (r0, m0), (r1, m1) = points[0], points[1]
+    elif raw >= points[-1][0]:
+        (r0, m0), (r1, m1) = points[-2], points[-1]
+    else:
+        for (r0, m0), (r1, m1) in zip(points, points[1:]):
+            if r0 <= raw <= r1:
+                break
+    return m0 + (m1 - m0) * (raw - r0) / (r1 - r0)
+
+
+def reference_line(points):
+    """Recta de mínimos cuadrados sobre la zona lineal: mv = a * raw + b."""
+    xs = list(range(LINEAR_FROM, LINEAR_TO + 1))
+    ys = [curve_mv(points, x) for x in xs]
+    n = len(xs)
+    mx = sum(xs) / n
+    my = sum(ys) / n
+    a = sum((x - mx) * (y - my) for x, y in zip(xs, ys)) / sum((x - mx) ** 2 for x in xs)
+    return a, my - a * mx
+
+
+def main():
+    if len(sys.argv) != 3:
+        sys.exit(__doc__)
+    points = load_points(sys.argv[1])
+    a, b = reference_line(points)
+
+    table = []
+    for raw in range(ADC_MAX + 1):
+        exact = (curve_mv(points, raw) - b) / a
+        table.append(min(max(int(round(exact)), 0), ADC_MAX))
+
+    if any(t1 < t0 for t0, t1 in zip(table, table[1:])):
+        sys.exit("gen_adc_lut: la tabla no es monótona")
+    # Cada punto medido, pasado por la tabla y vuelto a mV con la recta de
+    # referencia, debe caer dentro del error de calibración (falla si el punto
+    # queda fuera del rango representable o la recta no lo alcanza)
+    for raw, mv in points:
+        if not 0 <= raw <= ADC_MAX:
+            sys.exit("gen_adc_lut: punto raw=%d fuera de 0..%d" % (raw, ADC_MAX))
+        err = table[raw] * a + b - mv
+        if abs(err) > CAL_TOL_MV:
+            sys.exit("gen_adc_lut: raw=%d -> %.1f mV, calibrado %.1f mV (error %.2f > %.1f mV)"
+                     % (raw, table[raw] * a + b, mv, err, CAL_TOL_MV))
+
+    with open(sys.argv[2], "w") as out:
+        out.write("// Generado por tools/gen_adc_lut.py desde %s. No editar.\n"
+                  % sys.argv[1].replace("\\", "/").split("/")[-1])
+        out.write("// Pendiente de referencia: %.5f mV/cuenta, ordenada %.1f mV\n" % (a, b))
+        out.write('#include "ac_meter_lut.h"\n\n')
+        out.write("const uint16_t ac_meter_adc_lut[AC_METER_LUT_SIZE] = {\n")
+        for i in range(0, len(table), 16):
+            out.write("    " + ", ".join("%4d" % v for v in table[i:i + 16]) + ",\n")
+        out.write("};\n\n")
+        out.write("const float ac_meter_adc_lut_mv_per_count = %.7ff;\n" % a)
+        out.write("const float ac_meter_adc_lut_mv_offset = %.4ff;\n" % b)
+
+
+if __name__ == "__main__":
+    main()
@@ -0,0 +1,147 @@
+#!/usr/bin/env python3
+"""Genera las capturas de prueba del medidor (host/captures) y sus valores
+de referencia.
+
+Cada captura es un binario de pares [V, I] uint16 little-endian, en el mismo
+formato que entrega la fuente ADC tras la linealización (cuentas lineales, con
+offset DC). Las señales salen de un modelo físico (tensión, corriente,
+armónicos, ruido, arranque del compresor) y la referencia son los parámetros
+del modelo, no la salida del medidor: el arnés de host compara contra esto.
+
+Mientras no haya capturas grabadas en la placa, estas son sintéticas. Una
+captura real se agrega copiando el .bin y su fila en reference.csv.
+
+Uso: gen_captures.py <directorio_salida>
+"""
+import math
+import os
+import random
+import struct
+import sys
+
+PAIR_RATE_HZ = 10000
+CAL_V = 0.773   # V por cuenta (AC_METER_CAL_V)
+CAL_I = 0.024   # A por cuenta (AC_METER_CAL_I)
+ADC_MAX = 4095
+
+FIELDS = ["name", "seconds", "v", "i", "w", "pf", "hz",
+          "trigger_s", "pre_a", "peak_a", "peak_rms_a", "steady_a", "settle_ms"]
+
+
+def phasor_current(t, i1_rms, phi, hz, harm):
+    """Corriente con fundamental desfasada phi y armónicos {orden: % de I1}."""
+    w = 2.0 * math.pi * hz
+    x = math.sin(w * t - phi)
+    for order, pct in harm.items():
+        x += (pct / 100.0) * math.sin(order * (w * t - phi))
+    return math.sqrt(2.0) * i1_rms * x
+
+
+def write_capture(path, seconds, v_fn, i_fn, off_v, off_i, noise_v, noise_i, rng):
+    n = int(seconds * PAIR_RATE_HZ)
+    out = bytearray()
+    for k in range(n):
+        t = k / PAIR_RATE_HZ
+        # El ADC convierte I medio período de par después que V
+        t_i = t + 0.5 / PAIR_RATE_HZ
+        v = off_v + v_fn(t) / CAL_V + rng.gauss(0.0, noise_v)
+        i = off_i + i_fn(t_i) / CAL_I + rng.gauss(0.0, noise_i)
+        v = min(max(int(round(v)), 0), ADC_MAX)
+        i = min(max(int(round(i)), 0), ADC_MAX)
+        out += struct.pack("<HH", v, i)
+    with open(path, "wb") as f:
+        f.write(out)
+
+
+def steady(name, seconds, hz, v_rms, i1_rms, pf1, harm, off, noise, rng, outdir):
+    """Carga estable: referencia = V, I, W, FP y Hz del modelo."""
+    phi = math.acos(pf1)
+    write_capture(os.path.join(outdir, name + ".bin"), seconds,
+                  lambda t: math.sqrt(2.0) * v_rms * math.sin(2.0 * math.pi * hz * t),
+                  lambda t: phasor_current(t, i1_rms, phi, hz, harm),
+                  off[0], off[1], noise[0], noise[1], rng)
+    i_rms = i1_rms * math.sqrt(1.0 + sum((p / 100.0) ** 2 for p in harm.values()))
+    w = v_rms * i1_rms * pf1   # Los armónicos de corriente no aportan con V senoidal
+    pf = w / (v_rms * i_rms) if i_rms > 0.0 else 0.0
+    return {"name": name, "seconds": seconds, "v": v_rms, "i": i_rms, "w": w,
+            "pf": pf, "hz": hz}
+
+
+def compressor_start(name, seconds, trigger_s, rng, outdir):
+    """Ventilador andando; en trigger_s arranca el compresor con pico que
+    decae exponencialmente hasta el régimen."""
+    hz, v_rms = 50.0, 220.0
+    fan_a, fan_phi = 0.8, math.acos(0.95)
+    comp_a, comp_phi = 5.0, math.acos(0.85)
+    peak_x, tau = 5.0, 0.080   # Pico de 6x el régimen, constante de 80 ms
+
+    def i_fn(t):
+        i = phasor_current(t, fan_a, fan_phi, hz, {})
+        if t >= trigger_s:
+            env = 1.0 + peak_x * math.exp(-(t - trigger_s) / tau)
+            i += env * phasor_current(t, comp_a, comp_phi, hz, {})
+        return i
+
+    write_capture(os.path.join(outdir, name + ".bin"), seconds,
+                  lambda t: math.sqrt(2.0) * v_rms * math.sin(2.0 * math.pi * hz * t),
+                  i_fn, 1990, 2030, 3.0, 3.0, rng)
+
+    # Referencias del modelo continuo (ciclos alineados con el disparo)
+    steps = 2000
+    period = 1.0 / hz
+    post_cycles = int(0.8 * hz)
+    cycle_rms = []
+    peak = 0.0
+    for c in range(post_cycles):
+        acc = 0.0
+        for s in range(steps):
+            x = i_fn(trigger_s + (c + s / steps) * period)
+            acc += x * x
+            peak = max(peak, abs(x))
+        cycle_rms.append(math.sqrt(acc / steps))
+    steady_a = sum(cycle_rms[-5:]) / 5.0
+    settled = 0
+    for c, r in enumerate(cycle_rms):
+        if abs(r - steady_a) > 0.1 * steady_a:
+            settled = c + 1
+    return {"name": name, "seconds": seconds, "v": v_rms, "hz": hz,
+            "trigger_s": trigger_s, "pre_a": fan_a, "peak_a": peak,
+            "peak_rms_a": max(cycle_rms), "steady_a": steady_a,
+            "settle_ms": settled * period * 1000.0}
+
+
+def main():
+    if len(sys.argv) != 2:
+        sys.exit(__doc__)
+    outdir = sys.argv[1]
+    os.makedirs(outdir, exist_ok=True)
+    rng = random.Random(20240607)
+
+    refs = [
+        # Carga limpia: solo cuantización
+        steady("clean", 1.0, 50.0, 220.0, 4.0, 0.90, {},
+               (1985, 2090), (0.0, 0.0), rng, outdir),
+        # Red algo baja de frecuencia, corriente distorsionada y ruido blanco
+        steady("noisy", 1.0, 49.8, 228.0, 6.0, 0.85, {3: 8.0, 5: 4.0, 7: 2.0},
+               (2010, 1960), (4.0, 5.0), rng, outdir),
+        # Sin carga: solo ruido en la corriente (debe quedar bajo el umbral)
+        steady("no_load", 1.0, 50.2, 215.0, 0.0, 1.0, {},
+               (2040, 2055), (3.0, 3.0), rng, outdir),
+        compressor_start("compressor_start", 1.5, 0.5, rng, outdir),
+    ]
+
+    with open(os.path.join(outdir, "reference.csv"), "w") as f:
+        f.write("# Generado por tools/gen_captures.py: pares [V, I] uint16 LE a %d Hz\n"
+                % PAIR_RATE_HZ)
+        f.write("# Valores del modelo (no del medidor); vacío = no se verifica\n")
+        f.write(",".join(FIELDS) + "\n")
+        for r in refs:
+            row = []
+            for k in FIELDS:
+                v = r.get(k, "")
+                row.append("%.4f" % v if isinstance(v, float) else str(v))
+            f.write(",".join(row) + "\n")
+
+
+if __name__ == "__main__":
+    main()
@@ -0,0 +1,506 @@
+/**
+ * @file ac_sensors.c
+ * @brief Tabla de sensores de temperatura: rol → dirección ROM, persistida en
+ *        NVS, con re-escaneo del bus solo cuando un sensor desaparece.
+ *        Cada bus OneWire tiene su propia tarea de adquisición: los buses
+ *        convierten y se leen en paralelo, y una sonda en corto solo tumba
+ *        las lecturas de su bus.
+ *        Los sensores con ventana de alarma (TH/TL) solo se leen completos
+ *        cada SENSORS_ALARM_FULL_MS; entre medio, tras cada conversión, un
+ *        ALARM SEARCH de dos bits alcanza para saber si salieron de rango.
+ *        Cada sensor tiene además un período mínimo entre conversiones que
+ *        fija el control según el estado (ac_sensors_set_period).
+ */
+
+#include <string.h>
+#include <stdio.h>
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include "freertos/semphr.h"
+#include "esp_log.h"
+#include "esp_timer.h"
+#include "ac_sensors.h"
+#include "ac_storage.h"
+
+static const char *TAG = "AC_SENSORS";
+
+#define SENSORS_NVS_NS         "sensors"
+#define SENSORS_NVS_KEY        "roles"
+#define SENSORS_VERSION        1
+#define SENSORS_MISSING_FAILS  3        // Fallas seguidas para darlo por perdido
+#define SENSORS_RESCAN_MS      60000    // Re-escaneo mientras falte alguno
+#define SENSORS_SCAN_MAX       AC_SENSORS_MAX
+#define SENSORS_MAX_BUSES      2
+#define SENSORS_MIN_SLEEP_MS   10
+#define SENSORS_MAX_SLEEP_MS   1000
+#define SENSORS_TASK_STACK     3072
+#define SENSORS_TASK_PRIO      5
+#define SENSORS_ALARM_FULL_MS  5000     // Lectura completa de sensores con alarma
+
+// Registro en flash: roles por nombre (el orden de la tabla puede cambiar)
+typedef struct {
+    char name[AC_SENSORS_NAME_LEN];
+    ds18b20_addr_t addr;
+} role_rec_t;
+
+typedef struct {
+    uint32_t version;
+    uint32_t count;
+    role_rec_t roles[AC_SENSORS_MAX];
+} roles_record_t;
+
+typedef struct {
+    const ac_sensor_def_t *def;
+    ds18b20_sensor_t dev;          // Solo lo toca la tarea de su bus
+    ds18b20_addr_t addr;           // Copia para reportes y NVS (con s_lock)
+    ds18b20_addr_t pending_addr;   // Reasignación pedida por MQTT
+    bool pending;
+    bool alarm_on;                 // Ventana TH/TL pedida (con s_lock)
+    bool alarm_pending;
+    int8_t alarm_tl, alarm_th;
+    int64_t next_full_us;          // Próxima lectura completa (solo con alarma)
+    volatile uint32_t period_ms;   // Mínimo entre conversiones (0 = continuo)
+    int64_t last_start_us;         // Arranque de la última conversión
+    float temp;
+    uint8_t fails;
+    bool missing;
+} sensor_slot_t;
+
+typedef struct {
+    gpio_num_t pin;
+    int slots[AC_SENSORS_MAX];     // Índices en s_slots
+    int n_slots;
+    ds18b20_addr_t found[SENSORS_SCAN_MAX];
+    int n_found;                   // -1 = nunca se escaneó
+    int64_t last_scan_us;
+    volatile bool scan_req;
+    TaskHandle_t task;
+} bus_ctx_t;
+
+static SemaphoreHandle_t s_lock = NULL;
+static SemaphoreHandle_t s_data_sem = NULL;   // Hay lecturas nuevas
+static sensor_slot_t s_slots[AC_SENSORS_MAX];
+static int s_count = 0;
+static bus_ctx_t s_bus[SENSORS_MAX_BUSES];
+static int s_n_bus = 0;
+static uint32_t s_fresh = 0;
+static bool s_report_pending = true;    // Publicar la tabla al arrancar
+
+static bool same_addr(const ds18b20_addr_t *a, const ds18b20_addr_t *b) {
+    return memcmp(a->addr, b->addr, sizeof(a->addr)) == 0;
+}
+
+static void sensors_save(void) {
+    roles_record_t rec;
+
+    memset(&rec, 0, sizeof(rec));
+    rec.version = SENSORS_VERSION;
+    rec.count = s_count;
+    xSemaphoreTake(s_lock, portMAX_DELAY);
+    for (int i = 0; i < s_count; i++) {
+        strncpy(rec.roles[i].name, s_slots[i].def->name, AC_SENSORS_NAME_LEN - 1);
+        rec.roles[i].addr = s_slots[i].addr;
+    }
+    xSemaphoreGive(s_lock);
+
+    if (!storage_data_save(SENSORS_NVS_NS, SENSORS_NVS_KEY, &rec, sizeof(rec))) {
+        ESP_LOGW(TAG, "No se pudo guardar la tabla de sensores");
+    }
+}
+
+// Solo desde la tarea del bus (o antes de crearla): hace E/S en el bus
+static void slot_assign(sensor_slot_t *slot, const ds18b20_addr_t *addr) {
+    ds18b20_sensor_init(&slot->dev, slot->def->pin, *addr, slot->def->resolution);
+    slot->dev.verify_crc = slot->def->verify_crc;
+
+    xSemaphoreTake(s_lock, portMAX_DELAY);
+    slot->alarm_pending = slot->alarm_on;   // La sonda nueva no tiene TH/TL
+    slot->next_full_us = 0;
+    slot->addr = *addr;
+    slot->fails = 0;
+    slot->missing = false;
+    s_report_pending = true;
+    xSemaphoreGive(s_lock);
+}
+
+// Enumera el bus y, si falta exactamente un rol y apareció exactamente una
+// sonda nueva, la asigna (reemplazo de sonda sin reflashear)
+static void bus_scan(bus_ctx_t *b) {
+    ds18b20_addr_t found[SENSORS_SCAN_MAX];
+    int n = ds18b20_search(b->pin, found, SENSORS_SCAN_MAX);
+    ESP_LOGI(TAG, "🔎 GPIO%d: %d sensores encontrados", b->pin, n);
+
+    sensor_slot_t *orphan_slot = NULL;
+    const ds18b20_addr_t *orphan = NULL;
+    int n_missing = 0, n_new = 0;
+
+    xSemaphoreTake(s_lock, portMAX_DELAY);
+    memcpy(b->found, found, n * sizeof(found[0]));
+    b->n_found = n;
+    b->last_scan_us = esp_timer_get_time();
+    s_report_pending = true;
+
+    for (int k = 0; k < b->n_slots; k++) {
+        sensor_slot_t *slot = &s_slots[b->slots[k]];
+        if (slot->missing) {
+            orphan_slot = slot;
+            n_missing++;
+        }
+    }
+    for (int f = 0; f < n; f++) {
+        bool known = false;
+        for (int k = 0; k < s_count; k++) known |= same_addr(&s_slots[k].addr, &found[f]);
+        if (!known) {
+            orphan = &found[f];
+            n_new++;
+        }
+    }
+    xSemaphoreGive(s_lock);
+
+    if (n_missing == 1 && n_new == 1) {
+        char hex[17];
+        ds18b20_addr_to_hex(orphan, hex);
+        ESP_LOGW(TAG, "🔁 Sonda nueva %s asignada al rol '%s'", hex, orphan_slot->def->name);
+        slot_assign(orphan_slot, orphan);
+        sensors_save();
+    } else if (n_missing > 0) {
+        ESP_LOGW(TAG, "%d roles sin sensor y %d sondas sin asignar en GPIO%d: reasignar por MQTT",
+                 n_missing, n_new, b->pin);
+    }
+}
+
+// Aplica las reasignaciones pedidas por MQTT y las ventanas de alarma
+static void bus_apply_pending(bus_ctx_t *b) {
+    bool saved = false;
+
+    for (int k = 0; k < b->n_slots; k++) {
+        sensor_slot_t *slot = &s_slots[b->slots[k]];
+        ds18b20_addr_t addr;
+
+        xSemaphoreTake(s_lock, portMAX_DELAY);
+        bool pending = slot->pending;
+        addr = slot->pending_addr;
+        slot->pending = false;
+        xSemaphoreGive(s_lock);
+
+        if (pending) {
+            slot_assign(slot, &addr);
+            saved = true;
+        }
+
+        xSemaphoreTake(s_lock, portMAX_DELAY);
+        bool alarm = slot->alarm_pending;
+        int8_t tl = slot->alarm_tl, th = slot->alarm_th;
+        slot->alarm_pending = false;
+        xSemaphoreGive(s_lock);
+
+        if (alarm && ds18b20_sensor_set_alarm(&slot->dev, tl, th) != ESP_OK) {
+            ESP_LOGW(TAG, "No se pudo programar la alarma de '%s'", slot->def->name);
+        }
+    }
+    if (saved) sensors_save();
+}
+
+// Con alarma: ALARM SEARCH tras cada conversión y lectura completa espaciada.
+// ESP_ERR_NOT_FOUND = convirtió sin alarma (ni dato nuevo ni falla).
+static esp_err_t slot_poll(sensor_slot_t *slot, float *t) {
+    int64_t now = esp_timer_get_time();
+
+    if (!slot->dev.alarm_on || now >= slot->next_full_us) {
+        esp_err_t err = ds18b20_sensor_poll(&slot->dev, t);
+        if (err == ESP_OK && slot->dev.alarm_on) {
+            slot->next_full_us = now + (int64_t)SENSORS_ALARM_FULL_MS * 1000;
+        }
+        return err;
+    }
+
+    esp_err_t err = ds18b20_sensor_poll_alarm(&slot->dev, t);
+    if (err == ESP_OK) {
+        ESP_LOGW(TAG, "🚨 Alarma en '%s': %.2f°C", slot->def->name, *t);
+    }
+    return err;
+}
+
+// Milisegundos hasta que el sensor pueda arrancar otra conversión (o terminar
+// la que tiene en curso). El período se recalcula en cada vuelta: acortarlo
+// tiene efecto inmediato.
+static uint32_t slot_wait_ms(const sensor_slot_t *slot, int64_t now) {
+    uint32_t left = ds18b20_sensor_remaining_ms(&slot->dev);
+    if (slot->dev.converting) return left;
+
+    int64_t due = slot->last_start_us + (int64_t)slot->period_ms * 1000;
+    uint32_t wait = (due > now) ? (uint32_t)((due - now + 999) / 1000) : 0;
+    return (wait > left) ? wait : left;
+}
+
+// Si todos los sensores del bus están libres y vencidos, una sola orden
+// Skip ROM + Convert T los pone a convertir a la vez
+static void bus_start_group(bus_ctx_t *b) {
+    ds18b20_sensor_t *devs[AC_SENSORS_MAX];
+    int64_t now = esp_timer_get_time();
+
+    if (b->n_slots < 2) return;
+    for (int k = 0; k < b->n_slots; k++) {
+        sensor_slot_t *slot = &s_slots[b->slots[k]];
+        if (slot->dev.converting || slot_wait_ms(slot, now) > 0) return;
+        devs[k] = &slot->dev;
+    }
+    ds18b20_sensor_start_bus(devs, b->n_slots);
+    for (int k = 0; k < b->n_slots; k++) s_slots[b->slots[k]].last_start_us = now;
+}
+
+static void bus_task(void *pv) {
+    bus_ctx_t *b = pv;
+
+    while (1) {
+        bus_apply_pending(b);
+        bus_start_group(b);
+
+        bool any_missing = false;
+        bool fresh = false;
+        for (int k = 0; k < b->n_slots; k++) {
+            int idx = b->slots[k];
+            sensor_slot_t *slot = &s_slots[idx];
+            float t;
+            int64_t now = esp_timer_get_time();
+            bool was_converting = slot->dev.converting;
+            esp_err_t err = ESP_ERR_NOT_FINISHED;
+
+            // Fuera de período no se toca el bus
+            if (was_converting || slot_wait_ms(slot, now) == 0) err = slot_poll(slot, &t);
+            if (!was_converting && slot->dev.converting) slot->last_start_us = now;
+
+            xSemaphoreTake(s_lock, portMAX_DELAY);
+            if (err == ESP_OK) {
+                slot->temp = t;
+                s_fresh |= (1u << idx);
+                fresh = true;
+                slot->fails = 0;
+                if (slot->missing) {
+                    slot->missing = false;
+                    s_report_pending = true;
+                    ESP_LOGI(TAG, "✅ Sensor '%s' recuperado", slot->def->name);
+                }
+            } else if (err != ESP_ERR_NOT_FINISHED && err != ESP_ERR_NOT_FOUND &&
+                       slot->fails < SENSORS_MISSING_FAILS) {
+                if (++slot->fails == SENSORS_MISSING_FAILS) {
+                    slot->missing = true;
+                    s_report_pending = true;
+                    ESP_LOGW(TAG, "⚠️ Sensor '%s' no responde", slot->def->name);
+                }
+            }
+            any_missing |= slot->missing;
+            xSemaphoreGive(s_lock);
+        }
+        if (fresh) xSemaphoreGive(s_data_sem);
+
+        // Escaneo completo solo a pedido o mientras falte algún sensor
+        int64_t now = esp_timer_get_time();
+        bool rescan_due = any_missing &&
+            (b->n_found < 0 || (now - b->last_scan_us) >= (int64_t)SENSORS_RESCAN_MS * 1000);
+        if (b->scan_req || rescan_due) {
+            b->scan_req = false;
+            bus_scan(b);
+        }
+
+        // Dormir hasta el próximo sensor listo o vencido (o hasta un pedido)
+        uint32_t sleep_ms = SENSORS_MAX_SLEEP_MS;
+        now = esp_timer_get_time();
+        for (int k = 0; k < b->n_slots; k++) {
+            uint32_t left = slot_wait_ms(&s_slots[b->slots[k]], now);
+            if (left < sleep_ms) sleep_ms = left;
+        }
+        if (sleep_ms < SENSORS_MIN_SLEEP_MS) sleep_ms = SENSORS_MIN_SLEEP_MS;
+        ulTaskNotifyTake(pdTRUE, pdMS_TO_TICKS(sleep_ms));
+    }
+}
+
+static bus_ctx_t *bus_for(gpio_num_t pin) {
+    for (int i = 0; i < s_n_bus; i++) {
+        if (s_bus[i].pin == pin) return &s_bus[i];
+    }
+    if (s_n_bus >= SENSORS_MAX_BUSES) return NULL;
+
+    bus_ctx_t *b = &s_bus[s_n_bus++];
+    memset(b, 0, sizeof(*b));
+    b->pin = pin;
+    b->n_found = -1;
+    ds18b20_init_bus(pin);
+    return b;
+}
+
+void ac_sensors_init(const ac_sensor_def_t *defs, int count) {
+    roles_record_t rec;
+    bool have_rec;
+
+    if (count > AC_SENSORS_MAX) count = AC_SENSORS_MAX;
+    s_lock = xSemaphoreCreateMutex();
+    s_data_sem = xSemaphoreCreateBinary();
+    have_rec = storage_data_load(SENSORS_NVS_NS, SENSORS_NVS_KEY, &rec, sizeof(rec)) &&
+               rec.version == SENSORS_VERSION;
+
+    for (int i = 0; i < count; i++) {
+        sensor_slot_t *slot = &s_slots[i];
+        ds18b20_addr_t addr = defs[i].default_addr;
+
+        for (uint32_t k = 0; have_rec && k < rec.count && k < AC_SENSORS_MAX; k++) {
+            if (strncmp(rec.roles[k].name, defs[i].name, AC_SENSORS_NAME_LEN) == 0) {
+                addr = rec.roles[k].addr;
+                break;
+            }
+        }
+
+        bus_ctx_t *b = bus_for(defs[i].pin);
+        if (!b) {
+            ESP_LOGE(TAG, "Sin lugar para el bus GPIO%d (rol '%s')", defs[i].pin, defs[i].name);
+            continue;
+        }
+        memset(slot, 0, sizeof(*slot));
+        slot->def = &defs[i];
+        slot_assign(slot, &addr);
+        b->slots[b->n_slots++] = i;
+    }
+    s_count = count;
+
+    for (int i = 0; i < s_n_bus; i++) {
+        char name[16];
+        snprintf(name, sizeof(name), "OwBus%d", s_bus[i].pin);
+        xTaskCreate(bus_task, name, SENSORS_TASK_STACK, &s_bus[i], SENSORS_TASK_PRIO, &s_bus[i].task);
+    }
+    ESP_LOGI(TAG, "%d sensores en %d buses desde %s", count, s_n_bus,
+             have_rec ? "tabla en NVS" : "direcciones por defecto");
+}
+
+uint32_t ac_sensors_poll(float *temps) {
+    xSemaphoreTake(s_lock, portMAX_DELAY);
+    uint32_t fresh = s_fresh;
+    for (int i = 0; i < s_count; i++) {
+        if (fresh & (1u << i)) temps[i] = s_slots[i].temp;
+    }
+    s_fresh = 0;
+    xSemaphoreGive(s_lock);
+    return fresh;
+}
+
+bool ac_sensors_wait(uint32_t timeout_ms) {
+    return xSemaphoreTake(s_data_sem, pdMS_TO_TICKS(timeout_ms)) == pdTRUE;
+}
+
+esp_err_t ac_sensors_assign(const char *name, const char *rom_hex) {
+    ds18b20_addr_t addr;
+
+    if (!ds18b20_addr_from_hex(rom_hex, &addr)) return ESP_ERR_INVALID_ARG;
+
+    for (int b = 0; b < s_n_bus; b++) {
+        for (int k = 0; k < s_bus[b].n_slots; k++) {
+            sensor_slot_t *slot = &s_slots[s_bus[b].slots[k]];
+            if (strcmp(slot->def->name, name) != 0) continue;
+
+            // La aplica la tarea del bus: es la única que lo usa
+            xSemaphoreTake(s_lock, portMAX_DELAY);
+            slot->pending_addr = addr;
+            slot->pending = true;
+            xSemaphoreGive(s_lock);
+            xTaskNotifyGive(s_bus[b].task);
+            ESP_LOGI(TAG, "Rol '%s' → %s", name, rom_hex);
+            return ESP_OK;
+        }
+    }
+    return ESP_ERR_NOT_FOUND;
+}
+
+static void bus_notify(gpio_num_t pin) {
+    for (int b = 0; b < s_n_bus; b++) {
+        if (s_bus[b].pin == pin) xTaskNotifyGive(s_bus[b].task);
+    }
+}
+
+void ac_sensors_set_period(int idx, uint32_t period_ms) {
+    if (idx < 0 || idx >= s_count || s_slots[idx].period_ms == period_ms) return;
+
+    s_slots[idx].period_ms = period_ms;
+    bus_notify(s_slots[idx].def->pin);
+}
+
+void ac_sensors_set_alarm(int idx, int8_t tl, int8_t th) {
+    if (idx < 0 || idx >= s_count) return;
+
+    xSemaphoreTake(s_lock, portMAX_DELAY);
+    sensor_slot_t *slot = &s_slots[idx];
+    bool changed = !slot->alarm_on || slot->alarm_tl != tl || slot->alarm_th != th;
+    slot->alarm_on = true;
+    slot->alarm_tl = tl;
+    slot->alarm_th = th;
+    slot->alarm_pending |= changed;
+    xSemaphoreGive(s_lock);
+
+    if (changed) bus_notify(slot->def->pin);
+}
+
+void ac_sensors_request_scan(void) {
+    for (int i = 0; i < s_n_bus; i++) {
+        s_bus[i].scan_req = true;
+        xTaskNotifyGive(s_bus[i].task);
+    }
+}
+
+bool ac_sensors_take_report(char *buf, size_t len) {
+    char hex[17];
+    size_t pos = 0;
+
+    xSemaphoreTake(s_lock, portMAX_DELAY);
+    if (!s_report_pending) {
+        xSemaphoreGive(s_lock);
+        return false;
+    }
+    s_report_pending = false;
+
+    bool ok = true;
+#define APPEND(...) do { \
+        int w_ = snprintf((pos < len) ? buf + pos : NULL, (pos < len) ? len - pos : 0, __VA_ARGS__); \
+        if (w_ < 0) ok = false; \
+        else pos += (size_t)w_; \
+    } while (0)
+
+    APPEND("{\"roles\":{");
+    for (int i = 0; i < s_count; i++) {
+        ds18b20_addr_to_hex(&s_slots[i].addr, hex);
+        APPEND("%s\"%s\":\"%s\"", i ? "," : "", s_slots[i].def->name, hex);
+    }
+    APPEND("},\"missing\":[");
+    bool first = true;
+    for (int i = 0; i < s_count; i++) {
+        if (!s_slots[i].missing) continue;
+        APPEND("%s\"%s\"", first ? "" : ",", s_slots[i].def->name);
+        first = false;
+    }
+    APPEND("],\"found\":[");
+    first = true;
+    for (int b = 0; b < s_n_bus; b++) {
+        for (int f = 0; f < s_bus[b].n_found; f++) {
+            ds18b20_addr_to_hex(&s_bus[b].found[f], hex);
+            APPEND("%s\"%s\"", first ? "" : ",", hex);
+            first = false;
+        }
+    }
+    APPEND("]}");
+#undef APPEND
+
+    xSemaphoreGive(s_lock);
+
+    // Truncado no es JSON válido: no se entrega. Reintentar no sirve (el
+    // tamaño no cambia hasta que cambie la tabla, y eso vuelve a pedirlo).
+    if (!ok || pos >= len) {
+        ESP_LOGE(TAG, "Reporte de sensores descartado: requiere %u B, buffer de %u B",
+                 (unsigned)pos + 1, (unsigned)len);
+        if (len > 0) buf[0] = '\0';
+        return false;
+    }
+    return true;
+}
+
+void ac_sensors_report_failed(void) {
+    xSemaphoreTake(s_lock, portMAX_DELAY);
+    s_report_pending = true;
+    xSemaphoreGive(s_lock);
+}
@@ -0,0 +1,96 @@
+#pragma once
+#include <stdint.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include "driver/gpio.h"
+#include "esp_err.h"
+#include "ds18b20.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define AC_SENSORS_MAX      8
+#define AC_SENSORS_NAME_LEN 8   // Incluye el terminador
+
+// Definición de un rol de sensor (tabla en main)
+typedef struct {
+    const char *name;              // Nombre del rol en JSON/MQTT (ej. "coil")
+    gpio_num_t pin;                // Bus OneWire donde está conectado
+    uint8_t resolution;            // 9-12 bits
+    bool verify_crc;               // true = siempre scratchpad completo con CRC
+    ds18b20_addr_t default_addr;   // Dirección de fábrica si no hay tabla en NVS
+} ac_sensor_def_t;
+
+/**
+ * @brief Arranca los buses y los sensores con la tabla rol→ROM guardada
+ *        en NVS (o las direcciones por defecto). No escanea el bus.
+ *        Crea una tarea de adquisición por bus: cada bus convierte y se lee
+ *        a su propio ritmo, en paralelo con los demás.
+ * @param defs Tabla de roles (debe seguir viva: se guarda el puntero)
+ */
+void ac_sensors_init(const ac_sensor_def_t *defs, int count);
+
+/**
+ * @brief Toma las lecturas nuevas desde la última consulta (no bloquea).
+ *        Si un sensor falla varias veces seguidas se re-escanea su bus.
+ * @param temps Arreglo de count temperaturas; solo se escriben las nuevas
+ * @return Máscara de bits: bit i = el sensor i tiene lectura nueva
+ */
+uint32_t ac_sensors_poll(float *temps);
+
+/**
+ * @brief Espera hasta que algún bus entregue una lectura nueva.
+ * @return true si hay datos, false si venció el timeout
+ */
+bool ac_sensors_wait(uint32_t timeout_ms);
+
+/**
+ * @brief Reasigna un rol a una dirección ROM (hex de 16 caracteres) y lo guarda.
+ */
+esp_err_t ac_sensors_assign(const char *name, const char *rom_hex);
+
+/**
+ * @brief Fija el período mínimo entre conversiones de un sensor (0 = continuo:
+ *        convierte de nuevo apenas se lee). Acortarlo tiene efecto inmediato.
+ *        Pensado para que el control lo ajuste según su estado en cada vuelta:
+ *        solo despierta al bus si el período cambió.
+ */
+void ac_sensors_set_period(int idx, uint32_t period_ms);
+
+/**
+ * @brief Programa la ventana de alarma TH/TL de un sensor (°C, parte entera).
+ *        Desde entonces su bus lo lee completo solo cada pocos segundos y,
+ *        tras cada conversión, consulta ALARM SEARCH: si salió de la ventana
+ *        se lee en el acto y la lectura llega como dato nuevo.
+ *        No bloquea; la aplica la tarea del bus.
+ * @param idx Índice del sensor en la tabla de ac_sensors_init
+ * @param tl Alarma si la temperatura ≤ tl
+ * @param th Alarma si la temperatura ≥ th
+ */
+void ac_sensors_set_alarm(int idx, int8_t tl, int8_t th);
+
+/**
+ * @brief Pide un escaneo completo de los buses en la próxima consulta.
+ */
+void ac_sensors_request_scan(void);
+
+/**
+ * @brief Entrega el JSON de la tabla (roles, faltantes y último escaneo)
+ *        cuando cambió. Una vez por cambio: si no se pudo enviar, llamar a
+ *        ac_sensors_report_failed() para que vuelva a salir.
+ * @return true si se escribió un reporte nuevo en buf. false si no había
+ *         cambios o si el JSON no entraba en len (se descarta y se avisa
+ *         por log; nunca se entrega truncado).
+ */
+bool ac_sensors_take_report(char *buf, size_t len);
+
+/**
+ * @brief El reporte tomado con ac_sensors_take_report no se pudo publicar:
+ *        queda pendiente otra vez.
+ */
+void ac_sensors_report_failed(void);
+
+#ifdef __cplusplus
+}
+#endif
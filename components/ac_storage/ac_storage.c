@@ -1,8 +1,11 @@
+#include <string.h>
 #include "ac_storage.h"
 #include "nvs_flash.h"
 #include "nvs.h"
 #include "esp_log.h"
 
+static const char *TAG = "STORAGE";
+
 void storage_init(void) {
     esp_err_t ret = nvs_flash_init();
     if (ret == ESP_ERR_NVS_NO_FREE_PAGES || ret == ESP_ERR_NVS_NEW_VERSION_FOUND) {
@@ -10,6 +13,16 @@ void storage_init(void) {
         ret = nvs_flash_init();
     }
     ESP_ERROR_CHECK(ret);
+
+    // Partición de datos: si falla no es crítico, solo se pierde persistencia
+    ret = nvs_flash_init_partition(STORAGE_DATA_PARTITION);
+    if (ret == ESP_ERR_NVS_NO_FREE_PAGES || ret == ESP_ERR_NVS_NEW_VERSION_FOUND) {
+        nvs_flash_erase_partition(STORAGE_DATA_PARTITION);
+        ret = nvs_flash_init_partition(STORAGE_DATA_PARTITION);
+    }
+    if (ret != ESP_OK) {
+        ESP_LOGE(TAG, "No se pudo iniciar la partición '%s' (%s)", STORAGE_DATA_PARTITION, esp_err_to_name(ret));
+    }
 }
 
 void storage_save(sys_config_t *cfg) {
@@ -24,8 +37,46 @@ void storage_save(sys_config_t *cfg) {
 bool storage_load(sys_config_t *cfg) {
     nvs_handle_t h;
     if (nvs_open("ac_storage", NVS_READONLY, &h) != ESP_OK) return false;
+    // Un blob de una versión anterior es más corto: lo que no trae queda en 0
+    memset(cfg, 0, sizeof(sys_config_t));
     size_t len = sizeof(sys_config_t);
     esp_err_t err = nvs_get_blob(h, "config", cfg, &len);
     nvs_close(h);
     return (err == ESP_OK);
 }
+
+bool storage_data_save(const char *ns, const char *key, const void *data, size_t len) {
+    nvs_handle_t h;
+    if (nvs_open_from_partition(STORAGE_DATA_PARTITION, ns, NVS_READWRITE, &h) != ESP_OK) return false;
+    esp_err_t err = nvs_set_blob(h, key, data, len);
+    if (err == ESP_OK) err = nvs_commit(h);
+    nvs_close(h);
+    return (err == ESP_OK);
+}
+
+bool storage_data_load(const char *ns, const char *key, void *data, size_t len) {
+    nvs_handle_t h;
+    if (nvs_open_from_partition(STORAGE_DATA_PARTITION, ns, NVS_READONLY, &h) != ESP_OK) return false;
+    size_t stored = len;
+    esp_err_t err = nvs_get_blob(h, key, data, &stored);
+    nvs_close(h);
+    return (err == ESP_OK && stored == len);
+}
+
+bool storage_data_load_var(const char *ns, const char *key, void *data, size_t max, size_t *len) {
+    nvs_handle_t h;
+    if (nvs_open_from_partition(STORAGE_DATA_PARTITION, ns, NVS_READONLY, &h) != ESP_OK) return false;
+    *len = max;
+    esp_err_t err = nvs_get_blob(h, key, data, len);   // ESP_ERR_NVS_INVALID_LENGTH si no entra
+    nvs_close(h);
+    return (err == ESP_OK);
+}
+
+bool storage_data_erase_ns(const char *ns) {
+    nvs_handle_t h;
+    if (nvs_open_from_partition(STORAGE_DATA_PARTITION, ns, NVS_READWRITE, &h) != ESP_OK) return false;
+    esp_err_t err = nvs_erase_all(h);
+    if (err == ESP_OK) err = nvs_commit(h);
+    nvs_close(h);
+    return (err == ESP_OK);
+}
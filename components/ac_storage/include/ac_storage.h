@@ -1,18 +1,49 @@
 #pragma once
 #include <stdbool.h>
+#include <stddef.h>
 
 // Modos de operación
 #define MODE_OFF  0
 #define MODE_COOL 1
 #define MODE_FAN  2
 
+// Partición NVS de datos (ver partitions.csv), separada de la configuración
+#define STORAGE_DATA_PARTITION "storage"
+
 typedef struct {
     float setpoint;
     int fan_speed;
     bool system_on;
     int mode;  // 0=OFF, 1=FRIO, 2=VENTILACION
+    // Campos nuevos siempre al final: un blob viejo (más corto) los deja en 0
+    int tlm_format;  // Payload de telemetría/estado: 0=JSON, 1=CBOR (tlm_codec)
+    int agg_period_s; // Ventana de telemetría agregada en s (0 = muestra suelta)
 } sys_config_t;
 
 void storage_init(void);
 void storage_save(sys_config_t *cfg);
 bool storage_load(sys_config_t *cfg);
+
+/**
+ * @brief Guarda un blob en la partición de datos (contadores, históricos).
+ * @return true si se escribió y confirmó (commit)
+ */
+bool storage_data_save(const char *ns, const char *key, const void *data, size_t len);
+
+/**
+ * @brief Lee un blob de la partición de datos. Falla si el tamaño no coincide.
+ */
+bool storage_data_load(const char *ns, const char *key, void *data, size_t len);
+
+/**
+ * @brief Lee un blob de largo variable (hasta max bytes).
+ * @param len Bytes leídos
+ * @return false si no existe o no entra en max
+ */
+bool storage_data_load_var(const char *ns, const char *key, void *data, size_t max, size_t *len);
+
+/**
+ * @brief Borra todas las claves de un espacio de nombres de la partición de
+ *        datos (ej. un formato viejo que ya no se lee).
+ */
+bool storage_data_erase_ns(const char *ns);
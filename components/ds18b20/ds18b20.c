@@ -1,128 +1,488 @@
+#include <stdio.h>
+#include <string.h>
+#include <math.h>
 #include "ds18b20.h"
-#include "esp_rom_sys.h"
+#include "onewire_bus.h"
 #include "freertos/FreeRTOS.h"
-#include "freertos/task.h"
+#include "esp_log.h"
+#include "esp_timer.h"
 
-// Spinlock para proteger la comunicación de interrupciones
-static portMUX_TYPE ds18b20_spinlock = portMUX_INITIALIZER_UNLOCKED;
+static const char *TAG = "DS18B20";
 
-// Tiempos OneWire estándar
-#define DELAY_RESET 480
-#define DELAY_WRITE_1 6
-#define DELAY_WRITE_0 60
-#define DELAY_READ_SAMPLE 9
+// Comandos OneWire / DS18B20
+#define CMD_SKIP_ROM        0xCC
+#define CMD_MATCH_ROM       0x55
+#define CMD_SEARCH_ROM      0xF0
+#define CMD_CONVERT_T       0x44
+#define CMD_READ_SCRATCHPAD 0xBE
+#define CMD_WRITE_SCRATCHPAD 0x4E
+#define CMD_ALARM_SEARCH    0xEC
 
-static void _delay_us(uint32_t us) {
-    esp_rom_delay_us(us);
+// Tiempo máximo de conversión a 12 bits; se divide por 2 por cada bit menos
+#define CONV_MS_12BIT       750
+#define RETRY_MS            1000   // Espera tras una falla antes de reintentar
+#define CRC_RETRIES         2      // Relecturas con CRC ante un dato dudoso
+#define JUMP_LIMIT_C        10.0f  // Salto entre lecturas que se considera sospechoso
+#define POWER_ON_RAW        0x0550 // 85°C: valor del scratchpad tras un reset del sensor
+#define FAMILY_DS18B20      0x28   // Primer byte de la ROM
+
+static onewire_bus_t s_buses[ONEWIRE_MAX_BUSES];
+static ds18b20_stats_t s_stats;   // Acumulado de todos los sensores
+// Una tarea por bus (en cualquier núcleo) suma a s_stats: spinlock por
+// contador y para la copia, dentro solo un incremento o un memcpy
+static portMUX_TYPE s_stats_lock = portMUX_INITIALIZER_UNLOCKED;
+static int s_n_buses = 0;
+
+#define ONEWIRE_ALARM_MAX   4      // Sensores en alarma que se distinguen por bus
+
+static onewire_bus_t *_bus(gpio_num_t pin) {
+    for (int i = 0; i < s_n_buses; i++) {
+        if (s_buses[i].pin == pin) return &s_buses[i];
+    }
+    return NULL;
 }
 
 void ds18b20_init_bus(gpio_num_t pin) {
-    gpio_reset_pin(pin);
-    gpio_set_direction(pin, GPIO_MODE_INPUT_OUTPUT_OD);
-    gpio_set_pull_mode(pin, GPIO_PULLUP_ENABLE);
-}
-
-// Reset del bus: Devuelve true si alguien responde (Presence Pulse)
-static bool _onewire_reset(gpio_num_t pin) {
-    gpio_set_level(pin, 0);
-    _delay_us(DELAY_RESET);
-    gpio_set_level(pin, 1);
-    _delay_us(70);
-    int presence = gpio_get_level(pin);
-    _delay_us(410);
-    return (presence == 0);
-}
-
-static void _onewire_write_bit(gpio_num_t pin, int bit) {
-    gpio_set_level(pin, 0);
-    if (bit) {
-        _delay_us(DELAY_WRITE_1);
-        gpio_set_level(pin, 1);
-        _delay_us(64);
-    } else {
-        _delay_us(DELAY_WRITE_0);
-        gpio_set_level(pin, 1);
-        _delay_us(10);
+    if (_bus(pin)) return;
+    if (s_n_buses >= ONEWIRE_MAX_BUSES) {
+        ESP_LOGE(TAG, "Demasiados buses OneWire (máx %d)", ONEWIRE_MAX_BUSES);
+        return;
+    }
+
+    onewire_bus_t *bus = &s_buses[s_n_buses];
+    // RMT genera los slots por hardware; si no hay canales libres, bit-bang
+    if (onewire_rmt_init(bus, pin) != ESP_OK) {
+        onewire_gpio_init(bus, pin);
     }
+    s_n_buses++;
+    ESP_LOGI(TAG, "Bus OneWire en GPIO%d (backend %s)", pin, bus->backend);
+}
+
+// CRC8 Dallas/Maxim (X^8 + X^5 + X^4 + 1, LSB primero), un byte por consulta
+static const uint8_t CRC8_TABLE[256] = {
+    0x00, 0x5E, 0xBC, 0xE2, 0x61, 0x3F, 0xDD, 0x83, 0xC2, 0x9C, 0x7E, 0x20, 0xA3, 0xFD, 0x1F, 0x41,
+    0x9D, 0xC3, 0x21, 0x7F, 0xFC, 0xA2, 0x40, 0x1E, 0x5F, 0x01, 0xE3, 0xBD, 0x3E, 0x60, 0x82, 0xDC,
+    0x23, 0x7D, 0x9F, 0xC1, 0x42, 0x1C, 0xFE, 0xA0, 0xE1, 0xBF, 0x5D, 0x03, 0x80, 0xDE, 0x3C, 0x62,
+    0xBE, 0xE0, 0x02, 0x5C, 0xDF, 0x81, 0x63, 0x3D, 0x7C, 0x22, 0xC0, 0x9E, 0x1D, 0x43, 0xA1, 0xFF,
+    0x46, 0x18, 0xFA, 0xA4, 0x27, 0x79, 0x9B, 0xC5, 0x84, 0xDA, 0x38, 0x66, 0xE5, 0xBB, 0x59, 0x07,
+    0xDB, 0x85, 0x67, 0x39, 0xBA, 0xE4, 0x06, 0x58, 0x19, 0x47, 0xA5, 0xFB, 0x78, 0x26, 0xC4, 0x9A,
+    0x65, 0x3B, 0xD9, 0x87, 0x04, 0x5A, 0xB8, 0xE6, 0xA7, 0xF9, 0x1B, 0x45, 0xC6, 0x98, 0x7A, 0x24,
+    0xF8, 0xA6, 0x44, 0x1A, 0x99, 0xC7, 0x25, 0x7B, 0x3A, 0x64, 0x86, 0xD8, 0x5B, 0x05, 0xE7, 0xB9,
+    0x8C, 0xD2, 0x30, 0x6E, 0xED, 0xB3, 0x51, 0x0F, 0x4E, 0x10, 0xF2, 0xAC, 0x2F, 0x71, 0x93, 0xCD,
+    0x11, 0x4F, 0xAD, 0xF3, 0x70, 0x2E, 0xCC, 0x92, 0xD3, 0x8D, 0x6F, 0x31, 0xB2, 0xEC, 0x0E, 0x50,
+    0xAF, 0xF1, 0x13, 0x4D, 0xCE, 0x90, 0x72, 0x2C, 0x6D, 0x33, 0xD1, 0x8F, 0x0C, 0x52, 0xB0, 0xEE,
+    0x32, 0x6C, 0x8E, 0xD0, 0x53, 0x0D, 0xEF, 0xB1, 0xF0, 0xAE, 0x4C, 0x12, 0x91, 0xCF, 0x2D, 0x73,
+    0xCA, 0x94, 0x76, 0x28, 0xAB, 0xF5, 0x17, 0x49, 0x08, 0x56, 0xB4, 0xEA, 0x69, 0x37, 0xD5, 0x8B,
+    0x57, 0x09, 0xEB, 0xB5, 0x36, 0x68, 0x8A, 0xD4, 0x95, 0xCB, 0x29, 0x77, 0xF4, 0xAA, 0x48, 0x16,
+    0xE9, 0xB7, 0x55, 0x0B, 0x88, 0xD6, 0x34, 0x6A, 0x2B, 0x75, 0x97, 0xC9, 0x4A, 0x14, 0xF6, 0xA8,
+    0x74, 0x2A, 0xC8, 0x96, 0x15, 0x4B, 0xA9, 0xF7, 0xB6, 0xE8, 0x0A, 0x54, 0xD7, 0x89, 0x6B, 0x35,
+};
+
+static uint8_t _crc8(const uint8_t *data, size_t len) {
+    uint8_t crc = 0;
+    for (size_t i = 0; i < len; i++) crc = CRC8_TABLE[crc ^ data[i]];
+    return crc;
 }
 
-static int _onewire_read_bit(gpio_num_t pin) {
-    int bit = 0;
-    gpio_set_level(pin, 0);
-    _delay_us(6);
-    gpio_set_level(pin, 1);
-    _delay_us(DELAY_READ_SAMPLE);
-    bit = gpio_get_level(pin);
-    _delay_us(55);
-    return bit;
+// ROM de un DS18B20: familia 0x28 y CRC válido. El CRC solo no alcanza: la
+// ROM todo ceros (bus en corto a masa) tiene CRC 0 y lo pasa.
+static bool _rom_valid(const uint8_t rom[8]) {
+    return rom[0] == FAMILY_DS18B20 && _crc8(rom, 7) == rom[7];
 }
 
-static void _onewire_write_byte(gpio_num_t pin, uint8_t data) {
+static bool _rom_zero(const uint8_t rom[8]) {
     for (int i = 0; i < 8; i++) {
-        _onewire_write_bit(pin, (data >> i) & 1);
+        if (rom[i]) return false;
     }
+    return true;
 }
 
-static uint8_t _onewire_read_byte(gpio_num_t pin) {
-    uint8_t data = 0;
-    for (int i = 0; i < 8; i++) {
-        data |= (_onewire_read_bit(pin) << i);
-    }
-    return data;
+// Reset + Match ROM: deja al sensor direccionado listo para un comando
+static esp_err_t _select(onewire_bus_t *bus, const ds18b20_addr_t *address) {
+    if (!bus->reset(bus)) return ESP_ERR_TIMEOUT;
+
+    uint8_t cmd[9];
+    cmd[0] = CMD_MATCH_ROM;
+    for (int i = 0; i < 8; i++) cmd[1 + i] = address->addr[i];
+    return bus->write_bytes(bus, cmd, sizeof(cmd));
+}
+
+// Lee los primeros n bytes del scratchpad. Si no se leen los 9, un reset
+// corta la transferencia (el sensor deja de transmitir).
+static esp_err_t _read_scratchpad(onewire_bus_t *bus, const ds18b20_addr_t *address, uint8_t *sp, size_t n) {
+    esp_err_t err = _select(bus, address);
+    if (err != ESP_OK) return err;
+
+    const uint8_t cmd = CMD_READ_SCRATCHPAD;
+    if (bus->write_bytes(bus, &cmd, 1) != ESP_OK) return ESP_FAIL;
+    if (bus->read_bytes(bus, sp, n) != ESP_OK) return ESP_ERR_TIMEOUT;
+    if (n < 9) bus->reset(bus);
+    return ESP_OK;
+}
+
+// Scratchpad completo con CRC. Todo ceros da CRC válido (bus en corto a masa):
+// el byte de configuración siempre tiene los 5 bits bajos en 1.
+static esp_err_t _read_scratchpad_crc(onewire_bus_t *bus, const ds18b20_addr_t *address, uint8_t sp[9]) {
+    esp_err_t err = _read_scratchpad(bus, address, sp, 9);
+    if (err != ESP_OK) return err;
+    if (_crc8(sp, 8) != sp[8]) return ESP_ERR_INVALID_CRC;
+    if ((sp[4] & 0x1F) != 0x1F) return ESP_ERR_INVALID_RESPONSE;
+    return ESP_OK;
+}
+
+// Temperatura del scratchpad. Con menos de 12 bits los bits bajos quedan indefinidos.
+static esp_err_t _decode_temp(const uint8_t sp[9], uint8_t resolution, float *temp) {
+    int16_t raw = (sp[1] << 8) | sp[0];
+
+    // Si leemos 0xFFFF (-1), es error de desconexión
+    if (raw == -1) return ESP_ERR_TIMEOUT;
+
+    raw &= ~((1 << (12 - resolution)) - 1);
+    float t = (float)raw / 16.0f;
+
+    // Filtro básico de valores imposibles
+    if (t < -55.0 || t > 125.0) return ESP_FAIL;
+
+    *temp = t;
+    return ESP_OK;
+}
+
+// Write Scratchpad: TH, TL y configuración van siempre juntos
+static esp_err_t _write_config(onewire_bus_t *bus, const ds18b20_addr_t *address,
+                               uint8_t th, uint8_t tl, uint8_t resolution) {
+    esp_err_t err = _select(bus, address);
+    if (err != ESP_OK) return err;
+    const uint8_t cmd[4] = { CMD_WRITE_SCRATCHPAD, th, tl, (uint8_t)(((resolution - 9) << 5) | 0x1F) };
+    return bus->write_bytes(bus, cmd, sizeof(cmd));
 }
 
 // Manda a convertir a TODOS (aquí sí usamos Skip ROM porque no leemos nada de vuelta)
 esp_err_t ds18b20_convert_all(gpio_num_t pin) {
-    portENTER_CRITICAL_SAFE(&ds18b20_spinlock);
-    if (!_onewire_reset(pin)) {
-        portEXIT_CRITICAL_SAFE(&ds18b20_spinlock);
+    onewire_bus_t *bus = _bus(pin);
+    if (!bus) return ESP_ERR_INVALID_STATE;
+
+    if (!bus->reset(bus)) {
         return ESP_FAIL; // Nadie conectado
     }
-    _onewire_write_byte(pin, 0xCC); // Skip ROM
-    _onewire_write_byte(pin, 0x44); // Convert T
-    portEXIT_CRITICAL_SAFE(&ds18b20_spinlock);
+    const uint8_t cmd[2] = { CMD_SKIP_ROM, CMD_CONVERT_T };
     
     // IMPORTANTE: El usuario debe esperar 750ms después de esto
-    return ESP_OK; 
+    return bus->write_bytes(bus, cmd, sizeof(cmd));
 }
 
-// Lee UNO solo usando su dirección
+// Lee UNO solo usando su dirección (Match ROM, evita colisiones en el bus)
 esp_err_t ds18b20_read_one(gpio_num_t pin, ds18b20_addr_t address, float *temp) {
-    portENTER_CRITICAL_SAFE(&ds18b20_spinlock);
-    
-    if (!_onewire_reset(pin)) {
-        portEXIT_CRITICAL_SAFE(&ds18b20_spinlock);
-        return ESP_ERR_TIMEOUT;
+    onewire_bus_t *bus = _bus(pin);
+    if (!bus) return ESP_ERR_INVALID_STATE;
+
+    uint8_t sp[9];
+    esp_err_t err = _read_scratchpad_crc(bus, &address, sp);
+    if (err == ESP_ERR_INVALID_CRC) {
+        portENTER_CRITICAL(&s_stats_lock);
+        s_stats.crc_errors++;
+        portEXIT_CRITICAL(&s_stats_lock);
     }
+    if (err != ESP_OK) return err;
+    return _decode_temp(sp, 12, temp);
+}
 
-    // AQUI ESTÁ LA CLAVE: Usamos Match ROM (0x55) en vez de Skip ROM
-    _onewire_write_byte(pin, 0x55); 
-    
-    // Enviamos los 8 bytes de la dirección del sensor
+// SEARCH ROM / ALARM SEARCH (algoritmo de Maxim AN187): recorre el árbol de
+// direcciones eligiendo en cada discrepancia la rama que queda pendiente.
+// Devuelve -1 si nadie responde al primer reset o si el bus está tomado en
+// bajo (se lee la ROM todo ceros: no es un sensor ni "sin alarma").
+static int _search(onewire_bus_t *bus, uint8_t search_cmd, ds18b20_addr_t *found, int max) {
+    uint8_t rom[8] = {0};
+    int last_discrepancy = 0;
+    bool last_device = false;
+    int n = 0;
+
+    while (!last_device && n < max) {
+        if (!bus->reset(bus)) return n ? n : -1;   // Nadie en el bus
+        if (bus->write_bytes(bus, &search_cmd, 1) != ESP_OK) break;
+
+        int last_zero = 0;
+        for (int bit = 1; bit <= 64; bit++) {
+            int idx = (bit - 1) / 8;
+            uint8_t mask = 1 << ((bit - 1) % 8);
+            int b = bus->read_bit(bus);
+            int cb = bus->read_bit(bus);
+            if (b < 0 || cb < 0 || (b && cb)) return n;   // Error, nadie en alarma o sensor desconectado
+
+            int dir;
+            if (b != cb) {
+                dir = b;   // Todos los que quedan coinciden en este bit
+            } else {
+                // Discrepancia: repetir el camino anterior hasta la última, ahí tomar el 1
+                if (bit < last_discrepancy) dir = (rom[idx] & mask) ? 1 : 0;
+                else dir = (bit == last_discrepancy);
+                if (dir == 0) last_zero = bit;
+            }
+
+            if (dir) rom[idx] |= mask;
+            else rom[idx] &= ~mask;
+            if (bus->write_bit(bus, dir) != ESP_OK) return n;
+        }
+
+        last_discrepancy = last_zero;
+        if (last_discrepancy == 0) last_device = true;
+
+        if (_rom_zero(rom)) {
+            ESP_LOGW(TAG, "Bus en bajo en GPIO%d (ROM todo ceros), búsqueda abortada", bus->pin);
+            return n ? n : -1;
+        }
+        if (_rom_valid(rom)) {
+            for (int i = 0; i < 8; i++) found[n].addr[i] = rom[i];
+            n++;
+        } else {
+            ESP_LOGW(TAG, "ROM %02X..%02X en GPIO%d no es un DS18B20 válido (familia/CRC), descartada",
+                     rom[0], rom[7], bus->pin);
+        }
+    }
+    return n;
+}
+
+int ds18b20_search(gpio_num_t pin, ds18b20_addr_t *found, int max) {
+    onewire_bus_t *bus = _bus(pin);
+    if (!bus) return 0;
+
+    int n = _search(bus, CMD_SEARCH_ROM, found, max);
+    return (n > 0) ? n : 0;
+}
+
+int ds18b20_alarm_search(gpio_num_t pin, ds18b20_addr_t *found, int max) {
+    onewire_bus_t *bus = _bus(pin);
+    if (!bus) return -1;
+    return _search(bus, CMD_ALARM_SEARCH, found, max);
+}
+
+void ds18b20_addr_to_hex(const ds18b20_addr_t *address, char out[17]) {
+    for (int i = 0; i < 8; i++) sprintf(&out[2 * i], "%02X", address->addr[i]);
+}
+
+bool ds18b20_addr_from_hex(const char *hex, ds18b20_addr_t *address) {
+    ds18b20_addr_t a;
     for (int i = 0; i < 8; i++) {
-        _onewire_write_byte(pin, address.addr[i]);
+        unsigned int byte;
+        if (!hex[2 * i] || !hex[2 * i + 1] || sscanf(&hex[2 * i], "%2x", &byte) != 1) return false;
+        a.addr[i] = (uint8_t)byte;
     }
+    if (hex[16] != '\0' || !_rom_valid(a.addr)) return false;
+    *address = a;
+    return true;
+}
 
-    _onewire_write_byte(pin, 0xBE); // Read Scratchpad
-    
-    uint8_t low = _onewire_read_byte(pin);
-    uint8_t high = _onewire_read_byte(pin);
-    
-    // Leemos el resto (opcional, pero buena práctica para limpiar el bus)
-    for(int i=0; i<7; i++) _onewire_read_byte(pin);
+uint32_t ds18b20_conversion_ms(uint8_t resolution) {
+    if (resolution < 9) resolution = 9;
+    if (resolution > 12) resolution = 12;
+    return (CONV_MS_12BIT >> (12 - resolution)) + 1;
+}
 
-    portEXIT_CRITICAL_SAFE(&ds18b20_spinlock);
+esp_err_t ds18b20_set_resolution(gpio_num_t pin, ds18b20_addr_t address, uint8_t resolution) {
+    onewire_bus_t *bus = _bus(pin);
+    if (!bus) return ESP_ERR_INVALID_STATE;
+    if (resolution < 9 || resolution > 12) return ESP_ERR_INVALID_ARG;
 
-    int16_t raw = (high << 8) | low;
-    
-    // Si leemos 0xFFFF (-1), es error de desconexión
-    if (raw == -1) return ESP_ERR_TIMEOUT;
+    // Conservar TH/TL: el comando escribe los tres bytes juntos
+    uint8_t sp[9];
+    esp_err_t err = _read_scratchpad_crc(bus, &address, sp);
+    if (err != ESP_OK) return err;
 
-    float t = (float)raw / 16.0f;
-    
-    // Filtro básico de valores imposibles
-    if (t < -55.0 || t > 125.0) return ESP_FAIL;
+    return _write_config(bus, &address, sp[2], sp[3], resolution);
+}
 
-    *temp = t;
+esp_err_t ds18b20_sensor_init(ds18b20_sensor_t *s, gpio_num_t pin, ds18b20_addr_t address, uint8_t resolution) {
+    s->pin = pin;
+    s->addr = address;
+    s->resolution = resolution;
+    s->converting = false;
+    s->ready_at_us = 0;
+    s->verify_crc = false;
+    s->has_last = false;
+    s->alarm_on = false;
+    memset(&s->stats, 0, sizeof(s->stats));
+
+    esp_err_t err = ds18b20_set_resolution(pin, address, resolution);
+    if (err != ESP_OK) {
+        // Queda en la resolución de fábrica (12 bits): se espera lo que corresponde
+        ESP_LOGW(TAG, "No se pudo fijar %d bits en %02X..%02X: %s", resolution,
+                 address.addr[0], address.addr[7], esp_err_to_name(err));
+        s->resolution = 12;
+    }
+    return err;
+}
+
+esp_err_t ds18b20_sensor_start(ds18b20_sensor_t *s) {
+    onewire_bus_t *bus = _bus(s->pin);
+    if (!bus) return ESP_ERR_INVALID_STATE;
+
+    int64_t now = esp_timer_get_time();
+    esp_err_t err = _select(bus, &s->addr);
+    if (err == ESP_OK) {
+        const uint8_t cmd = CMD_CONVERT_T;
+        err = bus->write_bytes(bus, &cmd, 1);
+    }
+    if (err != ESP_OK) {
+        s->converting = false;
+        s->ready_at_us = now + RETRY_MS * 1000LL;
+        return err;
+    }
+
+    s->converting = true;
+    s->ready_at_us = now + ds18b20_conversion_ms(s->resolution) * 1000LL;
     return ESP_OK;
-}
\ No newline at end of file
+}
+
+// Una sola orden para todo el bus: cada sensor queda con el tiempo de su resolución
+esp_err_t ds18b20_sensor_start_bus(ds18b20_sensor_t *const *s, int n) {
+    if (n <= 0) return ESP_OK;
+    int64_t now = esp_timer_get_time();
+    esp_err_t err = ds18b20_convert_all(s[0]->pin);
+
+    for (int i = 0; i < n; i++) {
+        s[i]->converting = (err == ESP_OK);
+        s[i]->ready_at_us = now + ((err == ESP_OK) ? ds18b20_conversion_ms(s[i]->resolution)
+                                                   : RETRY_MS) * 1000LL;
+    }
+    return err;
+}
+
+esp_err_t ds18b20_sensor_set_alarm(ds18b20_sensor_t *s, int8_t tl, int8_t th) {
+    onewire_bus_t *bus = _bus(s->pin);
+    if (!bus) return ESP_ERR_INVALID_STATE;
+
+    // Se recuerda aunque falle: la próxima lectura con CRC la vuelve a escribir
+    s->alarm_on = true;
+    s->alarm_tl = tl;
+    s->alarm_th = th;
+    return _write_config(bus, &s->addr, (uint8_t)th, (uint8_t)tl, s->resolution);
+}
+
+uint32_t ds18b20_sensor_remaining_ms(const ds18b20_sensor_t *s) {
+    int64_t left = s->ready_at_us - esp_timer_get_time();
+    return (left > 0) ? (uint32_t)((left + 999) / 1000) : 0;
+}
+
+// Valores que ameritan confirmar con CRC: fuera de rango, 0x0000 (bus en corto),
+// 85°C de power-on o un salto grande respecto de la lectura anterior
+static bool _suspicious(const ds18b20_sensor_t *s, const uint8_t sp[2], esp_err_t err, const float *t) {
+    if (err != ESP_OK) return true;
+    int16_t raw = (sp[1] << 8) | sp[0];
+    if (raw == 0 || raw == POWER_ON_RAW) return true;
+    return s->has_last && fabsf(*t - s->last_temp) > JUMP_LIMIT_C;
+}
+
+// Cuenta en el sensor (solo lo toca la tarea de su bus) y en el acumulado global
+#define COUNT(s, field) do {                 \
+        (s)->stats.field++;                  \
+        portENTER_CRITICAL(&s_stats_lock);   \
+        s_stats.field++;                     \
+        portEXIT_CRITICAL(&s_stats_lock);    \
+    } while (0)
+
+static esp_err_t _sensor_read(ds18b20_sensor_t *s, onewire_bus_t *bus, float *temp) {
+    uint8_t sp[9];
+    esp_err_t err = ESP_FAIL;
+    int crc_reads = 1 + CRC_RETRIES;
+
+    COUNT(s, reads);
+
+    // Modo rápido: solo los 2 bytes de temperatura y reset
+    if (!s->verify_crc) {
+        err = _read_scratchpad(bus, &s->addr, sp, 2);
+        if (err == ESP_OK) err = _decode_temp(sp, s->resolution, temp);
+        if (!_suspicious(s, sp, err, temp)) goto done;
+        crc_reads = CRC_RETRIES;   // Dudoso: se confirma con CRC
+    }
+
+    for (int i = 0; i < crc_reads; i++) {
+        if (i > 0 || !s->verify_crc) COUNT(s, retries);
+        err = _read_scratchpad_crc(bus, &s->addr, sp);
+        if (err == ESP_ERR_INVALID_CRC) {
+            COUNT(s, crc_errors);
+            continue;
+        }
+        if (err != ESP_OK) continue;
+
+        // CRC válido: el dato es el que tiene el sensor. Si se reinició
+        // perdió TH/TL (vuelven los de EEPROM): se reprograma la alarma
+        if (s->alarm_on && ((int8_t)sp[2] != s->alarm_th || (int8_t)sp[3] != s->alarm_tl)) {
+            ESP_LOGW(TAG, "Alarma perdida en %02X..%02X, reprogramando", s->addr.addr[0], s->addr.addr[7]);
+            _write_config(bus, &s->addr, (uint8_t)s->alarm_th, (uint8_t)s->alarm_tl, s->resolution);
+        }
+        err = _decode_temp(sp, s->resolution, temp);
+        int16_t raw = (sp[1] << 8) | sp[0];
+        if (err == ESP_OK && raw == POWER_ON_RAW &&
+            !(s->has_last && fabsf(*temp - s->last_temp) <= JUMP_LIMIT_C)) {
+            err = ESP_ERR_INVALID_RESPONSE;   // El sensor se reinició y no convirtió
+        }
+        break;
+    }
+
+done:
+    if (err == ESP_OK) {
+        s->last_temp = *temp;
+        s->has_last = true;
+    } else {
+        COUNT(s, failures);
+    }
+    return err;
+}
+
+esp_err_t ds18b20_sensor_poll(ds18b20_sensor_t *s, float *temp) {
+    if (ds18b20_sensor_remaining_ms(s) > 0) return ESP_ERR_NOT_FINISHED;
+
+    if (!s->converting) {
+        esp_err_t err = ds18b20_sensor_start(s);
+        return (err == ESP_OK) ? ESP_ERR_NOT_FINISHED : err;
+    }
+
+    s->converting = false;
+    onewire_bus_t *bus = _bus(s->pin);
+    if (!bus) return ESP_ERR_INVALID_STATE;
+
+    esp_err_t err = _sensor_read(s, bus, temp);
+    if (err != ESP_OK) s->ready_at_us = esp_timer_get_time() + RETRY_MS * 1000LL;
+    return err;
+}
+
+esp_err_t ds18b20_sensor_poll_alarm(ds18b20_sensor_t *s, float *temp) {
+    if (ds18b20_sensor_remaining_ms(s) > 0) return ESP_ERR_NOT_FINISHED;
+
+    if (!s->converting) {
+        esp_err_t err = ds18b20_sensor_start(s);
+        return (err == ESP_OK) ? ESP_ERR_NOT_FINISHED : err;
+    }
+
+    s->converting = false;
+    onewire_bus_t *bus = _bus(s->pin);
+    if (!bus) return ESP_ERR_INVALID_STATE;
+
+    // Sin alarma la transacción termina en los dos primeros bits (1, 1)
+    ds18b20_addr_t found[ONEWIRE_ALARM_MAX];
+    int n = _search(bus, CMD_ALARM_SEARCH, found, ONEWIRE_ALARM_MAX);
+    if (n < 0) {
+        s->ready_at_us = esp_timer_get_time() + RETRY_MS * 1000LL;
+        return ESP_ERR_TIMEOUT;
+    }
+
+    bool in_alarm = false;
+    for (int i = 0; i < n; i++) {
+        in_alarm |= memcmp(found[i].addr, s->addr.addr, sizeof(s->addr.addr)) == 0;
+    }
+    if (!in_alarm) return ESP_ERR_NOT_FOUND;
+
+    // En alarma: el scratchpad ya tiene la conversión que la disparó
+    esp_err_t err = _sensor_read(s, bus, temp);
+    if (err != ESP_OK) s->ready_at_us = esp_timer_get_time() + RETRY_MS * 1000LL;
+    return err;
+}
+
+void ds18b20_get_stats(ds18b20_stats_t *out) {
+    portENTER_CRITICAL(&s_stats_lock);
+    *out = s_stats;
+    portEXIT_CRITICAL(&s_stats_lock);
+}
+
+uint32_t ds18b20_irq_off_max_us(void) {
+    return onewire_gpio_irq_off_max_us();
+}
@@ -0,0 +1,186 @@
+/*
+ * Puerto de host del driver: reloj, espera activa y dos buses simulados:
+ *   - GPIO: la línea responde siempre 0 (presencia y bits en 0); alcanza para
+ *     cronometrar el bit-bang. Es el respaldo de ds18b20_init_bus cuando
+ *     onewire_rmt_init falla, igual que sin canales RMT libres.
+ *   - SIM: en los pines pasados a host_sim_attach, onewire_rmt_init instala
+ *     un bus lógico con ROMs simuladas que responde SEARCH ROM y ALARM
+ *     SEARCH bit a bit (AND cableado), o un bus tomado en bajo.
+ */
+#define _POSIX_C_SOURCE 199309L
+#include <string.h>
+#include <time.h>
+#include "driver/gpio.h"
+#include "esp_rom_sys.h"
+#include "esp_timer.h"
+#include "host_sim.h"
+#include "onewire_bus.h"
+
+#define CMD_SEARCH_ROM   0xF0
+#define CMD_ALARM_SEARCH 0xEC
+
+typedef enum { SEARCH_IDLE, SEARCH_BIT, SEARCH_CBIT, SEARCH_DIR } search_phase_t;
+
+typedef struct {
+    gpio_num_t pin;
+    bool used;
+    bool stuck_low;
+    int n;
+    ds18b20_addr_t rom[HOST_SIM_MAX_DEVICES];
+    bool alarm[HOST_SIM_MAX_DEVICES];
+    // Búsqueda en curso
+    bool after_reset;
+    search_phase_t phase;
+    int bit;
+    bool active[HOST_SIM_MAX_DEVICES];
+} sim_bus_t;
+
+static sim_bus_t s_sim[ONEWIRE_MAX_BUSES];
+
+int64_t esp_timer_get_time(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (int64_t)ts.tv_sec * 1000000 + ts.tv_nsec / 1000;
+}
+
+void esp_rom_delay_us(uint32_t us) {
+    int64_t end = esp_timer_get_time() + us;
+    while (esp_timer_get_time() < end) {
+    }
+}
+
+const char *esp_err_to_name(esp_err_t code) {
+    (void)code;
+    return "error";
+}
+
+esp_err_t gpio_reset_pin(gpio_num_t pin) {
+    (void)pin;
+    return ESP_OK;
+}
+
+esp_err_t gpio_set_direction(gpio_num_t pin, gpio_mode_t mode) {
+    (void)pin;
+    (void)mode;
+    return ESP_OK;
+}
+
+esp_err_t gpio_set_pull_mode(gpio_num_t pin, gpio_pull_mode_t pull) {
+    (void)pin;
+    (void)pull;
+    return ESP_OK;
+}
+
+esp_err_t gpio_set_level(gpio_num_t pin, uint32_t level) {
+    (void)pin;
+    (void)level;
+    return ESP_OK;
+}
+
+int gpio_get_level(gpio_num_t pin) {
+    (void)pin;
+    return 0;
+}
+
+static sim_bus_t *sim_find(gpio_num_t pin) {
+    for (int k = 0; k < ONEWIRE_MAX_BUSES; k++) {
+        if (s_sim[k].used && s_sim[k].pin == pin) return &s_sim[k];
+    }
+    return NULL;
+}
+
+void host_sim_attach(gpio_num_t pin, const ds18b20_addr_t *roms, int n, bool stuck_low) {
+    sim_bus_t *sim = sim_find(pin);
+
+    for (int k = 0; !sim && k < ONEWIRE_MAX_BUSES; k++) {
+        if (!s_sim[k].used) sim = &s_sim[k];
+    }
+    if (!sim) return;
+    if (n > HOST_SIM_MAX_DEVICES) n = HOST_SIM_MAX_DEVICES;
+
+    memset(sim, 0, sizeof(*sim));
+    sim->used = true;
+    sim->pin = pin;
+    sim->stuck_low = stuck_low;
+    sim->n = n;
+    for (int k = 0; k < n; k++) sim->rom[k] = roms[k];
+}
+
+void host_sim_set_alarm(gpio_num_t pin, int idx, bool alarm) {
+    sim_bus_t *sim = sim_find(pin);
+    if (sim && idx >= 0 && idx < sim->n) sim->alarm[idx] = alarm;
+}
+
+static int rom_bit(const ds18b20_addr_t *rom, int bit) {
+    return (rom->addr[bit / 8] >> (bit % 8)) & 1;
+}
+
+static bool sim_reset(onewire_bus_t *bus) {
+    sim_bus_t *sim = bus->ctx;
+    sim->after_reset = true;
+    sim->phase = SEARCH_IDLE;
+    return sim->stuck_low || sim->n > 0;
+}
+
+static esp_err_t sim_write_bytes(onewire_bus_t *bus, const uint8_t *data, size_t len) {
+    sim_bus_t *sim = bus->ctx;
+
+    if (len > 0 && sim->after_reset && (data[0] == CMD_SEARCH_ROM || data[0] == CMD_ALARM_SEARCH)) {
+        for (int k = 0; k < sim->n; k++) {
+            sim->active[k] = data[0] == CMD_SEARCH_ROM || sim->alarm[k];
+        }
+        sim->phase = SEARCH_BIT;
+        sim->bit = 0;
+    }
+    sim->after_reset = false;
+    return ESP_OK;
+}
+
+static esp_err_t sim_read_bytes(onewire_bus_t *bus, uint8_t *data, size_t len) {
+    sim_bus_t *sim = bus->ctx;
+    memset(data, sim->stuck_low ? 0x00 : 0xFF, len);
+    return ESP_OK;
+}
+
+// Bit y complemento: cualquier sensor que mande 0 tira la línea a bajo
+static int sim_read_bit(onewire_bus_t *bus) {
+    sim_bus_t *sim = bus->ctx;
+    int level = 1;
+
+    if (sim->stuck_low) return 0;
+    if (sim->phase != SEARCH_BIT && sim->phase != SEARCH_CBIT) return 1;
+    for (int k = 0; k < sim->n; k++) {
+        if (!sim->active[k]) continue;
+        int b = rom_bit(&sim->rom[k], sim->bit);
+        if ((sim->phase == SEARCH_BIT ? b : !b) == 0) level = 0;
+    }
+    sim->phase = (sim->phase == SEARCH_BIT) ? SEARCH_CBIT : SEARCH_DIR;
+    return level;
+}
+
+static esp_err_t sim_write_bit(onewire_bus_t *bus, int bit) {
+    sim_bus_t *sim = bus->ctx;
+
+    if (sim->phase != SEARCH_DIR) return ESP_OK;
+    for (int k = 0; k < sim->n; k++) {
+        if (sim->active[k] && rom_bit(&sim->rom[k], sim->bit) != bit) sim->active[k] = false;
+    }
+    sim->bit++;
+    sim->phase = (sim->bit < 64) ? SEARCH_BIT : SEARCH_IDLE;
+    return ESP_OK;
+}
+
+esp_err_t onewire_rmt_init(onewire_bus_t *bus, gpio_num_t pin) {
+    sim_bus_t *sim = sim_find(pin);
+    if (!sim) return ESP_ERR_NOT_SUPPORTED;
+
+    bus->pin = pin;
+    bus->backend = "SIM";
+    bus->ctx = sim;
+    bus->reset = sim_reset;
+    bus->write_bytes = sim_write_bytes;
+    bus->read_bytes = sim_read_bytes;
+    bus->write_bit = sim_write_bit;
+    bus->read_bit = sim_read_bit;
+    return ESP_OK;
+}
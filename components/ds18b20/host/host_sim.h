@@ -0,0 +1,22 @@
+#pragma once
+#include <stdbool.h>
+#include "ds18b20.h"
+
+/*
+ * Bus OneWire lógico para las pruebas de host (ver host_port.c). Llamar
+ * antes de ds18b20_init_bus(pin); después se puede volver a llamar para
+ * cambiar los sensores del mismo pin.
+ */
+
+#define HOST_SIM_MAX_DEVICES 8
+
+/**
+ * @brief Sensores simulados en el pin. stuck_low = línea tomada en bajo
+ *        (presencia y todos los bits en 0, como con la sonda en corto).
+ */
+void host_sim_attach(gpio_num_t pin, const ds18b20_addr_t *roms, int n, bool stuck_low);
+
+/**
+ * @brief Marca un sensor simulado como en alarma (responde ALARM SEARCH).
+ */
+void host_sim_set_alarm(gpio_num_t pin, int idx, bool alarm);
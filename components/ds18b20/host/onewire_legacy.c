@@ -0,0 +1,124 @@
+/*
+ * Camino bit-bang anterior al backend RMT (commit base), solo para medirlo:
+ * ds18b20_read_one y ds18b20_convert_all con la transacción completa dentro
+ * de UNA sección crítica. Los slots son los originales; la sección crítica se
+ * cronometra con el mismo _irq_off/_irq_on que onewire_gpio.c.
+ */
+#include "onewire_legacy.h"
+#include "esp_rom_sys.h"
+#include "esp_timer.h"
+#include "freertos/FreeRTOS.h"
+
+static portMUX_TYPE ds18b20_spinlock = portMUX_INITIALIZER_UNLOCKED;
+
+#define DELAY_RESET 480
+#define DELAY_WRITE_1 6
+#define DELAY_WRITE_0 60
+#define DELAY_READ_SAMPLE 9
+
+static uint32_t s_irq_off_max_us = 0;
+
+static void _delay_us(uint32_t us) {
+    esp_rom_delay_us(us);
+}
+
+static inline int64_t _irq_off(void) {
+    portENTER_CRITICAL_SAFE(&ds18b20_spinlock);
+    return esp_timer_get_time();
+}
+
+static inline void _irq_on(int64_t t0) {
+    uint32_t dt = (uint32_t)(esp_timer_get_time() - t0);
+    if (dt > s_irq_off_max_us) s_irq_off_max_us = dt;
+    portEXIT_CRITICAL_SAFE(&ds18b20_spinlock);
+}
+
+static bool _onewire_reset(gpio_num_t pin) {
+    gpio_set_level(pin, 0);
+    _delay_us(DELAY_RESET);
+    gpio_set_level(pin, 1);
+    _delay_us(70);
+    int presence = gpio_get_level(pin);
+    _delay_us(410);
+    return (presence == 0);
+}
+
+static void _onewire_write_bit(gpio_num_t pin, int bit) {
+    gpio_set_level(pin, 0);
+    if (bit) {
+        _delay_us(DELAY_WRITE_1);
+        gpio_set_level(pin, 1);
+        _delay_us(64);
+    } else {
+        _delay_us(DELAY_WRITE_0);
+        gpio_set_level(pin, 1);
+        _delay_us(10);
+    }
+}
+
+static int _onewire_read_bit(gpio_num_t pin) {
+    int bit = 0;
+    gpio_set_level(pin, 0);
+    _delay_us(6);
+    gpio_set_level(pin, 1);
+    _delay_us(DELAY_READ_SAMPLE);
+    bit = gpio_get_level(pin);
+    _delay_us(55);
+    return bit;
+}
+
+static void _onewire_write_byte(gpio_num_t pin, uint8_t data) {
+    for (int i = 0; i < 8; i++) {
+        _onewire_write_bit(pin, (data >> i) & 1);
+    }
+}
+
+static uint8_t _onewire_read_byte(gpio_num_t pin) {
+    uint8_t data = 0;
+    for (int i = 0; i < 8; i++) {
+        data |= (_onewire_read_bit(pin) << i);
+    }
+    return data;
+}
+
+esp_err_t legacy_convert_all(gpio_num_t pin) {
+    int64_t t0 = _irq_off();
+    if (!_onewire_reset(pin)) {
+        _irq_on(t0);
+        return ESP_FAIL;
+    }
+    _onewire_write_byte(pin, 0xCC);
+    _onewire_write_byte(pin, 0x44);
+    _irq_on(t0);
+    return ESP_OK;
+}
+
+esp_err_t legacy_read_one(gpio_num_t pin, ds18b20_addr_t address, float *temp) {
+    int64_t t0 = _irq_off();
+    if (!_onewire_reset(pin)) {
+        _irq_on(t0);
+        return ESP_ERR_TIMEOUT;
+    }
+    _onewire_write_byte(pin, 0x55);
+    for (int i = 0; i < 8; i++) {
+        _onewire_write_byte(pin, address.addr[i]);
+    }
+    _onewire_write_byte(pin, 0xBE);
+    uint8_t low = _onewire_read_byte(pin);
+    uint8_t high = _onewire_read_byte(pin);
+    for (int i = 0; i < 7; i++) _onewire_read_byte(pin);
+    _irq_on(t0);
+
+    int16_t raw = (high << 8) | low;
+    if (raw == -1) return ESP_ERR_TIMEOUT;
+    *temp = (float)raw / 16.0f;
+    return ESP_OK;
+}
+
+uint32_t legacy_irq_off_max_us(void) {
+    return s_irq_off_max_us;
+}
+
+void legacy_irq_off_reset(void) {
+    s_irq_off_max_us = 0;
+}
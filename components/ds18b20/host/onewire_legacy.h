@@ -0,0 +1,12 @@
+#pragma once
+#include "ds18b20.h"
+
+/*
+ * Driver bit-bang anterior (transacción completa con interrupciones
+ * cortadas), reconstruido para medirlo en el host. No es parte del firmware.
+ */
+
+esp_err_t legacy_convert_all(gpio_num_t pin);
+esp_err_t legacy_read_one(gpio_num_t pin, ds18b20_addr_t address, float *temp);
+uint32_t legacy_irq_off_max_us(void);
+void legacy_irq_off_reset(void);
@@ -0,0 +1,8 @@
+// Logs del driver a stdout (el host no tiene niveles)
+#pragma once
+#include <stdio.h>
+
+#define ESP_LOGE(tag, fmt, ...) printf("   [%s] " fmt "\n", tag, ##__VA_ARGS__)
+#define ESP_LOGW(tag, fmt, ...) printf("   [%s] " fmt "\n", tag, ##__VA_ARGS__)
+#define ESP_LOGI(tag, fmt, ...) printf("   [%s] " fmt "\n", tag, ##__VA_ARGS__)
+#define ESP_LOGD(tag, fmt, ...) do { (void)(tag); } while (0)
@@ -0,0 +1,12 @@
+// Un solo hilo en el host: las secciones críticas no hacen nada, pero se
+// cronometran igual (_irq_off/_irq_on del backend)
+#pragma once
+#include <stdint.h>
+
+typedef struct { int unused; } portMUX_TYPE;
+#define portMUX_INITIALIZER_UNLOCKED {0}
+
+#define portENTER_CRITICAL(mux)      ((void)(mux))
+#define portEXIT_CRITICAL(mux)       ((void)(mux))
+#define portENTER_CRITICAL_SAFE(mux) ((void)(mux))
+#define portEXIT_CRITICAL_SAFE(mux)  ((void)(mux))
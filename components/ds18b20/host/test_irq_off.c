@@ -0,0 +1,94 @@
+/*
+ * Tiempo con interrupciones cortadas del driver OneWire, antes y después:
+ *   - antes: el bit-bang original (onewire_legacy.c), una sección crítica
+ *     por transacción,
+ *   - después: ds18b20.c sobre el backend GPIO de respaldo, una sección
+ *     crítica por slot.
+ * Ambos se cronometran con el mismo _irq_off/_irq_on. El backend RMT no corta
+ * interrupciones en el código del driver y no corre en el host.
+ *
+ * Cada transacción se repite TRIALS veces y se informa el mejor caso (sin
+ * que el planificador del host interrumpa la espera activa) y el peor.
+ */
+#include <stdio.h>
+#include "ds18b20.h"
+#include "onewire_legacy.h"
+
+// El máximo del backend es estático: se incluye para poder ponerlo en cero
+// entre repeticiones
+#include "../onewire_gpio.c"
+
+#define TRIALS 30
+#define PIN    4
+
+// Límites del resultado (µs): un slot con margen / casi toda la transacción
+#define SLOT_MAX_US        100
+#define LEGACY_READ_MIN_US 10000
+
+typedef struct {
+    uint32_t best_us, worst_us;   // Sección crítica más larga por transacción
+    uint32_t wall_us;             // Duración de la transacción (mejor caso)
+} irq_result_t;
+
+static const ds18b20_addr_t ADDR = { { 0x28, 0xF4, 0xD6, 0x57, 0x04, 0xE1, 0x3C, 0x1E } };
+
+static void new_read(void) {
+    float t;
+    ds18b20_read_one(PIN, ADDR, &t);
+}
+
+static void new_convert(void) {
+    ds18b20_convert_all(PIN);
+}
+
+static void old_read(void) {
+    float t;
+    legacy_read_one(PIN, ADDR, &t);
+}
+
+static void old_convert(void) {
+    legacy_convert_all(PIN);
+}
+
+static irq_result_t measure(void (*fn)(void), bool legacy) {
+    irq_result_t r = { .best_us = UINT32_MAX, .wall_us = UINT32_MAX };
+
+    for (int k = 0; k < TRIALS; k++) {
+        if (legacy) legacy_irq_off_reset();
+        else s_irq_off_max_us = 0;
+
+        int64_t t0 = esp_timer_get_time();
+        fn();
+        uint32_t wall = (uint32_t)(esp_timer_get_time() - t0);
+        uint32_t off = legacy ? legacy_irq_off_max_us() : ds18b20_irq_off_max_us();
+
+        if (off < r.best_us) r.best_us = off;
+        if (off > r.worst_us) r.worst_us = off;
+        if (wall < r.wall_us) r.wall_us = wall;
+    }
+    return r;
+}
+
+static void print_row(const char *what, const irq_result_t *old, const irq_result_t *now) {
+    printf("  %-14s antes %6lu µs (peor %6lu)   después %4lu µs (peor %5lu)   transacción %5lu µs\n",
+           what, (unsigned long)old->best_us, (unsigned long)old->worst_us,
+           (unsigned long)now->best_us, (unsigned long)now->worst_us, (unsigned long)now->wall_us);
+}
+
+int main(void) {
+    ds18b20_init_bus(PIN);
+
+    irq_result_t old_rd = measure(old_read, true);
+    irq_result_t new_rd = measure(new_read, false);
+    irq_result_t old_cv = measure(old_convert, true);
+    irq_result_t new_cv = measure(new_convert, false);
+
+    printf("⏱️  Interrupciones cortadas por transacción (host, mejor de %d)\n", TRIALS);
+    print_row("read_one", &old_rd, &new_rd);
+    print_row("convert_all", &old_cv, &new_cv);
+
+    bool ok = new_rd.best_us <= SLOT_MAX_US && new_cv.best_us <= SLOT_MAX_US &&
+              old_rd.best_us >= LEGACY_READ_MIN_US;
+    printf("%s bit-bang: slots de ≤%d µs contra la transacción completa\n", ok ? "✅" : "❌", SLOT_MAX_US);
+    return ok ? 0 : 1;
+}
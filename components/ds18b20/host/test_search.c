@@ -0,0 +1,98 @@
+/*
+ * SEARCH ROM / ALARM SEARCH de ds18b20.c sobre un bus simulado bit a bit:
+ *   - enumera todos los DS18B20 del bus,
+ *   - descarta ROMs de otra familia aunque el CRC cierre,
+ *   - un bus tomado en bajo (ROM todo ceros, CRC 0) no es un sensor: SEARCH
+ *     no encuentra nada y ALARM SEARCH da error, no "sin alarma",
+ *   - ALARM SEARCH devuelve solo los sensores en alarma,
+ *   - ds18b20_addr_from_hex aplica las mismas reglas.
+ */
+#include <stdio.h>
+#include <string.h>
+#include "ds18b20.h"
+#include "host_sim.h"
+
+#define PIN 18
+
+// CRC8 Dallas/Maxim bit a bit (independiente de la tabla del driver)
+static uint8_t crc8(const uint8_t *data, int len) {
+    uint8_t crc = 0;
+    for (int i = 0; i < len; i++) {
+        uint8_t byte = data[i];
+        for (int b = 0; b < 8; b++) {
+            uint8_t mix = (crc ^ byte) & 1;
+            crc >>= 1;
+            if (mix) crc ^= 0x8C;
+            byte >>= 1;
+        }
+    }
+    return crc;
+}
+
+static ds18b20_addr_t rom(uint8_t family, uint8_t a, uint8_t b, uint8_t c) {
+    ds18b20_addr_t r = { { family, a, b, c, 0x00, 0x00, 0x00, 0x00 } };
+    r.addr[7] = crc8(r.addr, 7);
+    return r;
+}
+
+static bool contains(const ds18b20_addr_t *list, int n, const ds18b20_addr_t *want) {
+    for (int k = 0; k < n; k++) {
+        if (memcmp(list[k].addr, want->addr, 8) == 0) return true;
+    }
+    return false;
+}
+
+static bool expect(const char *what, bool ok) {
+    printf("  %s %s\n", ok ? "✅" : "❌", what);
+    return ok;
+}
+
+int main(void) {
+    const ds18b20_addr_t amb = rom(0x28, 0xB5, 0x6C, 0x54);
+    const ds18b20_addr_t coil = rom(0x28, 0xF4, 0xD6, 0x57);
+    const ds18b20_addr_t other = rom(0x01, 0x12, 0x34, 0x56);   // DS2401, CRC válido
+    ds18b20_addr_t found[8];
+    bool ok = true;
+    int n;
+
+    printf("🔎 Búsqueda de ROMs\n");
+    host_sim_attach(PIN, (ds18b20_addr_t[]){ amb, coil }, 2, false);
+    ds18b20_init_bus(PIN);
+
+    n = ds18b20_search(PIN, found, 8);
+    ok &= expect("dos DS18B20: se encuentran los dos",
+                 n == 2 && contains(found, n, &amb) && contains(found, n, &coil));
+
+    host_sim_attach(PIN, (ds18b20_addr_t[]){ amb, other }, 2, false);
+    n = ds18b20_search(PIN, found, 8);
+    ok &= expect("otra familia con CRC válido: descartada", n == 1 && contains(found, n, &amb));
+
+    host_sim_attach(PIN, NULL, 0, true);
+    n = ds18b20_search(PIN, found, 8);
+    ok &= expect("bus en bajo: SEARCH no encuentra sensores", n == 0);
+    n = ds18b20_alarm_search(PIN, found, 8);
+    ok &= expect("bus en bajo: ALARM SEARCH da error (-1)", n == -1);
+
+    host_sim_attach(PIN, (ds18b20_addr_t[]){ amb, coil }, 2, false);
+    n = ds18b20_alarm_search(PIN, found, 8);
+    ok &= expect("sin alarmas: ALARM SEARCH devuelve 0", n == 0);
+    host_sim_set_alarm(PIN, 1, true);
+    n = ds18b20_alarm_search(PIN, found, 8);
+    ok &= expect("cañería en alarma: solo ella", n == 1 && contains(found, n, &coil));
+
+    host_sim_attach(PIN, NULL, 0, false);
+    n = ds18b20_alarm_search(PIN, found, 8);
+    ok &= expect("nadie en el bus: ALARM SEARCH da error (-1)", n == -1);
+
+    ds18b20_addr_t parsed;
+    char hex[17];
+    ds18b20_addr_to_hex(&coil, hex);
+    bool hex_ok = ds18b20_addr_from_hex(hex, &parsed) && memcmp(parsed.addr, coil.addr, 8) == 0;
+    ds18b20_addr_to_hex(&other, hex);
+    hex_ok &= !ds18b20_addr_from_hex(hex, &parsed);
+    hex_ok &= !ds18b20_addr_from_hex("0000000000000000", &parsed);
+    ok &= expect("addr_from_hex: acepta 0x28, rechaza otra familia y todo ceros", hex_ok);
+
+    printf("%s búsqueda de ROMs\n", ok ? "✅" : "❌");
+    return ok ? 0 : 1;
+}
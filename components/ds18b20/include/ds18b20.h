@@ -1,6 +1,7 @@
 #pragma once
 #include "driver/gpio.h"
 #include "esp_err.h"
+#include <stdbool.h>
 
 #ifdef __cplusplus
 extern "C" {
@@ -11,8 +12,37 @@ typedef struct {
     uint8_t addr[8];
 } ds18b20_addr_t;
 
+// Contadores de lectura (por sensor y acumulados)
+typedef struct {
+    uint32_t reads;        // Lecturas de temperatura intentadas
+    uint32_t retries;      // Relecturas con CRC (dato dudoso o CRC fallido)
+    uint32_t crc_errors;   // Scratchpads con CRC inválido
+    uint32_t failures;     // Lecturas que terminaron sin dato válido
+} ds18b20_stats_t;
+
+/*
+ * Sensor con conversión asíncrona: cada uno tiene su propia resolución y
+ * tiempo de conversión, y se consulta sin bloquear (ds18b20_sensor_poll).
+ */
+typedef struct {
+    gpio_num_t pin;
+    ds18b20_addr_t addr;
+    uint8_t resolution;      // 9-12 bits (94-750 ms)
+    bool converting;
+    int64_t ready_at_us;     // Fin de la conversión en curso (o del reintento)
+    bool verify_crc;         // false = modo rápido (2 bytes + reset, CRC solo si el dato es dudoso)
+    bool has_last;
+    float last_temp;         // Última lectura válida (detección de saltos)
+    bool alarm_on;           // TH/TL programados (se verifican en cada lectura con CRC)
+    int8_t alarm_tl;         // Alarma si T ≤ TL (parte entera, °C)
+    int8_t alarm_th;         // Alarma si T ≥ TH
+    ds18b20_stats_t stats;
+} ds18b20_sensor_t;
+
 /**
  * @brief Inicializa el bus OneWire en el pin especificado.
+ * Usa el periférico RMT (sin cortar interrupciones); si no hay canales
+ * libres cae a bit-bang por GPIO.
  */
 void ds18b20_init_bus(gpio_num_t pin);
 
@@ -24,10 +54,108 @@ esp_err_t ds18b20_convert_all(gpio_num_t pin);
 
 /**
  * @brief Lee la temperatura de UN sensor específico usando su ID (Match ROM).
- * Evita colisiones en el bus.
+ * Evita colisiones en el bus. Valida el scratchpad con CRC.
  */
 esp_err_t ds18b20_read_one(gpio_num_t pin, ds18b20_addr_t address, float *temp);
 
+/**
+ * @brief Enumera los sensores del bus (SEARCH ROM 0xF0). Solo devuelve
+ *        DS18B20 (familia 0x28) con CRC válido; un bus tomado en bajo (ROM
+ *        todo ceros) no cuenta como sensor.
+ * @return Cantidad de direcciones escritas en found (hasta max)
+ */
+int ds18b20_search(gpio_num_t pin, ds18b20_addr_t *found, int max);
+
+/**
+ * @brief ALARM SEARCH: enumera solo los sensores cuya última conversión quedó
+ *        fuera de su ventana TH/TL. Sin alarmas es una transacción de 2 bits.
+ * @return Cantidad de sensores en alarma, o -1 si nadie responde en el bus o
+ *         si está tomado en bajo
+ */
+int ds18b20_alarm_search(gpio_num_t pin, ds18b20_addr_t *found, int max);
+
+/**
+ * @brief Dirección ROM → texto hexadecimal de 16 caracteres (ej. "28F4D65704E13C1E").
+ */
+void ds18b20_addr_to_hex(const ds18b20_addr_t *address, char out[17]);
+
+/**
+ * @brief Texto hexadecimal → dirección ROM. Falla si el formato, la familia
+ *        (0x28) o el CRC no cierran.
+ */
+bool ds18b20_addr_from_hex(const char *hex, ds18b20_addr_t *address);
+
+/**
+ * @brief Tiempo máximo de conversión para una resolución (9-12 bits).
+ */
+uint32_t ds18b20_conversion_ms(uint8_t resolution);
+
+/**
+ * @brief Fija la resolución de un sensor (en RAM del sensor, se repite en cada arranque).
+ */
+esp_err_t ds18b20_set_resolution(gpio_num_t pin, ds18b20_addr_t address, uint8_t resolution);
+
+/**
+ * @brief Prepara un sensor asíncrono y le fija la resolución.
+ * Arranca en modo rápido (verify_crc = false); poner verify_crc = true para
+ * validar siempre el scratchpad completo. Si falla, queda usable asumiendo 12 bits.
+ */
+esp_err_t ds18b20_sensor_init(ds18b20_sensor_t *s, gpio_num_t pin, ds18b20_addr_t address, uint8_t resolution);
+
+/**
+ * @brief Ordena la conversión de ESTE sensor (Match ROM + Convert T). No bloquea.
+ */
+esp_err_t ds18b20_sensor_start(ds18b20_sensor_t *s);
+
+/**
+ * @brief Ordena la conversión de todos los sensores de un mismo bus con un
+ * solo Skip ROM + Convert T. Cada uno queda esperando según su resolución.
+ * @param s Sensores del bus (todos con el mismo pin)
+ */
+esp_err_t ds18b20_sensor_start_bus(ds18b20_sensor_t *const *s, int n);
+
+/**
+ * @brief Programa la ventana de alarma del sensor (en RAM del sensor; si se
+ * reinicia, la próxima lectura con CRC la detecta y la vuelve a escribir).
+ * El sensor compara solo la parte entera de la temperatura.
+ * @param tl Alarma si la temperatura ≤ tl
+ * @param th Alarma si la temperatura ≥ th
+ */
+esp_err_t ds18b20_sensor_set_alarm(ds18b20_sensor_t *s, int8_t tl, int8_t th);
+
+/**
+ * @brief Milisegundos hasta que el sensor esté listo (0 = ya se puede consultar).
+ * Sirve para dormir exactamente lo necesario.
+ */
+uint32_t ds18b20_sensor_remaining_ms(const ds18b20_sensor_t *s);
+
+/**
+ * @brief Máquina de estados: si está libre arranca la conversión, si terminó la lee.
+ * @return ESP_OK con *temp nuevo, ESP_ERR_NOT_FINISHED si todavía no hay dato,
+ *         otro error si falló el bus (se reintenta solo más tarde).
+ */
+esp_err_t ds18b20_sensor_poll(ds18b20_sensor_t *s, float *temp);
+
+/**
+ * @brief Como ds18b20_sensor_poll, pero al terminar la conversión solo hace
+ * ALARM SEARCH: el scratchpad se lee únicamente si el sensor está en alarma.
+ * @return ESP_OK con *temp nuevo (sensor en alarma), ESP_ERR_NOT_FOUND si
+ *         convirtió sin alarma, ESP_ERR_NOT_FINISHED si todavía no hay dato,
+ *         otro error si falló el bus.
+ */
+esp_err_t ds18b20_sensor_poll_alarm(ds18b20_sensor_t *s, float *temp);
+
+/**
+ * @brief Contadores acumulados de todos los sensores (CRC, reintentos, fallas).
+ */
+void ds18b20_get_stats(ds18b20_stats_t *out);
+
+/**
+ * @brief Peor tiempo con interrupciones deshabilitadas por el driver (µs).
+ * Con el backend RMT es 0; con bit-bang es la duración de un slot.
+ */
+uint32_t ds18b20_irq_off_max_us(void);
+
 #ifdef __cplusplus
 }
-#endif
\ No newline at end of file
+#endif
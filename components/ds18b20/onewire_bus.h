@@ -0,0 +1,44 @@
+#pragma once
+#include <stdint.h>
+#include <stddef.h>
+#include <stdbool.h>
+#include "driver/gpio.h"
+#include "esp_err.h"
+
+/*
+ * Interfaz interna de bus OneWire. ds18b20.c habla el protocolo del sensor
+ * y delega la temporización en un backend:
+ *  - RMT: el periférico genera y mide los slots, sin cortar interrupciones.
+ *  - GPIO: bit-bang de respaldo, con secciones críticas de un slot (<100 µs).
+ */
+
+#define ONEWIRE_MAX_BUSES 2
+
+typedef struct onewire_bus onewire_bus_t;
+
+struct onewire_bus {
+    gpio_num_t pin;
+    const char *backend;   // Nombre para logs ("RMT" / "GPIO")
+    void *ctx;
+
+    bool (*reset)(onewire_bus_t *bus);   // true si hubo pulso de presencia
+    esp_err_t (*write_bytes)(onewire_bus_t *bus, const uint8_t *data, size_t len);
+    esp_err_t (*read_bytes)(onewire_bus_t *bus, uint8_t *data, size_t len);
+    esp_err_t (*write_bit)(onewire_bus_t *bus, int bit);
+    int (*read_bit)(onewire_bus_t *bus);  // 0/1, negativo si falla el backend
+};
+
+/**
+ * @brief Backend RMT (TX y RX en el mismo pin, open-drain con loopback).
+ */
+esp_err_t onewire_rmt_init(onewire_bus_t *bus, gpio_num_t pin);
+
+/**
+ * @brief Backend bit-bang por GPIO (respaldo si no hay canales RMT).
+ */
+void onewire_gpio_init(onewire_bus_t *bus, gpio_num_t pin);
+
+/**
+ * @brief Peor tiempo con interrupciones cortadas del backend GPIO (µs).
+ */
+uint32_t onewire_gpio_irq_off_max_us(void);
@@ -0,0 +1,120 @@
+#include "onewire_bus.h"
+#include "esp_rom_sys.h"
+#include "esp_timer.h"
+#include "freertos/FreeRTOS.h"
+
+// Spinlock para proteger cada slot de interrupciones
+static portMUX_TYPE onewire_spinlock = portMUX_INITIALIZER_UNLOCKED;
+
+// Tiempos OneWire estándar
+#define DELAY_RESET 480
+#define DELAY_WRITE_1 6
+#define DELAY_WRITE_0 60
+#define DELAY_READ_SAMPLE 9
+
+// Peor sección crítica medida (µs)
+static uint32_t s_irq_off_max_us = 0;
+
+static void _delay_us(uint32_t us) {
+    esp_rom_delay_us(us);
+}
+
+// Solo se corta el slot sensible a la temporización, no la transacción completa
+static inline int64_t _irq_off(void) {
+    portENTER_CRITICAL_SAFE(&onewire_spinlock);
+    return esp_timer_get_time();
+}
+
+static inline void _irq_on(int64_t t0) {
+    uint32_t dt = (uint32_t)(esp_timer_get_time() - t0);
+    if (dt > s_irq_off_max_us) s_irq_off_max_us = dt;
+    portEXIT_CRITICAL_SAFE(&onewire_spinlock);
+}
+
+// Reset del bus: Devuelve true si alguien responde (Presence Pulse)
+static bool gpio_reset(onewire_bus_t *bus) {
+    gpio_num_t pin = bus->pin;
+
+    // El pulso bajo de reset tolera alargarse: no hace falta cortar interrupciones
+    gpio_set_level(pin, 0);
+    _delay_us(DELAY_RESET);
+
+    int64_t t0 = _irq_off();
+    gpio_set_level(pin, 1);
+    _delay_us(70);
+    int presence = gpio_get_level(pin);
+    _irq_on(t0);
+
+    _delay_us(410);
+    return (presence == 0);
+}
+
+static esp_err_t gpio_write_bit(onewire_bus_t *bus, int bit) {
+    gpio_num_t pin = bus->pin;
+    int64_t t0 = _irq_off();
+    gpio_set_level(pin, 0);
+    if (bit) {
+        _delay_us(DELAY_WRITE_1);
+        gpio_set_level(pin, 1);
+        _irq_on(t0);
+        _delay_us(64);
+    } else {
+        _delay_us(DELAY_WRITE_0);
+        gpio_set_level(pin, 1);
+        _irq_on(t0);
+        _delay_us(10);
+    }
+    return ESP_OK;
+}
+
+static int gpio_read_bit(onewire_bus_t *bus) {
+    gpio_num_t pin = bus->pin;
+    int64_t t0 = _irq_off();
+    gpio_set_level(pin, 0);
+    _delay_us(6);
+    gpio_set_level(pin, 1);
+    _delay_us(DELAY_READ_SAMPLE);
+    int bit = gpio_get_level(pin);
+    _irq_on(t0);
+    _delay_us(55);
+    return bit;
+}
+
+static esp_err_t gpio_write_bytes(onewire_bus_t *bus, const uint8_t *data, size_t len) {
+    for (size_t n = 0; n < len; n++) {
+        for (int i = 0; i < 8; i++) {
+            gpio_write_bit(bus, (data[n] >> i) & 1);
+        }
+    }
+    return ESP_OK;
+}
+
+static esp_err_t gpio_read_bytes(onewire_bus_t *bus, uint8_t *data, size_t len) {
+    for (size_t n = 0; n < len; n++) {
+        uint8_t byte = 0;
+        for (int i = 0; i < 8; i++) {
+            byte |= (gpio_read_bit(bus) << i);
+        }
+        data[n] = byte;
+    }
+    return ESP_OK;
+}
+
+void onewire_gpio_init(onewire_bus_t *bus, gpio_num_t pin) {
+    gpio_reset_pin(pin);
+    gpio_set_direction(pin, GPIO_MODE_INPUT_OUTPUT_OD);
+    gpio_set_pull_mode(pin, GPIO_PULLUP_ONLY);
+
+    bus->pin = pin;
+    bus->backend = "GPIO";
+    bus->ctx = NULL;
+    bus->reset = gpio_reset;
+    bus->write_bytes = gpio_write_bytes;
+    bus->read_bytes = gpio_read_bytes;
+    bus->write_bit = gpio_write_bit;
+    bus->read_bit = gpio_read_bit;
+}
+
+uint32_t onewire_gpio_irq_off_max_us(void) {
+    return s_irq_off_max_us;
+}
@@ -0,0 +1,207 @@
+#include <string.h>
+#include "onewire_bus.h"
+#include "driver/rmt_tx.h"
+#include "driver/rmt_rx.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/queue.h"
+#include "esp_attr.h"
+#include "esp_log.h"
+
+static const char *TAG = "ONEWIRE_RMT";
+
+// 1 tick = 1 µs
+#define RMT_RESOLUTION_HZ   1000000
+#define RMT_MEM_SYMBOLS     64
+#define RMT_TIMEOUT_MS      50
+
+// Tiempos OneWire estándar (µs)
+#define OW_RESET_LOW        480
+#define OW_RESET_WAIT       560    // Presencia (15-60 + 60-240) y recuperación
+#define OW_WRITE_1_LOW      6
+#define OW_WRITE_1_HIGH     64
+#define OW_WRITE_0_LOW      60
+#define OW_WRITE_0_HIGH     10
+#define OW_READ_THRESHOLD   15     // Bajo más largo que esto = el sensor mandó un 0
+
+// Ventanas de recepción: filtro de glitches y silencio que cierra la captura
+#define RX_MIN_NS           1000
+#define RX_RESET_MAX_NS     ((OW_RESET_WAIT + 100) * 1000)
+#define RX_SLOT_MAX_NS      ((OW_WRITE_1_HIGH + 11) * 1000)
+
+typedef struct {
+    rmt_channel_handle_t tx;
+    rmt_channel_handle_t rx;
+    rmt_encoder_handle_t copy_enc;
+    rmt_encoder_handle_t bytes_enc;
+    QueueHandle_t rx_done;
+    rmt_symbol_word_t rx_buf[RMT_MEM_SYMBOLS];
+} onewire_rmt_t;
+
+static onewire_rmt_t s_ctx[ONEWIRE_MAX_BUSES];
+static int s_used = 0;
+
+static const rmt_symbol_word_t SYM_RESET = {
+    .level0 = 0, .duration0 = OW_RESET_LOW, .level1 = 1, .duration1 = OW_RESET_WAIT,
+};
+static const rmt_symbol_word_t SYM_BIT0 = {
+    .level0 = 0, .duration0 = OW_WRITE_0_LOW, .level1 = 1, .duration1 = OW_WRITE_0_HIGH,
+};
+static const rmt_symbol_word_t SYM_BIT1 = {
+    .level0 = 0, .duration0 = OW_WRITE_1_LOW, .level1 = 1, .duration1 = OW_WRITE_1_HIGH,
+};
+
+static const rmt_transmit_config_t TX_CFG = {
+    .loop_count = 0,
+    .flags.eot_level = 1,   // Liberar el bus al terminar
+};
+
+static bool IRAM_ATTR on_rx_done(rmt_channel_handle_t chan, const rmt_rx_done_event_data_t *edata, void *user_ctx) {
+    BaseType_t woken = pdFALSE;
+    xQueueSendFromISR((QueueHandle_t)user_ctx, edata, &woken);
+    return woken == pdTRUE;
+}
+
+// Arma la recepción, transmite y espera lo capturado por el loopback
+static int rmt_txrx(onewire_rmt_t *o, rmt_encoder_handle_t enc, const void *data, size_t len,
+                    uint32_t rx_max_ns, rmt_symbol_word_t **symbols) {
+    rmt_receive_config_t rx_cfg = {
+        .signal_range_min_ns = RX_MIN_NS,
+        .signal_range_max_ns = rx_max_ns,
+    };
+    rmt_rx_done_event_data_t evt;
+
+    xQueueReset(o->rx_done);
+    if (rmt_receive(o->rx, o->rx_buf, sizeof(o->rx_buf), &rx_cfg) != ESP_OK) return -1;
+    if (rmt_transmit(o->tx, enc, data, len, &TX_CFG) != ESP_OK) return -1;
+    if (xQueueReceive(o->rx_done, &evt, pdMS_TO_TICKS(RMT_TIMEOUT_MS)) != pdTRUE) return -1;
+
+    *symbols = evt.received_symbols;
+    return (int)evt.num_symbols;
+}
+
+static bool rmt_ow_reset(onewire_bus_t *bus) {
+    onewire_rmt_t *o = bus->ctx;
+    rmt_symbol_word_t *sym;
+
+    int n = rmt_txrx(o, o->copy_enc, &SYM_RESET, sizeof(SYM_RESET), RX_RESET_MAX_NS, &sym);
+    if (n < 2) return false;
+
+    // sym[0]: nuestro pulso de reset y la espera; sym[1]: presencia del sensor
+    return sym[0].level0 == 0 && sym[0].duration0 >= OW_RESET_LOW - 10 &&
+           sym[0].duration1 <= 70 &&
+           sym[1].duration0 >= 50 && sym[1].duration0 <= 300;
+}
+
+static esp_err_t rmt_ow_write_bytes(onewire_bus_t *bus, const uint8_t *data, size_t len) {
+    onewire_rmt_t *o = bus->ctx;
+    esp_err_t err = rmt_transmit(o->tx, o->bytes_enc, data, len, &TX_CFG);
+    if (err != ESP_OK) return err;
+    return rmt_tx_wait_all_done(o->tx, RMT_TIMEOUT_MS);
+}
+
+static esp_err_t rmt_ow_write_bit(onewire_bus_t *bus, int bit) {
+    onewire_rmt_t *o = bus->ctx;
+    const rmt_symbol_word_t *sym = bit ? &SYM_BIT1 : &SYM_BIT0;
+    esp_err_t err = rmt_transmit(o->tx, o->copy_enc, sym, sizeof(*sym), &TX_CFG);
+    if (err != ESP_OK) return err;
+    return rmt_tx_wait_all_done(o->tx, RMT_TIMEOUT_MS);
+}
+
+// Un slot de lectura es un "escribir 1": si el sensor estira el bajo, es un 0
+static int rmt_ow_read_bit(onewire_bus_t *bus) {
+    onewire_rmt_t *o = bus->ctx;
+    rmt_symbol_word_t *sym;
+
+    int n = rmt_txrx(o, o->copy_enc, &SYM_BIT1, sizeof(SYM_BIT1), RX_SLOT_MAX_NS, &sym);
+    if (n < 1) return -1;
+    return sym[0].duration0 < OW_READ_THRESHOLD;
+}
+
+// Byte a byte: 8 símbolos entran holgados en un bloque de memoria RMT
+static esp_err_t rmt_ow_read_bytes(onewire_bus_t *bus, uint8_t *data, size_t len) {
+    onewire_rmt_t *o = bus->ctx;
+    static const uint8_t ones = 0xFF;
+
+    for (size_t k = 0; k < len; k++) {
+        rmt_symbol_word_t *sym;
+        int n = rmt_txrx(o, o->bytes_enc, &ones, 1, RX_SLOT_MAX_NS, &sym);
+        if (n < 8) return ESP_ERR_TIMEOUT;
+
+        uint8_t byte = 0;
+        for (int i = 0; i < 8; i++) {
+            if (sym[i].duration0 < OW_READ_THRESHOLD) byte |= (1 << i);
+        }
+        data[k] = byte;
+    }
+    return ESP_OK;
+}
+
+esp_err_t onewire_rmt_init(onewire_bus_t *bus, gpio_num_t pin) {
+    if (s_used >= ONEWIRE_MAX_BUSES) return ESP_ERR_NO_MEM;
+    onewire_rmt_t *o = &s_ctx[s_used];
+    memset(o, 0, sizeof(*o));
+
+    // RX primero: el TX con loopback se engancha al mismo pin
+    rmt_rx_channel_config_t rx_cfg = {
+        .gpio_num = pin,
+        .clk_src = RMT_CLK_SRC_DEFAULT,
+        .resolution_hz = RMT_RESOLUTION_HZ,
+        .mem_block_symbols = RMT_MEM_SYMBOLS,
+    };
+    esp_err_t err = rmt_new_rx_channel(&rx_cfg, &o->rx);
+    if (err != ESP_OK) return err;
+
+    rmt_tx_channel_config_t tx_cfg = {
+        .gpio_num = pin,
+        .clk_src = RMT_CLK_SRC_DEFAULT,
+        .resolution_hz = RMT_RESOLUTION_HZ,
+        .mem_block_symbols = RMT_MEM_SYMBOLS,
+        .trans_queue_depth = 4,
+        .flags.io_loop_back = 1,
+        .flags.io_od_mode = 1,
+    };
+    err = rmt_new_tx_channel(&tx_cfg, &o->tx);
+    if (err != ESP_OK) goto fail;
+
+    rmt_copy_encoder_config_t copy_cfg = {0};
+    rmt_bytes_encoder_config_t bytes_cfg = {
+        .bit0 = SYM_BIT0,
+        .bit1 = SYM_BIT1,
+        .flags.msb_first = 0,   // OneWire va LSB primero
+    };
+    if ((err = rmt_new_copy_encoder(&copy_cfg, &o->copy_enc)) != ESP_OK) goto fail;
+    if ((err = rmt_new_bytes_encoder(&bytes_cfg, &o->bytes_enc)) != ESP_OK) goto fail;
+
+    o->rx_done = xQueueCreate(1, sizeof(rmt_rx_done_event_data_t));
+    if (!o->rx_done) {
+        err = ESP_ERR_NO_MEM;
+        goto fail;
+    }
+    rmt_rx_event_callbacks_t cbs = { .on_recv_done = on_rx_done };
+    if ((err = rmt_rx_register_event_callbacks(o->rx, &cbs, o->rx_done)) != ESP_OK) goto fail;
+    if ((err = rmt_enable(o->rx)) != ESP_OK) goto fail;
+    if ((err = rmt_enable(o->tx)) != ESP_OK) goto fail;
+
+    // El pull-up interno ayuda con cables cortos (igual se recomienda 4k7 externo)
+    gpio_pullup_en(pin);
+
+    bus->pin = pin;
+    bus->backend = "RMT";
+    bus->ctx = o;
+    bus->reset = rmt_ow_reset;
+    bus->write_bytes = rmt_ow_write_bytes;
+    bus->read_bytes = rmt_ow_read_bytes;
+    bus->write_bit = rmt_ow_write_bit;
+    bus->read_bit = rmt_ow_read_bit;
+    s_used++;
+    return ESP_OK;
+
+fail:
+    ESP_LOGW(TAG, "No se pudo crear el bus RMT en GPIO%d: %s", pin, esp_err_to_name(err));
+    if (o->rx_done) vQueueDelete(o->rx_done);
+    if (o->bytes_enc) rmt_del_encoder(o->bytes_enc);
+    if (o->copy_enc) rmt_del_encoder(o->copy_enc);
+    if (o->tx) rmt_del_channel(o->tx);
+    if (o->rx) rmt_del_channel(o->rx);
+    return err;
+}
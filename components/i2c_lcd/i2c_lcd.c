@@ -1,26 +1,32 @@
-#include "i2c_lcd.h"
+/**
+ * @file i2c_lcd.c
+ * @brief Servicio de display LCD 20x4 (HD44780 + PCF8574) sobre el driver
+ *        i2c_master. Una tarea propia es dueña del bus: las demás tareas
+ *        arman un cuadro y lo entregan por cola, sin tocar nunca el I2C.
+ */
+
+#include <string.h>
+#include <unistd.h>
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include "freertos/queue.h"
 #include "esp_log.h"
 #include "esp_timer.h"
-#include "driver/i2c.h"
-#include <unistd.h>
+#include "driver/i2c_master.h"
+#include "i2c_lcd.h"
 
 static const char *TAG = "I2C_LCD";
 
+// Única política de recuperación: tras LCD_RECOVERY_THRESHOLD transferencias
+// fallidas se resetea el bus y se re-inicializa el LCD, con backoff exponencial
 #define LCD_RECOVERY_THRESHOLD 3
 #define LCD_RECOVERY_BASE_MS 1000
 #define LCD_RECOVERY_MAX_MS 60000
-
-static uint8_t _addr;
-static bool s_backlight_on = true;
-static uint8_t s_write_failures = 0;
-static bool s_in_recovery = false;
-static uint32_t s_recovery_backoff_ms = LCD_RECOVERY_BASE_MS;
-static int64_t s_next_recovery_us = 0;
-
-static void lcd_recovery_reset(void) {
-    s_recovery_backoff_ms = LCD_RECOVERY_BASE_MS;
-    s_next_recovery_us = 0;
-}
+#define LCD_FORCE_REINIT_MS 60000   // Con backlight: re-init periódico (modo corrupto por ruido)
+#define LCD_XFER_TIMEOUT_MS 50
+#define LCD_PROBE_TIMEOUT_MS 20
+#define LCD_TASK_STACK 3072
+#define LCD_TASK_PRIO 2
 
 // Comandos LCD
 #define LCD_CLEARDISPLAY 0x01
@@ -39,57 +45,97 @@ static void lcd_recovery_reset(void) {
 #define LCD_RW_BIT 0x02 
 #define LCD_RS_BIT 0x01 
 
-static esp_err_t i2c_lcd_write_byte(uint8_t val) {
-    uint8_t out = val;
-    if (s_backlight_on) {
-        out |= LCD_BACKLIGHT;
-    }
-    i2c_cmd_handle_t cmd = i2c_cmd_link_create();
-    i2c_master_start(cmd);
-    i2c_master_write_byte(cmd, (_addr << 1) | I2C_MASTER_WRITE, true);
-    i2c_master_write_byte(cmd, out, true);
-    i2c_master_stop(cmd);
-    esp_err_t ret = i2c_master_cmd_begin(I2C_NUM_0, cmd, pdMS_TO_TICKS(100));
-    i2c_cmd_link_delete(cmd);
+// Transporte por lotes: todos los bytes del PCF8574 (nibbles y flancos de
+// enable) de una cadena van en UNA transacción I2C. Cada byte del expansor
+// dura 9 bits de reloj, y eso es lo que temporiza al HD44780:
+//  - Enable alto = 1 byte (90 µs a 100 kHz, 22.5 µs a 400 kHz; mínimo 450 ns)
+//  - Antes de cambiar RS va un byte sin enable (setup de dirección)
+//  - Tras cada carácter/comando se rellena hasta cubrir su ejecución
+#if I2C_LCD_FREQ_HZ > 400000
+#error "I2C_LCD_FREQ_HZ: el PCF8574 no pasa de 400 kHz ni fuera de especificación"
+#endif
+#define LCD_TX_MAX      256
+#define LCD_EXEC_NS     53000    // 37 µs a 270 kHz; 53 µs con osciladores lentos
+#define LCD_BYTE_NS     (9000000000ULL / I2C_LCD_FREQ_HZ)
+// El siguiente flanco de bajada llega 2 bytes después; el resto es relleno
+// (a 100 kHz esos 2 bytes ya cubren la ejecución: sin relleno; a 400 kHz, 1)
+#define LCD_PAD_BYTES   ((int)((LCD_EXEC_NS + LCD_BYTE_NS - 1) / LCD_BYTE_NS) > 2 ? \
+                         (int)((LCD_EXEC_NS + LCD_BYTE_NS - 1) / LCD_BYTE_NS) - 2 : 0)
+
+static const uint8_t ROW_OFFSETS[I2C_LCD_ROWS] = { 0x00, 0x40, 0x14, 0x54 };
+
+static i2c_master_bus_handle_t s_bus = NULL;
+static i2c_master_dev_handle_t s_dev = NULL;
+static QueueHandle_t s_queue = NULL;
+static uint8_t _addr;
+
+// Estado del LCD (solo lo toca la tarea del servicio)
+static bool s_backlight_on = false;
+static bool s_ok = false;
+static uint8_t s_write_failures = 0;
+static uint32_t s_recovery_backoff_ms = LCD_RECOVERY_BASE_MS;
+static int64_t s_next_recovery_us = 0;
+static int64_t s_last_init_us = 0;
+
+// Framebuffer: s_frame es lo que se quiere mostrar y s_shown lo que tiene el
+// LCD. Un 0 en s_shown es contenido desconocido (la celda se reenvía sí o sí).
+static char s_frame[I2C_LCD_ROWS][I2C_LCD_COLS];
+static char s_shown[I2C_LCD_ROWS][I2C_LCD_COLS];
+static uint32_t s_tx_bytes = 0;     // Bytes I2C enviados (dirección + dato)
+static bool s_tx_error = false;
+
+static uint8_t s_tx[LCD_TX_MAX];
+static size_t s_tx_len = 0;
+static int s_tx_mode = -1;          // RS del último byte encolado (-1 = ninguno)
+
+// Las fallas solo se cuentan: la recuperación la decide el lazo del servicio
+static esp_err_t i2c_lcd_flush(void) {
+    if (s_tx_len == 0) return ESP_OK;
+
+    esp_err_t ret = i2c_master_transmit(s_dev, s_tx, s_tx_len, LCD_XFER_TIMEOUT_MS);
+    s_tx_bytes += 1 + s_tx_len;
+    s_tx_len = 0;
+    s_tx_mode = -1;
+
     if (ret != ESP_OK) {
-        if (++s_write_failures >= LCD_RECOVERY_THRESHOLD) {
-            s_write_failures = 0;
-            i2c_lcd_reinit();
-        }
+        s_tx_error = true;
+        if (s_write_failures < LCD_RECOVERY_THRESHOLD) s_write_failures++;
     } else {
-        if (s_write_failures) {
-            s_write_failures = 0;
-        }
-        lcd_recovery_reset();
+        s_write_failures = 0;
     }
     return ret;
 }
 
-static void i2c_lcd_pulse_enable(uint8_t val) {
-    i2c_lcd_write_byte(val | LCD_ENABLE_BIT);
-    usleep(1);
-    i2c_lcd_write_byte(val & ~LCD_ENABLE_BIT);
-    usleep(50);
+static void i2c_lcd_queue(uint8_t val) {
+    if (s_tx_len >= LCD_TX_MAX) i2c_lcd_flush();
+    s_tx[s_tx_len++] = val | (s_backlight_on ? LCD_BACKLIGHT : 0);
+}
+
+// Un nibble (en los 4 bits altos) latcheado por el flanco de bajada de enable
+static void i2c_lcd_queue_nibble(uint8_t nib, uint8_t mode) {
+    if (s_tx_mode != mode) i2c_lcd_queue(nib | mode);   // Setup de RS
+    s_tx_mode = mode;
+    i2c_lcd_queue(nib | mode | LCD_ENABLE_BIT);
+    i2c_lcd_queue(nib | mode);
 }
 
 static void i2c_lcd_write_nibble(uint8_t val, uint8_t mode) {
-    uint8_t high = val & 0xF0;
-    i2c_lcd_write_byte(high | mode);
-    i2c_lcd_pulse_enable(high | mode);
+    i2c_lcd_queue_nibble(val & 0xF0, mode);
+    i2c_lcd_flush();
 }
 
+// Encola un byte completo; no toca el bus hasta i2c_lcd_flush()
 static void i2c_lcd_send_byte(uint8_t val, uint8_t mode) {
-    uint8_t high = val & 0xF0;
-    uint8_t low = (val << 4) & 0xF0;
-    i2c_lcd_write_byte(high | mode);
-    i2c_lcd_pulse_enable(high | mode);
-    i2c_lcd_write_byte(low | mode);
-    i2c_lcd_pulse_enable(low | mode);
+    // Un byte entero en el lote: que el relleno no quede partido en dos transacciones
+    if (s_tx_len + 5 + LCD_PAD_BYTES > LCD_TX_MAX) i2c_lcd_flush();
+    i2c_lcd_queue_nibble(val & 0xF0, mode);
+    i2c_lcd_queue_nibble((val << 4) & 0xF0, mode);
+    for (int i = 0; i < LCD_PAD_BYTES; i++) i2c_lcd_queue(((val << 4) & 0xF0) | mode);
 }
 
-void i2c_lcd_init(uint8_t addr) {
-    _addr = addr;
-    s_write_failures = 0;
+// Secuencia de arranque del HD44780 en 4 bits; termina con el display en blanco
+static esp_err_t i2c_lcd_init_seq(void) {
+    s_tx_error = false;
     usleep(50000);
     
     i2c_lcd_write_nibble(0x30, 0); usleep(4500);
@@ -100,71 +146,154 @@ void i2c_lcd_init(uint8_t addr) {
     i2c_lcd_send_byte(0x28, 0); 
     i2c_lcd_send_byte(0x0C, 0); 
     i2c_lcd_send_byte(0x06, 0); 
-    i2c_lcd_send_byte(0x01, 0); 
+    i2c_lcd_send_byte(LCD_CLEARDISPLAY, 0); 
+    i2c_lcd_flush();
     usleep(2000);
+
+    // Tras el clear el LCD quedó en blanco (si algo falló, no se sabe)
+    memset(s_shown, s_tx_error ? 0 : ' ', sizeof(s_shown));
+    return s_tx_error ? ESP_FAIL : ESP_OK;
 }
 
-void i2c_lcd_reinit(void) {
-    int64_t now = esp_timer_get_time();
-    if (s_in_recovery) {
-        return;
+static void i2c_lcd_recovery_backoff(int64_t now) {
+    s_next_recovery_us = now + (int64_t)s_recovery_backoff_ms * 1000;
+    if (s_recovery_backoff_ms < LCD_RECOVERY_MAX_MS) {
+        s_recovery_backoff_ms *= 2;
+        if (s_recovery_backoff_ms > LCD_RECOVERY_MAX_MS) {
+            s_recovery_backoff_ms = LCD_RECOVERY_MAX_MS;
+        }
     }
-    if (s_next_recovery_us != 0 && now < s_next_recovery_us) {
-        return;
+}
+
+// Reset del bus (libera un esclavo colgado con SDA en bajo) + init del LCD.
+// force = re-init pedido (encendido del backlight o periódico): ignora el backoff.
+static void i2c_lcd_recover(int64_t now, bool force) {
+    if (!force && now < s_next_recovery_us) return;
+
+    if (!force) ESP_LOGW(TAG, "LCD recovery");
+    s_last_init_us = now;
+    if (!force) i2c_master_bus_reset(s_bus);
+
+    s_ok = i2c_master_probe(s_bus, _addr, LCD_PROBE_TIMEOUT_MS) == ESP_OK &&
+           i2c_lcd_init_seq() == ESP_OK;
+    if (s_ok) {
+        s_write_failures = 0;
+        s_recovery_backoff_ms = LCD_RECOVERY_BASE_MS;
+        s_next_recovery_us = 0;
+    } else {
+        memset(s_shown, 0, sizeof(s_shown));
+        i2c_lcd_recovery_backoff(now);
     }
-    s_in_recovery = true;
-    bool backlight = s_backlight_on;
-    ESP_LOGW(TAG, "LCD reinitializing");
-    i2c_lcd_init(_addr);
-    if (s_backlight_on != backlight) {
-        i2c_lcd_set_backlight(backlight);
+}
+
+// Solo las celdas que cambiaron; el cursor avanza solo tras cada carácter,
+// así que únicamente se mueve al saltar celdas iguales o cambiar de renglón
+static uint32_t i2c_lcd_commit(void) {
+    uint32_t start = s_tx_bytes;
+    int cursor = -1;
+
+    s_tx_error = false;
+    for (int r = 0; r < I2C_LCD_ROWS; r++) {
+        for (int c = 0; c < I2C_LCD_COLS; c++) {
+            if (s_frame[r][c] == s_shown[r][c]) continue;
+
+            int addr = ROW_OFFSETS[r] + c;
+            if (addr != cursor) i2c_lcd_send_byte(LCD_SETDDRAMADDR | addr, 0);
+            i2c_lcd_send_byte((uint8_t)s_frame[r][c], LCD_RS_BIT);
+            s_shown[r][c] = s_frame[r][c];
+            cursor = addr + 1;
+        }
     }
-    if (i2c_lcd_is_alive() == ESP_OK) {
-        lcd_recovery_reset();
-    } else {
-        if (s_recovery_backoff_ms < LCD_RECOVERY_MAX_MS) {
-            s_recovery_backoff_ms *= 2;
-            if (s_recovery_backoff_ms > LCD_RECOVERY_MAX_MS) {
-                s_recovery_backoff_ms = LCD_RECOVERY_MAX_MS;
-            }
+    i2c_lcd_flush();
+    // Con errores no se sabe qué quedó en pantalla: el próximo cuadro va entero
+    if (s_tx_error) memset(s_shown, 0, sizeof(s_shown));
+    return s_tx_bytes - start;
+}
+
+static void i2c_lcd_task(void *pv) {
+    i2c_lcd_frame_t req;
+
+    i2c_lcd_recover(esp_timer_get_time(), true);
+    while (1) {
+        xQueueReceive(s_queue, &req, portMAX_DELAY);
+        int64_t now = esp_timer_get_time();
+
+        bool wake = req.backlight && !s_backlight_on;
+        bool backlight_changed = req.backlight != s_backlight_on;
+        s_backlight_on = req.backlight;
+        memcpy(s_frame, req.rows, sizeof(s_frame));
+
+        // Al encender el backlight y cada LCD_FORCE_REINIT_MS con él encendido
+        bool periodic = s_backlight_on && (now - s_last_init_us) > (int64_t)LCD_FORCE_REINIT_MS * 1000;
+        if (wake || periodic) {
+            i2c_lcd_recover(now, true);
+        } else if (!s_ok || s_write_failures >= LCD_RECOVERY_THRESHOLD) {
+            i2c_lcd_recover(now, false);
+        }
+        if (!s_ok) continue;
+
+        if (backlight_changed) {
+            i2c_lcd_queue(0x00);
+            i2c_lcd_flush();
+        }
+        // Con el backlight apagado no se dibuja (al encender el init deja el
+        // LCD en blanco y el cuadro va completo)
+        if (s_backlight_on) {
+            uint32_t tx = i2c_lcd_commit();
+            ESP_LOGD(TAG, "LCD: %lu bytes I2C en el cuadro", (unsigned long)tx);
         }
-        s_next_recovery_us = now + (int64_t)s_recovery_backoff_ms * 1000;
+        if (s_write_failures >= LCD_RECOVERY_THRESHOLD) s_ok = false;
     }
-    s_in_recovery = false;
 }
 
-// --- CORRECCIÓN AQUÍ: uint8_t en lugar de int ---
-void i2c_lcd_write_text(uint8_t row, uint8_t col, const char *text) {
-    // Direcciones para 20x4
-    int row_offsets[] = { 0x00, 0x40, 0x14, 0x54 };
-    
-    if (row > 3) row = 3;
-    if (col > 19) col = 19;
+esp_err_t i2c_lcd_start(int sda, int scl, uint8_t addr) {
+    i2c_master_bus_config_t bus_cfg = {
+        .i2c_port = I2C_LCD_PORT,
+        .sda_io_num = sda,
+        .scl_io_num = scl,
+        .clk_source = I2C_CLK_SRC_DEFAULT,
+        .glitch_ignore_cnt = 7,
+        .flags.enable_internal_pullup = true,
+    };
+    esp_err_t err = i2c_new_master_bus(&bus_cfg, &s_bus);
+    if (err != ESP_OK) {
+        ESP_LOGE(TAG, "No se pudo crear el bus I2C: %s", esp_err_to_name(err));
+        return err;
+    }
 
-    i2c_lcd_send_byte(LCD_SETDDRAMADDR | (col + row_offsets[row]), 0);
-    
-    while (*text) {
-        i2c_lcd_send_byte((uint8_t)(*text), LCD_RS_BIT);
-        text++;
+    i2c_device_config_t dev_cfg = {
+        .dev_addr_length = I2C_ADDR_BIT_LEN_7,
+        .device_address = addr,
+        .scl_speed_hz = I2C_LCD_FREQ_HZ,
+    };
+    err = i2c_master_bus_add_device(s_bus, &dev_cfg, &s_dev);
+    if (err != ESP_OK) {
+        ESP_LOGE(TAG, "No se pudo agregar el LCD 0x%02X: %s", addr, esp_err_to_name(err));
+        return err;
     }
+
+    _addr = addr;
+    memset(s_frame, ' ', sizeof(s_frame));
+    s_queue = xQueueCreate(1, sizeof(i2c_lcd_frame_t));
+    xTaskCreate(i2c_lcd_task, "Lcd", LCD_TASK_STACK, NULL, LCD_TASK_PRIO, NULL);
+    return ESP_OK;
 }
 
-void i2c_lcd_clear(void) {
-    i2c_lcd_send_byte(LCD_CLEARDISPLAY, 0);
-    usleep(2000);
+void i2c_lcd_frame_clear(i2c_lcd_frame_t *f) {
+    memset(f->rows, ' ', sizeof(f->rows));
 }
 
-esp_err_t i2c_lcd_is_alive(void) {
-    i2c_cmd_handle_t cmd = i2c_cmd_link_create();
-    i2c_master_start(cmd);
-    i2c_master_write_byte(cmd, (_addr << 1) | I2C_MASTER_WRITE, true);
-    i2c_master_stop(cmd);
-    esp_err_t ret = i2c_master_cmd_begin(I2C_NUM_0, cmd, pdMS_TO_TICKS(50));
-    i2c_cmd_link_delete(cmd);
-    return ret;
+void i2c_lcd_frame_write(i2c_lcd_frame_t *f, uint8_t row, uint8_t col, const char *text) {
+    if (row >= I2C_LCD_ROWS) return;
+    while (*text && col < I2C_LCD_COLS) f->rows[row][col++] = *text++;
+}
+
+bool i2c_lcd_submit(const i2c_lcd_frame_t *f) {
+    if (!s_queue) return false;
+    xQueueOverwrite(s_queue, f);   // Cola de 1: siempre gana el cuadro más nuevo
+    return true;
 }
 
-void i2c_lcd_set_backlight(bool on) {
-    s_backlight_on = on;
-    i2c_lcd_write_byte(0x00);
+bool i2c_lcd_is_ok(void) {
+    return s_ok;
 }
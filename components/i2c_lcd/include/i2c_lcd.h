@@ -10,36 +10,55 @@ extern "C" {
 // Dirección I2C (Cambiá a 0x3F si no anda con 0x27)
 #define I2C_lcd_addr 0x27 
 
-/**
- * @brief Inicializa el LCD.
- */
-void i2c_lcd_init(uint8_t addr);
+// Reloj del bus I2C. El PCF8574 está especificado a 100 kHz máximo: ese es
+// el valor por defecto. 400 kHz queda como opción (-DI2C_LCD_FREQ_HZ=400000)
+// para módulos que se prueben a esa velocidad; fuera de especificación. Los
+// retardos del HD44780 salen de la duración de cada byte y se recalculan solos.
+#ifndef I2C_LCD_FREQ_HZ
+#define I2C_LCD_FREQ_HZ 100000
+#endif
+#define I2C_LCD_PORT    0
+
+#define I2C_LCD_ROWS 4
+#define I2C_LCD_COLS 20
+
+// Cuadro completo a mostrar (sin terminadores)
+typedef struct {
+    char rows[I2C_LCD_ROWS][I2C_LCD_COLS];
+    bool backlight;
+} i2c_lcd_frame_t;
 
 /**
- * @brief Borra la pantalla.
+ * @brief Crea el bus I2C (driver i2c_master) y la tarea del display, que es
+ *        la única que lo usa. El init del LCD corre en esa tarea: no bloquea.
+ * @param sda GPIO de datos I2C
+ * @param scl GPIO de reloj I2C
+ * @param addr Dirección del PCF8574
  */
-void i2c_lcd_clear(void);
+esp_err_t i2c_lcd_start(int sda, int scl, uint8_t addr);
 
 /**
- * @brief Escribe texto.
+ * @brief Llena el cuadro de espacios.
  */
-void i2c_lcd_write_text(uint8_t row, uint8_t col, const char *text);
+void i2c_lcd_frame_clear(i2c_lcd_frame_t *f);
 
 /**
- * @brief Verifica si el LCD responde al bus I2C (Ping).
- * @return ESP_OK si responde (ACK), ESP_FAIL si no (NACK/Timeout).
+ * @brief Escribe texto en el cuadro (se corta en la columna 20).
  */
-esp_err_t i2c_lcd_is_alive(void);
+void i2c_lcd_frame_write(i2c_lcd_frame_t *f, uint8_t row, uint8_t col, const char *text);
 
 /**
- * @brief Re-inicializa el LCD para recuperar el modo si se corrompe.
+ * @brief Entrega un cuadro al servicio del display. Nunca bloquea: si había
+ *        uno pendiente se reemplaza. Al LCD van solo las celdas que cambiaron;
+ *        con el backlight apagado no se dibuja.
+ * @return false si el servicio no está arrancado
  */
-void i2c_lcd_reinit(void);
+bool i2c_lcd_submit(const i2c_lcd_frame_t *f);
 
 /**
- * @brief Enciende o apaga el backlight del LCD.
+ * @brief true si el LCD respondió a la última transferencia (o recuperación).
  */
-void i2c_lcd_set_backlight(bool on);
+bool i2c_lcd_is_ok(void);
 
 #ifdef __cplusplus
 }
@@ -1,16 +1,60 @@
 #pragma once
 #include <stdint.h>
 #include <stdbool.h>
+#include <stddef.h>
 
 // Definiciones de Tópicos
 #define MQTT_TOPIC_TELEMETRY "aire_lennox/telemetria"  // ESP32 → Node-RED (solo sensores: v, a, temps)
 #define MQTT_TOPIC_STATUS    "aire_lennox/estado"      // ESP32 → Node-RED (config actual: sys_on, fan, sp, comp)
 #define MQTT_TOPIC_CONFIG    "aire_lennox/config"      // Node-RED → ESP32 (comandos)
+#define MQTT_TOPIC_ENERGY    "aire_lennox/energia"     // ESP32 → Node-RED (kWh acumulados, cada 1 min)
+#define MQTT_TOPIC_INRUSH    "aire_lennox/arranque"    // ESP32 → Node-RED (pico de arranque del compresor)
+#define MQTT_TOPIC_SENSORS   "aire_lennox/sensores"    // ESP32 → Node-RED (tabla rol→ROM y último escaneo)
+#define MQTT_TOPIC_TELEMETRY_WINDOW "aire_lennox/telemetria/ventana" // ESP32 → Node-RED (min/max/media/último por ventana)
+#define MQTT_TOPIC_DIAG      "aire_lennox/diag"        // ESP32 → Node-RED (contadores de publicación, cada 1 min)
 
+/*
+ * Publicación desacoplada: nadie llama al cliente MQTT directamente. Cada
+ * publicación se copia a un slot preasignado de la cola de su clase y la
+ * tarea publicadora del conector la envía; si TLS se traba, se traba esa
+ * tarea y no la que publica. Encolar nunca bloquea.
+ *
+ * Con la cola de una clase llena: la telemetría pisa su mensaje más viejo
+ * (lo nuevo vale más); el resto rechaza el nuevo y devuelve false, así quien
+ * publica reintenta (estado) o lo conserva (backlog en flash).
+ */
+#define MQTT_PUB_TOPIC_MAX    48
+#define MQTT_PUB_PAYLOAD_MAX  512
+
+// Clases de prioridad: se vacía siempre primero la de menor número
+typedef enum {
+    MQTT_PUB_ALARM = 0,   // Eventos (arranque del compresor)       QoS 1
+    MQTT_PUB_STATUS,      // Estado y tabla de sensores             QoS 1
+    MQTT_PUB_TELEMETRY,   // Mediciones periódicas (pisa la más vieja)
+    MQTT_PUB_BULK,        // Reenvío del backlog, solo si sobra lugar
+    MQTT_PUB_CLASS_COUNT
+} mqtt_pub_class_t;
+
+typedef struct {
+    uint32_t depth;           // Mensajes en cola ahora
+    uint32_t capacity;
+    uint32_t depth_max;       // Máximo histórico de la cola
+    uint32_t enqueued;
+    uint32_t dropped;         // Por cola llena (el más viejo en telemetría, el nuevo en el resto)
+    uint32_t sent;
+    uint32_t failed;          // El cliente rechazó la publicación
+    uint32_t enqueue_max_us;  // Lo más que tardó un encolado
+    uint32_t wait_max_us;     // Máximo tiempo en cola hasta enviarse
+    uint32_t wait_avg_us;
+} mqtt_pub_stats_t;
 
 typedef void (*mqtt_rx_cb_t)(const char *topic, int topic_len,
                              const char *data, int data_len);
 
+// Resultado de cada mensaje de una clase, en orden de encolado. sent = el
+// cliente lo aceptó; false = lo rechazó y se perdió (quien lo encoló reintenta)
+typedef void (*mqtt_pub_done_cb_t)(bool sent);
+
 void mqtt_app_set_rx_callback(mqtt_rx_cb_t cb);
 
 /**
@@ -19,13 +63,48 @@ void mqtt_app_set_rx_callback(mqtt_rx_cb_t cb);
 void mqtt_app_start(void);
 
 /**
- * @brief Publica un mensaje JSON
+ * @brief Encola una publicación en su clase (no bloquea, seguro desde
+ *        cualquier tarea). Sin broker no encola.
+ * @param retain true = el broker guarda el último mensaje del tópico
+ * @return true si quedó en cola
+ */
+bool mqtt_app_enqueue(mqtt_pub_class_t cls, const char *topic,
+                      const void *data, size_t len, bool retain);
+
+/**
+ * @brief Publica un mensaje JSON (clase telemetría)
  * * @param topic Tópico destino
  * @param data String con el payload (JSON)
  * @return true si se encoló correctamente
  */
 bool mqtt_app_publish(const char *topic, const char *data);
 
+/**
+ * @brief Publica un payload binario (ej. CBOR) de longitud explícita
+ *        (clase telemetría)
+ * @return true si se encoló correctamente
+ */
+bool mqtt_app_publish_bin(const char *topic, const void *data, size_t len);
+
+/**
+ * @brief Publica un payload retenido con QoS 1 (clase estado: el broker
+ *        guarda el último y se lo entrega a quien se suscriba después)
+ * @return true si se encoló correctamente
+ */
+bool mqtt_app_publish_retained(const char *topic, const void *data, size_t len);
+
+/**
+ * @brief Registra el aviso de envío de una clase (ej. el backlog, que solo
+ *        da por reenviado un mensaje cuando la tarea publicadora lo envió).
+ *        Corre en la tarea publicadora: tiene que ser corto.
+ */
+void mqtt_app_set_done_callback(mqtt_pub_class_t cls, mqtt_pub_done_cb_t cb);
+
+/**
+ * @brief Copia los contadores de la cola de una clase.
+ */
+void mqtt_app_get_stats(mqtt_pub_class_t cls, mqtt_pub_stats_t *out);
+
 /**
  * @brief Verifica si estamos conectados al broker
  */
@@ -7,8 +7,11 @@
 #include <stdio.h>
 #include <string.h>
 #include <stdatomic.h>
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
 #include "esp_log.h"
 #include "esp_err.h"
+#include "esp_timer.h"
 #include "mqtt_client.h"
 #include "esp_crt_bundle.h" // Necesario para SSL/WSS automático
 #include "mqtt_connector.h"
@@ -21,6 +24,53 @@ static _Atomic esp_mqtt_client_handle_t g_client = ATOMIC_VAR_INIT(NULL);
 static atomic_bool is_connected = ATOMIC_VAR_INIT(false);
 static mqtt_rx_cb_t s_rx_cb = NULL;
 
+// --- COLA DE PUBLICACIÓN ---
+#define MQTT_PUB_TASK_STACK   4096
+#define MQTT_PUB_TASK_PRIO    3      // Debajo del control: un TLS lento no le roba CPU
+#define MQTT_PUB_IDLE_MS      1000   // Sin broker revisa la conexión cada tanto
+
+#define MQTT_PUB_SLOTS_ALARM     4
+#define MQTT_PUB_SLOTS_STATUS    4
+#define MQTT_PUB_SLOTS_TELEMETRY 8
+#define MQTT_PUB_SLOTS_BULK      4
+
+typedef struct {
+    char topic[MQTT_PUB_TOPIC_MAX];
+    uint8_t data[MQTT_PUB_PAYLOAD_MAX];
+    uint16_t len;
+    bool retain;
+    int64_t enq_us;
+} pub_slot_t;
+
+// Anillo de una clase (slots estáticos: nada de malloc al publicar)
+typedef struct {
+    pub_slot_t *slots;
+    uint8_t cap;
+    uint8_t head;
+    uint8_t count;
+    bool drop_oldest;
+    int qos;
+    mqtt_pub_done_cb_t done_cb;
+    mqtt_pub_stats_t st;
+    uint64_t wait_sum_us;
+} pub_queue_t;
+
+static pub_slot_t s_slots_alarm[MQTT_PUB_SLOTS_ALARM];
+static pub_slot_t s_slots_status[MQTT_PUB_SLOTS_STATUS];
+static pub_slot_t s_slots_telemetry[MQTT_PUB_SLOTS_TELEMETRY];
+static pub_slot_t s_slots_bulk[MQTT_PUB_SLOTS_BULK];
+
+static pub_queue_t s_queues[MQTT_PUB_CLASS_COUNT] = {
+    [MQTT_PUB_ALARM]     = { .slots = s_slots_alarm,     .cap = MQTT_PUB_SLOTS_ALARM,     .qos = 1 },
+    [MQTT_PUB_STATUS]    = { .slots = s_slots_status,    .cap = MQTT_PUB_SLOTS_STATUS,    .qos = 1 },
+    [MQTT_PUB_TELEMETRY] = { .slots = s_slots_telemetry, .cap = MQTT_PUB_SLOTS_TELEMETRY, .qos = 0, .drop_oldest = true },
+    [MQTT_PUB_BULK]      = { .slots = s_slots_bulk,      .cap = MQTT_PUB_SLOTS_BULK,      .qos = 0 },
+};
+
+// Spinlock: dentro solo índices y la copia de un slot (microsegundos)
+static portMUX_TYPE s_queue_lock = portMUX_INITIALIZER_UNLOCKED;
+static TaskHandle_t s_pub_task = NULL;
+
 // --- MANEJADOR DE EVENTOS ---
 static void mqtt_event_handler(void *handler_args, esp_event_base_t base, int32_t event_id, void *event_data) {
     esp_mqtt_event_handle_t event = event_data;
@@ -34,11 +84,14 @@ static void mqtt_event_handler(void *handler_args, esp_event_base_t base, int32_
     switch ((esp_mqtt_event_id_t)event_id) {
     case MQTT_EVENT_CONNECTED:
         ESP_LOGI(TAG, "✅ MQTT Conectado (WSS)");
-        atomic_store(&is_connected, true);
         
         // Al conectar, nos suscribimos a comandos y avisamos que estamos ONLINE
         esp_mqtt_client_publish(event->client, MQTT_TOPIC_STATUS, "ONLINE", 0, 1, 1);
         esp_mqtt_client_subscribe(event->client, MQTT_TOPIC_CONFIG, 1); // Descomentar si recibes configuración
+
+        // Recién ahora: el estado retenido que se publique al ver la conexión
+        // tiene que quedar después del "ONLINE"
+        atomic_store(&is_connected, true);
         break;
 
     case MQTT_EVENT_DISCONNECTED:
@@ -67,6 +120,58 @@ static void mqtt_event_handler(void *handler_args, esp_event_base_t base, int32_
     }
 }
 
+// Saca el mensaje más prioritario (copiado a out). false si no hay nada
+static bool pub_pop(pub_slot_t *out, mqtt_pub_class_t *cls) {
+    bool found = false;
+
+    portENTER_CRITICAL(&s_queue_lock);
+    for (int c = 0; c < MQTT_PUB_CLASS_COUNT && !found; c++) {
+        pub_queue_t *q = &s_queues[c];
+        if (q->count == 0) continue;
+        pub_slot_t *s = &q->slots[q->head];
+        memcpy(out->topic, s->topic, sizeof(out->topic));
+        memcpy(out->data, s->data, s->len);
+        out->len = s->len;
+        out->retain = s->retain;
+        out->enq_us = s->enq_us;
+        q->head = (q->head + 1) % q->cap;
+        q->count--;
+        *cls = (mqtt_pub_class_t)c;
+        found = true;
+    }
+    portEXIT_CRITICAL(&s_queue_lock);
+    return found;
+}
+
+// Tarea publicadora: la única que llama a esp_mqtt_client_publish fuera
+// del manejador de eventos. Con broker vacía las colas por prioridad.
+static void mqtt_pub_task(void *pv) {
+    static pub_slot_t tx;
+    mqtt_pub_class_t cls;
+
+    while (1) {
+        ulTaskNotifyTake(pdTRUE, pdMS_TO_TICKS(MQTT_PUB_IDLE_MS));
+
+        while (atomic_load(&is_connected) && pub_pop(&tx, &cls)) {
+            pub_queue_t *q = &s_queues[cls];
+            esp_mqtt_client_handle_t client = atomic_load(&g_client);
+            int msg_id = client ? esp_mqtt_client_publish(client, tx.topic, (const char *)tx.data,
+                                                          tx.len, q->qos, tx.retain) : -1;
+            uint32_t wait_us = (uint32_t)(esp_timer_get_time() - tx.enq_us);
+
+            portENTER_CRITICAL(&s_queue_lock);
+            if (msg_id >= 0) q->st.sent++;
+            else q->st.failed++;
+            if (wait_us > q->st.wait_max_us) q->st.wait_max_us = wait_us;
+            q->wait_sum_us += wait_us;
+            portEXIT_CRITICAL(&s_queue_lock);
+
+            if (msg_id < 0) ESP_LOGW(TAG, "Publicación rechazada en '%s'", tx.topic);
+            if (q->done_cb) q->done_cb(msg_id >= 0);
+        }
+    }
+}
+
 // --- FUNCIONES PÚBLICAS ---
 
 void mqtt_app_set_rx_callback(mqtt_rx_cb_t cb) {
@@ -124,7 +229,14 @@ void mqtt_app_start(void) {
         return;
     }
     
-    // 5. Guardar cliente globalmente y Arrancar
+    // 5. Tarea publicadora (una sola vez: sobrevive a los reinicios del cliente)
+    if (s_pub_task == NULL &&
+        xTaskCreate(mqtt_pub_task, "MqttPub", MQTT_PUB_TASK_STACK, NULL, MQTT_PUB_TASK_PRIO, &s_pub_task) != pdPASS) {
+        ESP_LOGE(TAG, "No se pudo crear la tarea publicadora");
+        s_pub_task = NULL;
+    }
+
+    // 6. Guardar cliente globalmente y Arrancar
     atomic_store(&g_client, new_client);
     
     if (esp_mqtt_client_start(new_client) != ESP_OK) {
@@ -137,17 +249,77 @@ void mqtt_app_start(void) {
     ESP_LOGI(TAG, "Cliente MQTT Iniciado.");
 }
 
-bool mqtt_app_publish(const char *topic, const char *data) {
-    if (topic == NULL || data == NULL) return false;
+bool mqtt_app_enqueue(mqtt_pub_class_t cls, const char *topic,
+                      const void *data, size_t len, bool retain) {
+    if (cls >= MQTT_PUB_CLASS_COUNT || topic == NULL || data == NULL || len == 0) return false;
+    if (len > MQTT_PUB_PAYLOAD_MAX || strlen(topic) >= MQTT_PUB_TOPIC_MAX) {
+        ESP_LOGE(TAG, "Mensaje demasiado grande para la cola ('%s', %u B)", topic, (unsigned)len);
+        return false;
+    }
+    if (s_pub_task == NULL || !atomic_load(&is_connected)) return false;
 
-    esp_mqtt_client_handle_t client = atomic_load(&g_client);
-    bool connected = atomic_load(&is_connected);
+    pub_queue_t *q = &s_queues[cls];
+    bool ok = true;
+    int64_t t0 = esp_timer_get_time();
 
-    if (client != NULL && connected) {
-        int msg_id = esp_mqtt_client_publish(client, topic, data, 0, 0, 0);
-        return (msg_id >= 0);
+    portENTER_CRITICAL(&s_queue_lock);
+    if (q->count == q->cap) {
+        q->st.dropped++;
+        if (q->drop_oldest) {
+            q->head = (q->head + 1) % q->cap;   // Se pierde la medición más vieja
+            q->count--;
+        } else {
+            ok = false;
+        }
+    }
+    if (ok) {
+        pub_slot_t *s = &q->slots[(q->head + q->count) % q->cap];
+        strcpy(s->topic, topic);
+        memcpy(s->data, data, len);
+        s->len = (uint16_t)len;
+        s->retain = retain;
+        s->enq_us = t0;
+        q->count++;
+        q->st.enqueued++;
+        if (q->count > q->st.depth_max) q->st.depth_max = q->count;
     }
-    return false;
+    uint32_t dt_us = (uint32_t)(esp_timer_get_time() - t0);
+    if (dt_us > q->st.enqueue_max_us) q->st.enqueue_max_us = dt_us;
+    portEXIT_CRITICAL(&s_queue_lock);
+
+    if (ok) xTaskNotifyGive(s_pub_task);
+    return ok;
+}
+
+bool mqtt_app_publish(const char *topic, const char *data) {
+    if (data == NULL) return false;
+    return mqtt_app_enqueue(MQTT_PUB_TELEMETRY, topic, data, strlen(data), false);
+}
+
+bool mqtt_app_publish_bin(const char *topic, const void *data, size_t len) {
+    return mqtt_app_enqueue(MQTT_PUB_TELEMETRY, topic, data, len, false);
+}
+
+bool mqtt_app_publish_retained(const char *topic, const void *data, size_t len) {
+    return mqtt_app_enqueue(MQTT_PUB_STATUS, topic, data, len, true);
+}
+
+void mqtt_app_set_done_callback(mqtt_pub_class_t cls, mqtt_pub_done_cb_t cb) {
+    if (cls >= MQTT_PUB_CLASS_COUNT) return;
+    s_queues[cls].done_cb = cb;
+}
+
+void mqtt_app_get_stats(mqtt_pub_class_t cls, mqtt_pub_stats_t *out) {
+    if (cls >= MQTT_PUB_CLASS_COUNT) return;
+    pub_queue_t *q = &s_queues[cls];
+
+    portENTER_CRITICAL(&s_queue_lock);
+    *out = q->st;
+    out->depth = q->count;
+    out->capacity = q->cap;
+    uint32_t done = q->st.sent + q->st.failed;
+    out->wait_avg_us = done ? (uint32_t)(q->wait_sum_us / done) : 0;
+    portEXIT_CRITICAL(&s_queue_lock);
 }
 
 bool mqtt_app_is_connected(void) {
@@ -0,0 +1,199 @@
+/*
+ * Puerto de host del backlog: reloj, mutex, la partición de datos como una
+ * tabla de blobs en RAM (con corrupción a pedido) y una cola BULK que solo
+ * se vacía cuando el test lo pide, avisando el resultado como la tarea
+ * publicadora del conector.
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "ac_storage.h"
+#include "esp_random.h"
+#include "esp_timer.h"
+#include "freertos/semphr.h"
+#include "host_port.h"
+#include "mqtt_connector.h"
+
+#define HOST_BLOBS     64
+#define HOST_BLOB_MAX  4096
+
+typedef struct {
+    bool used;
+    char ns[16];
+    char key[16];
+    size_t len;
+    uint8_t data[HOST_BLOB_MAX];
+} blob_t;
+
+typedef struct {
+    char topic[MQTT_PUB_TOPIC_MAX];
+    char msg[MQTT_PUB_PAYLOAD_MAX + 1];
+} host_msg_t;
+
+static blob_t s_blobs[HOST_BLOBS];
+static int64_t s_now_us = 0;
+static uint32_t s_random = 0x1234;
+static int s_mutex;
+
+static bool s_connected = false;
+static host_msg_t s_queue[HOST_MQTT_SLOTS];
+static uint32_t s_q_head = 0, s_q_count = 0;
+static mqtt_pub_done_cb_t s_done_cb[MQTT_PUB_CLASS_COUNT];
+
+// --- Reloj y RTOS ---
+
+void host_set_uptime_s(uint32_t s) {
+    s_now_us = (int64_t)s * 1000000;
+}
+
+int64_t esp_timer_get_time(void) {
+    return s_now_us;
+}
+
+uint32_t esp_random(void) {
+    return s_random += 0x9E3779B9u;
+}
+
+SemaphoreHandle_t xSemaphoreCreateMutex(void) {
+    s_mutex = 0;
+    return &s_mutex;
+}
+
+bool xSemaphoreTake(SemaphoreHandle_t s, uint32_t ticks) {
+    (void)ticks;
+    if (*s) {
+        fprintf(stderr, "❌ Mutex tomado dos veces (en el ESP32 sería un deadlock)\n");
+        abort();
+    }
+    *s = 1;
+    return true;
+}
+
+bool xSemaphoreGive(SemaphoreHandle_t s) {
+    *s = 0;
+    return true;
+}
+
+// --- Partición de datos ---
+
+static blob_t *blob_find(const char *ns, const char *key) {
+    for (int k = 0; k < HOST_BLOBS; k++) {
+        if (s_blobs[k].used && strcmp(s_blobs[k].ns, ns) == 0 && strcmp(s_blobs[k].key, key) == 0) {
+            return &s_blobs[k];
+        }
+    }
+    return NULL;
+}
+
+bool storage_data_save(const char *ns, const char *key, const void *data, size_t len) {
+    blob_t *b = blob_find(ns, key);
+
+    for (int k = 0; k < HOST_BLOBS && b == NULL; k++) {
+        if (!s_blobs[k].used) b = &s_blobs[k];
+    }
+    if (b == NULL || len > HOST_BLOB_MAX) return false;
+    b->used = true;
+    snprintf(b->ns, sizeof(b->ns), "%s", ns);
+    snprintf(b->key, sizeof(b->key), "%s", key);
+    memcpy(b->data, data, len);
+    b->len = len;
+    return true;
+}
+
+bool storage_data_load(const char *ns, const char *key, void *data, size_t len) {
+    blob_t *b = blob_find(ns, key);
+    if (b == NULL || b->len != len) return false;
+    memcpy(data, b->data, len);
+    return true;
+}
+
+bool storage_data_load_var(const char *ns, const char *key, void *data, size_t max, size_t *len) {
+    blob_t *b = blob_find(ns, key);
+    if (b == NULL || b->len > max) return false;
+    memcpy(data, b->data, b->len);
+    *len = b->len;
+    return true;
+}
+
+bool storage_data_erase_ns(const char *ns) {
+    for (int k = 0; k < HOST_BLOBS; k++) {
+        if (s_blobs[k].used && strcmp(s_blobs[k].ns, ns) == 0) s_blobs[k].used = false;
+    }
+    return true;
+}
+
+void host_storage_clear(void) {
+    memset(s_blobs, 0, sizeof(s_blobs));
+}
+
+bool host_storage_corrupt(const char *ns, const char *key) {
+    blob_t *b = blob_find(ns, key);
+    if (b == NULL) return false;
+    b->len--;   // Largo que no cierra con la cabecera
+    return true;
+}
+
+size_t host_storage_used(const char *ns) {
+    size_t n = 0;
+    for (int k = 0; k < HOST_BLOBS; k++) {
+        if (s_blobs[k].used && strcmp(s_blobs[k].ns, ns) == 0) n += s_blobs[k].len;
+    }
+    return n;
+}
+
+uint32_t host_storage_blobs(const char *ns) {
+    uint32_t n = 0;
+    for (int k = 0; k < HOST_BLOBS; k++) {
+        if (s_blobs[k].used && strcmp(s_blobs[k].ns, ns) == 0) n++;
+    }
+    return n;
+}
+
+// --- Broker ---
+
+bool mqtt_app_is_connected(void) {
+    return s_connected;
+}
+
+void mqtt_app_set_done_callback(mqtt_pub_class_t cls, mqtt_pub_done_cb_t cb) {
+    s_done_cb[cls] = cb;
+}
+
+bool mqtt_app_enqueue(mqtt_pub_class_t cls, const char *topic,
+                      const void *data, size_t len, bool retain) {
+    (void)retain;
+    if (cls != MQTT_PUB_BULK || !s_connected || s_q_count == HOST_MQTT_SLOTS ||
+        len > MQTT_PUB_PAYLOAD_MAX || strlen(topic) >= MQTT_PUB_TOPIC_MAX) {
+        return false;
+    }
+    host_msg_t *m = &s_queue[(s_q_head + s_q_count) % HOST_MQTT_SLOTS];
+    strcpy(m->topic, topic);
+    memcpy(m->msg, data, len);
+    m->msg[len] = '\0';
+    s_q_count++;
+    return true;
+}
+
+void host_mqtt_set_connected(bool connected) {
+    s_connected = connected;
+}
+
+uint32_t host_mqtt_queued(void) {
+    return s_q_count;
+}
+
+bool host_mqtt_deliver(bool sent, char *topic, size_t topic_len, char *msg, size_t msg_len) {
+    if (s_q_count == 0) return false;
+    host_msg_t *m = &s_queue[s_q_head];
+    if (topic) snprintf(topic, topic_len, "%s", m->topic);
+    if (msg) snprintf(msg, msg_len, "%s", m->msg);
+    s_q_head = (s_q_head + 1) % HOST_MQTT_SLOTS;
+    s_q_count--;
+    if (s_done_cb[MQTT_PUB_BULK]) s_done_cb[MQTT_PUB_BULK](sent);
+    return true;
+}
+
+void host_mqtt_flush(void) {
+    s_q_head = 0;
+    s_q_count = 0;
+}
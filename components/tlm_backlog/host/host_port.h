@@ -0,0 +1,25 @@
+/*
+ * Puerto de host del backlog: NVS en RAM y una cola BULK de mentira que el
+ * test vacía a mano, con el aviso de envío de la tarea publicadora.
+ */
+#pragma once
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#define HOST_MQTT_SLOTS 4          // Igual que MQTT_PUB_SLOTS_BULK
+
+void host_set_uptime_s(uint32_t s);
+
+// NVS simulada
+void host_storage_clear(void);
+bool host_storage_corrupt(const char *ns, const char *key);
+size_t host_storage_used(const char *ns);          // Bytes en blobs del espacio de nombres
+uint32_t host_storage_blobs(const char *ns);
+
+// Broker simulado
+void host_mqtt_set_connected(bool connected);
+uint32_t host_mqtt_queued(void);
+// Saca el primer mensaje encolado y avisa el resultado; false si no había
+bool host_mqtt_deliver(bool sent, char *topic, size_t topic_len, char *msg, size_t msg_len);
+void host_mqtt_flush(void);                        // Se pierde lo encolado (reinicio)
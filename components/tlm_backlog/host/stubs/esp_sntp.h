@@ -0,0 +1,7 @@
+// Sin SNTP en el host: la hora es la del sistema
+#pragma once
+
+#define SNTP_OPMODE_POLL 0
+#define esp_sntp_setoperatingmode(mode)   ((void)(mode))
+#define esp_sntp_setservername(idx, name) ((void)(idx), (void)(name))
+#define esp_sntp_init()                   ((void)0)
@@ -0,0 +1,5 @@
+// Un solo hilo en el host: el aviso de envío corre en la misma tarea
+#pragma once
+#include <stdint.h>
+
+#define portMAX_DELAY 0xFFFFFFFFu
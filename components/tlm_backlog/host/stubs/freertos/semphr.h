@@ -0,0 +1,10 @@
+// Mutex del host: un contador para detectar tomas anidadas (deadlock en el ESP32)
+#pragma once
+#include <stdbool.h>
+#include "freertos/FreeRTOS.h"
+
+typedef int *SemaphoreHandle_t;
+
+SemaphoreHandle_t xSemaphoreCreateMutex(void);
+bool xSemaphoreTake(SemaphoreHandle_t s, uint32_t ticks);
+bool xSemaphoreGive(SemaphoreHandle_t s);
@@ -0,0 +1,308 @@
+/*
+ * tlm_backlog sobre NVS y broker simulados:
+ *   - capacidad del anillo (horas a una muestra cada 10 s) y lo que ocupa,
+ *   - anillo lleno: se pierde la página más vieja y el resto sale en orden,
+ *   - el tail avanza recién con el aviso de envío: lo encolado y no enviado
+ *     vuelve a salir tras un corte y reinicio,
+ *   - un envío fallido rebobina y se reenvía,
+ *   - "ts": guardado, reconstruido en el mismo arranque, 0 de otro arranque,
+ *   - ventanas agregadas: salen igual que en vivo, a su propio tópico,
+ *   - página ilegible y formato viejo no traban el anillo.
+ * Incluye el .c para poder "reiniciar" (poner en cero su estado en RAM).
+ */
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+static time_t s_epoch = 1760000000;   // 0 = SNTP sin sincronizar
+static time_t host_time(time_t *out) {
+    if (out) *out = s_epoch;
+    return s_epoch;
+}
+#define time(p) host_time(p)
+#include "../tlm_backlog.c"
+#undef time
+
+#include "host_port.h"
+
+#define STORE_S 10                     // Una muestra a flash cada 10 s (main.c)
+#define PER_PAGE (TLM_BACKLOG_PAGE_LEN / TLM_REC_LEN)
+
+static bool s_ok = true;
+static uint32_t s_uptime = 0;
+
+static void expect(bool cond, const char *what) {
+    printf("  %s %s\n", cond ? "✅" : "❌", what);
+    s_ok &= cond;
+}
+
+static tlm_telemetry_t sample(int id) {
+    tlm_telemetry_t t = {
+        .v = 220.5f, .a = 3.25f, .w = (float)id, .va = 715.0f, .var = -318.0f, .pf = 0.9f,
+        .hz = 50.02f, .thd = 12.3f, .h3 = 10.1f, .h5 = 5.2f, .h7 = 2.4f,
+        .amb = 24.56f, .out = NAN, .coil = 8.5f,
+    };
+    return t;
+}
+
+// Reinicio del equipo: lo encolado se pierde, la flash queda
+static void reboot(void) {
+    host_mqtt_flush();
+    s_lock = NULL;
+    memset(&s_meta, 0, sizeof(s_meta));
+    memset(&s_head_pg, 0, sizeof(s_head_pg));
+    s_errors = 0;
+    s_last_replay_us = 0;
+    s_meta_dirty = false;
+    s_read_idx = -1;
+    s_tail_seq = s_next_seq = 0;
+    s_inflight_head = s_inflight_n = 0;
+    s_uptime = 0;
+    host_set_uptime_s(0);
+    tlm_backlog_init();
+}
+
+static void fresh(void) {
+    host_storage_clear();
+    host_mqtt_set_connected(false);
+    s_epoch = 1760000000;
+    reboot();
+}
+
+static void push(int id) {
+    tlm_telemetry_t t = sample(id);
+    s_uptime += STORE_S;
+    host_set_uptime_s(s_uptime);
+    tlm_backlog_push_telemetry(&t);
+}
+
+// Una vuelta del loop: pasa el intervalo de reenvío y llama al servicio
+static int service(void) {
+    s_uptime += BACKLOG_REPLAY_MS / 1000;
+    host_set_uptime_s(s_uptime);
+    return tlm_backlog_service();
+}
+
+// Id (campo "w") del próximo mensaje entregado; -1 si no había
+static int deliver(bool sent, char *msg, size_t len) {
+    char topic[MQTT_PUB_TOPIC_MAX], buf[MQTT_PUB_PAYLOAD_MAX + 1];
+    if (!msg) { msg = buf; len = sizeof(buf); }
+    if (!host_mqtt_deliver(sent, topic, sizeof(topic), msg, len)) return -1;
+    const char *w = strstr(msg, "\"w\":");
+    return w ? atoi(w + 4) : -2;
+}
+
+static uint32_t pending(void) {
+    tlm_backlog_stats_t st;
+    tlm_backlog_get_stats(&st);
+    return st.count;
+}
+
+// Reenvía todo, confirmando cada mensaje; devuelve cuántos salieron
+static int drain(int *ids, int max) {
+    int n = 0;
+    host_mqtt_set_connected(true);
+    for (int guard = 0; pending() > 0 && guard < 10000; guard++) {
+        service();
+        int id;
+        while ((id = deliver(true, NULL, 0)) != -1) {
+            if (n < max) ids[n] = id;
+            n++;
+        }
+    }
+    return n;
+}
+
+static void test_capacity(void) {
+    static int ids[2 * BACKLOG_CAPACITY];
+    tlm_backlog_stats_t st;
+    char what[128];
+
+    printf("📦 Capacidad y anillo lleno\n");
+    fresh();
+    for (int k = 0; k < (int)BACKLOG_CAPACITY; k++) push(k);
+    tlm_backlog_get_stats(&st);
+    snprintf(what, sizeof(what), "%lu muestras ≈ %.1f h a una cada %d s, %zu B en %lu blobs NVS",
+             (unsigned long)st.count, st.count * STORE_S / 3600.0, STORE_S,
+             host_storage_used(BACKLOG_NVS_NS), (unsigned long)host_storage_blobs(BACKLOG_NVS_NS));
+    expect(st.count == st.capacity && st.dropped == 0 && st.count * STORE_S >= 3 * 3600, what);
+
+    push((int)BACKLOG_CAPACITY);
+    tlm_backlog_get_stats(&st);
+    snprintf(what, sizeof(what), "una más pisa la página más vieja (%lu perdidas)", (unsigned long)st.dropped);
+    expect(st.dropped == PER_PAGE && st.count == BACKLOG_CAPACITY - PER_PAGE + 1, what);
+
+    int n = drain(ids, 2 * BACKLOG_CAPACITY);
+    bool order = n == (int)(BACKLOG_CAPACITY - PER_PAGE + 1);
+    for (int k = 0; k < n && order; k++) order = ids[k] == (int)PER_PAGE + k;
+    tlm_backlog_get_stats(&st);
+    expect(order && st.replayed == (uint32_t)n, "el resto sale completo y en orden");
+}
+
+static void test_confirm(void) {
+    printf("📮 El tail espera el aviso de envío\n");
+    fresh();
+    for (int k = 0; k < 10; k++) push(k);
+    host_mqtt_set_connected(true);
+    service();
+    expect(host_mqtt_queued() == BACKLOG_REPLAY_BATCH && pending() == 10,
+           "encolados pero no enviados: siguen pendientes");
+    deliver(true, NULL, 0);
+    deliver(true, NULL, 0);
+    expect(pending() == 8, "dos avisos de envío → dos menos");
+
+    // Corte con 2 en la cola del publicador; la vuelta siguiente guarda los
+    // avisos y después se reinicia
+    host_mqtt_set_connected(false);
+    service();
+    reboot();
+    expect(pending() == 8, "tras reiniciar quedan los 8 sin aviso");
+    host_mqtt_set_connected(true);
+    service();
+    expect(deliver(true, NULL, 0) == 2, "el reenvío arranca por el primero sin aviso");
+}
+
+static void test_failed(void) {
+    int ids[32];
+
+    printf("🔁 Envío fallido\n");
+    fresh();
+    for (int k = 0; k < 6; k++) push(k);
+    host_mqtt_set_connected(true);
+    service();
+    expect(deliver(false, NULL, 0) == 0, "el primero falla");
+    for (int k = 0; k < 3; k++) deliver(true, NULL, 0);
+    expect(pending() == 6, "los siguientes no pasan el tail");
+    service();
+    expect(deliver(true, NULL, 0) == 0, "se vuelve a mandar desde el fallido");
+    int n = drain(ids, 32);
+    expect(pending() == 0 && n == 5 && ids[0] == 1 && ids[4] == 5, "después sale el resto");
+}
+
+static void test_ts(void) {
+    char msg[MQTT_PUB_PAYLOAD_MAX + 1], want[MQTT_PUB_PAYLOAD_MAX + 1];
+    uint8_t json[MQTT_PUB_PAYLOAD_MAX];
+    char topic[MQTT_PUB_TOPIC_MAX];
+
+    printf("🕒 Campo ts y payload\n");
+    fresh();
+    push(7);                           // Con hora: ts guardado
+    s_epoch = 0;
+    push(8);                           // Sin hora, uptime 20 s
+    s_epoch = 1760000500;              // SNTP sincroniza 40 s después
+    s_uptime += 40 - BACKLOG_REPLAY_MS / 1000;
+    host_mqtt_set_connected(true);
+    service();
+
+    tlm_telemetry_t t = sample(7);
+    size_t n = tlm_encode_telemetry(TLM_FMT_JSON, &t, json, sizeof(json));
+    snprintf(want, sizeof(want), "{\"ts\":1760000000,%.*s", (int)n - 1, (const char *)json + 1);
+    host_mqtt_deliver(true, topic, sizeof(topic), msg, sizeof(msg));
+    expect(strcmp(msg, want) == 0 && strcmp(topic, "aire_lennox/telemetria/historico") == 0,
+           "mismo JSON que en vivo (out null) con ts al principio");
+    printf("     %s\n", msg);
+    host_mqtt_deliver(true, NULL, 0, msg, sizeof(msg));
+    expect(strncmp(msg, "{\"ts\":1760000460,", 17) == 0, "sin hora: ts = ahora - tiempo transcurrido");
+
+    s_epoch = 0;
+    push(9);
+    host_mqtt_set_connected(false);
+    reboot();
+    s_epoch = 1760001000;
+    host_mqtt_set_connected(true);
+    service();
+    host_mqtt_deliver(true, NULL, 0, msg, sizeof(msg));
+    expect(strncmp(msg, "{\"ts\":0,", 8) == 0, "sin hora y de otro arranque: ts 0");
+}
+
+static void test_window(void) {
+    char msg[MQTT_PUB_PAYLOAD_MAX + 1], want[MQTT_PUB_PAYLOAD_MAX + 1];
+    uint8_t json[MQTT_PUB_PAYLOAD_MAX];
+    char topic[MQTT_PUB_TOPIC_MAX];
+    tlm_agg_t agg;
+    char what[96];
+
+    printf("🪟 Ventanas agregadas\n");
+    fresh();
+
+    // Ventana completa: los 14 campos, como con el medidor andando
+    tlm_telemetry_t t = sample(640);
+    float vals[TLM_KEY_COUNT];
+    tlm_telemetry_to_array(&t, vals);
+    vals[TLM_KEY_OUT] = 31.25f;
+    tlm_agg_reset(&agg);
+    for (int k = 0; k < TLM_KEY_COUNT; k++) {
+        tlm_agg_add(&agg, k, vals[k]);
+        tlm_agg_add(&agg, k, vals[k] + 2.0f);   // Media sin empates en .5 (printf y roundf difieren)
+    }
+    s_uptime += 60;
+    host_set_uptime_s(s_uptime);
+    tlm_backlog_push_window(&agg, 60);
+
+    // Solo dos campos (el resto sin muestras)
+    tlm_agg_t partial;
+    tlm_agg_reset(&partial);
+    tlm_agg_add(&partial, TLM_KEY_A, 3.0f);
+    tlm_agg_add(&partial, TLM_KEY_A, 12.0f);
+    tlm_agg_add(&partial, TLM_KEY_COIL, 6.25f);
+    tlm_backlog_push_window(&partial, 10);
+    push(1);                           // Una muestra suelta en medio no molesta
+
+    snprintf(what, sizeof(what), "ventana completa %u B, de 2 campos %u B en flash",
+             (unsigned)(sizeof(backlog_hdr_t) + WINDOW_HDR_LEN + TLM_KEY_COUNT * 8),
+             (unsigned)(sizeof(backlog_hdr_t) + WINDOW_HDR_LEN + 2 * 8));
+    expect(pending() == 3, what);
+
+    host_mqtt_set_connected(true);
+    service();
+    size_t n = tlm_encode_window(TLM_FMT_JSON, &agg, 60, json, sizeof(json));
+    snprintf(want, sizeof(want), "{\"ts\":1760000000,%.*s", (int)n - 1, (const char *)json + 1);
+    host_mqtt_deliver(true, topic, sizeof(topic), msg, sizeof(msg));
+    expect(strcmp(msg, want) == 0 && strcmp(topic, "aire_lennox/telemetria/ventana/historico") == 0,
+           "ventana completa: mismo JSON que en vivo con ts");
+    printf("     %zu B: %.60s...\n", strlen(msg), msg);
+
+    n = tlm_encode_window(TLM_FMT_JSON, &partial, 10, json, sizeof(json));
+    snprintf(want, sizeof(want), "{\"ts\":1760000000,%.*s", (int)n - 1, (const char *)json + 1);
+    host_mqtt_deliver(true, NULL, 0, msg, sizeof(msg));
+    expect(strcmp(msg, want) == 0, "ventana parcial: solo los campos con datos");
+    printf("     %s\n", msg);
+    expect(deliver(true, NULL, 0) == 1 && pending() == 0, "la muestra suelta sale después, en orden");
+}
+
+static void test_corrupt(void) {
+    int ids[256];
+    tlm_backlog_stats_t st;
+
+    printf("🧱 Flash dañada\n");
+    fresh();
+    for (int k = 0; k < 2 * (int)PER_PAGE + 3; k++) push(k);
+    expect(host_storage_corrupt(BACKLOG_NVS_NS, "p01"), "página del medio ilegible");
+    int n = drain(ids, 256);
+    tlm_backlog_get_stats(&st);
+    expect(pending() == 0 && n == (int)PER_PAGE + 3 && ids[PER_PAGE] == 2 * (int)PER_PAGE && st.errors > 0,
+           "se saltea esa página y sale el resto");
+
+    // Formato anterior (un slot por mensaje): se borra al arrancar
+    uint32_t old_meta[6] = { 1, 3, 3, 0, 0, 0 };
+    char old_slot[268] = "{\"v\":1}";
+    host_storage_clear();
+    storage_data_save(BACKLOG_NVS_NS, BACKLOG_META_KEY, old_meta, sizeof(old_meta));
+    storage_data_save(BACKLOG_NVS_NS, "r00", old_slot, sizeof(old_slot));
+    reboot();
+    expect(host_storage_blobs(BACKLOG_NVS_NS) == 0 && pending() == 0, "formato viejo: espacio liberado");
+}
+
+int main(void) {
+    test_capacity();
+    test_confirm();
+    test_failed();
+    test_ts();
+    test_window();
+    test_corrupt();
+
+    printf("%s tlm_backlog\n", s_ok ? "✅" : "❌");
+    return s_ok ? 0 : 1;
+}
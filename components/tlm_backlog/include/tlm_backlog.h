@@ -0,0 +1,78 @@
+#pragma once
+#include <stdint.h>
+#include <stdbool.h>
+#include "tlm_codec.h"
+#include "tlm_agg.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/*
+ * Buffer "store-and-forward" de telemetría en la partición de datos
+ * (STORAGE_DATA_PARTITION). Sin broker las muestras sueltas o las ventanas
+ * agregadas se fechan y se guardan compactas (16 bits por valor, ver
+ * tlm_pack_value) en páginas de varios registros; al reconectar se reenvían
+ * en JSON de a lotes chicos al tópico "<tópico>/historico" con el campo "ts"
+ * (epoch, SNTP).
+ *
+ * Un registro sale del anillo recién cuando la tarea publicadora avisa que lo
+ * envió: si se corta en el medio o se reinicia, se reenvía (al menos una vez;
+ * el suscriptor descarta repetidos por "ts").
+ */
+
+#define TLM_BACKLOG_PAGES     20      // Páginas del anillo (un blob NVS de ~2 KB cada una)
+#define TLM_BACKLOG_PAGE_LEN  2016    // Bytes de registros por página
+
+typedef struct {
+    uint32_t count;      // Registros guardados pendientes de reenvío
+    uint32_t capacity;   // Muestras sueltas que entran en el anillo
+    uint32_t stored;     // Total guardados (desde que existe el anillo)
+    uint32_t replayed;   // Total reenviados (confirmados por la tarea publicadora)
+    uint32_t dropped;    // Pisados por anillo lleno (se pierde la página más vieja)
+    uint32_t errors;     // Fallas de lectura/escritura en flash
+} tlm_backlog_stats_t;
+
+/**
+ * @brief Restaura el anillo desde flash y arranca SNTP para fechar los
+ *        mensajes. Llamar después de storage_init() y de levantar la red.
+ */
+void tlm_backlog_init(void);
+
+/**
+ * @brief Fecha y guarda una muestra de telemetría para reenviarla después.
+ *        Si el anillo está lleno pisa la página más vieja (cuenta en dropped).
+ * @return true si quedó escrita en flash
+ */
+bool tlm_backlog_push_telemetry(const tlm_telemetry_t *t);
+
+/**
+ * @brief Fecha (al cierre) y guarda una ventana agregada: por campo con datos
+ *        [min, max, media, último], ~120 B con los 14 campos. Se reenvía
+ *        como la ventana en vivo (tlm_encode_window) más "ts".
+ * @param period_s Duración real de la ventana (campo "dt", hasta 65535 s)
+ * @return true si quedó escrita en flash
+ */
+bool tlm_backlog_push_window(const tlm_agg_t *agg, uint32_t period_s);
+
+/**
+ * @brief Con broker conectado reenvía un lote del backlog, como máximo cada
+ *        TLM_BACKLOG_REPLAY_MS. Llamar después de las publicaciones en vivo
+ *        de la vuelta: un lote es corto y nunca las demora.
+ * @return Mensajes encolados en esta llamada
+ */
+int tlm_backlog_service(void);
+
+/**
+ * @brief Copia los contadores y el nivel de llenado.
+ */
+void tlm_backlog_get_stats(tlm_backlog_stats_t *out);
+
+/**
+ * @brief Hora actual en epoch (s), 0 si SNTP todavía no sincronizó.
+ */
+uint32_t tlm_backlog_now(void);
+
+#ifdef __cplusplus
+}
+#endif
@@ -0,0 +1,477 @@
+/**
+ * @file tlm_backlog.c
+ * @brief Anillo de telemetría en flash para no perder datos sin broker
+ */
+
+#include <stdio.h>
+#include <string.h>
+#include <stddef.h>
+#include <time.h>
+#include "freertos/FreeRTOS.h"
+#include "freertos/semphr.h"
+#include "esp_log.h"
+#include "esp_timer.h"
+#include "esp_random.h"
+#include "esp_sntp.h"
+#include "tlm_backlog.h"
+#include "tlm_codec.h"
+#include "ac_storage.h"
+#include "mqtt_connector.h"
+
+static const char *TAG = "TLM_BACKLOG";
+
+#define BACKLOG_NVS_NS        "backlog"
+#define BACKLOG_META_KEY      "meta"
+#define BACKLOG_VERSION       2        // 2: páginas de registros compactos
+#define BACKLOG_REPLAY_MS     1000     // Un lote por segundo como máximo
+#define BACKLOG_REPLAY_BATCH  4        // Mensajes por lote
+#define BACKLOG_INFLIGHT_MAX  8        // Encolados sin aviso de envío (la cola BULK tiene 4)
+#define BACKLOG_TIME_VALID    1600000000u  // Antes de 2020 = reloj sin sincronizar
+#define BACKLOG_SNTP_SERVER   "pool.ntp.org"
+
+// Tipos de registro
+#define BACKLOG_KIND_TELEMETRY 1       // int16_t[TLM_KEY_COUNT] (tlm_pack_value)
+#define BACKLOG_KIND_WINDOW    2       // backlog_window_t hasta el último campo con datos
+
+#define BACKLOG_F_UPTIME 0x01          // t es el uptime (s) del arranque de la página: sin hora
+
+// Índices y contadores (se guardan tras cada escritura o lote reenviado)
+typedef struct {
+    uint32_t version;
+    uint16_t head;       // Página que se está llenando
+    uint16_t tail;       // Página del registro pendiente más viejo
+    uint16_t tail_rec;   // Primer registro pendiente dentro de tail
+    uint16_t reserved;
+    uint32_t count;      // Registros pendientes
+    uint32_t stored;
+    uint32_t replayed;
+    uint32_t dropped;
+    uint8_t nrec[TLM_BACKLOG_PAGES];   // Registros escritos por página
+} backlog_meta_t;
+
+// Cabecera de cada registro dentro de la página (el cuerpo va a continuación)
+typedef struct {
+    uint32_t t;          // Epoch, o uptime si BACKLOG_F_UPTIME
+    uint8_t kind;
+    uint8_t flags;
+    uint16_t len;        // Bytes del cuerpo
+} backlog_hdr_t;
+
+// Página: se guarda solo hasta data[used] (storage_data_load_var)
+typedef struct {
+    uint32_t boot;       // Arranque en que se escribió (para reconstruir ts)
+    uint16_t used;
+    uint16_t reserved;
+    uint8_t data[TLM_BACKLOG_PAGE_LEN];
+} backlog_page_t;
+
+// Ventana agregada: solo los campos de mask, en orden de clave
+typedef struct {
+    uint16_t dt;         // Duración (s)
+    uint16_t mask;       // Bit k = campo TLM_KEY_k con datos
+    int16_t q[TLM_KEY_COUNT][4];   // min, max, media, último (tlm_pack_value)
+} backlog_window_t;
+
+#define WINDOW_HDR_LEN   offsetof(backlog_window_t, q)
+#define PAGE_HDR_LEN     offsetof(backlog_page_t, data)
+#define TLM_REC_LEN      (sizeof(backlog_hdr_t) + TLM_KEY_COUNT * sizeof(int16_t))
+#define BACKLOG_CAPACITY (TLM_BACKLOG_PAGES * (TLM_BACKLOG_PAGE_LEN / TLM_REC_LEN))
+
+static SemaphoreHandle_t s_lock = NULL;
+static backlog_meta_t s_meta;
+static uint32_t s_errors = 0;
+static uint32_t s_boot = 0;
+static int64_t s_last_replay_us = 0;
+static bool s_meta_dirty = false;
+
+static backlog_page_t s_head_pg;        // La página head vive en RAM (se reescribe entera)
+static backlog_page_t s_read_pg;        // Última página leída para reenviar
+static int s_read_idx = -1;
+
+// Reenvío por número de registro (solo en RAM): s_tail_seq es el pendiente
+// más viejo, s_next_seq el próximo a encolar. Los encolados esperan el aviso
+// de la tarea publicadora en una FIFO, en el mismo orden que la cola BULK.
+static uint32_t s_tail_seq = 0;
+static uint32_t s_next_seq = 0;
+static uint32_t s_inflight[BACKLOG_INFLIGHT_MAX];
+static uint32_t s_inflight_head = 0;
+static uint32_t s_inflight_n = 0;
+
+static void page_key(uint32_t page, char key[8]) {
+    snprintf(key, 8, "p%02lu", (unsigned long)page);
+}
+
+static uint32_t page_next(uint32_t page) {
+    return (page + 1) % TLM_BACKLOG_PAGES;
+}
+
+static void meta_save(void) {
+    if (!storage_data_save(BACKLOG_NVS_NS, BACKLOG_META_KEY, &s_meta, sizeof(s_meta))) s_errors++;
+    s_meta_dirty = false;
+}
+
+static bool head_save(void) {
+    char key[8];
+    page_key(s_meta.head, key);
+    return storage_data_save(BACKLOG_NVS_NS, key, &s_head_pg, PAGE_HDR_LEN + s_head_pg.used);
+}
+
+static void head_reset(void) {
+    s_head_pg.boot = s_boot;
+    s_head_pg.used = 0;
+    s_meta.nrec[s_meta.head] = 0;
+    if (s_read_idx == (int)s_meta.head) s_read_idx = -1;
+}
+
+// Avanza el tail sobre las páginas ya reenviadas (nunca pasa al head)
+static void tail_normalize(void) {
+    while (s_meta.tail != s_meta.head && s_meta.tail_rec >= s_meta.nrec[s_meta.tail]) {
+        s_meta.tail = page_next(s_meta.tail);
+        s_meta.tail_rec = 0;
+    }
+}
+
+// Descarta lo que queda de la página tail (anillo lleno o página ilegible)
+static uint32_t tail_drop_page(void) {
+    uint32_t lost = s_meta.nrec[s_meta.tail] - s_meta.tail_rec;
+
+    s_meta.count -= lost;
+    s_tail_seq += lost;
+    if ((int32_t)(s_next_seq - s_tail_seq) < 0) s_next_seq = s_tail_seq;
+    s_meta.tail_rec = s_meta.nrec[s_meta.tail];
+    tail_normalize();
+    return lost;
+}
+
+// Descarta una página pendiente que no se puede reenviar
+static void page_discard(uint32_t page) {
+    if (page == s_meta.tail) {
+        tail_drop_page();
+    } else {
+        s_meta.count -= s_meta.nrec[page];
+        s_meta.nrec[page] = 0;
+    }
+    if (page == s_meta.head) head_reset();
+    if (s_read_idx == (int)page) s_read_idx = -1;
+    s_meta_dirty = true;
+}
+
+// Página nueva para escribir; con el anillo lleno se pisa la más vieja
+static void head_advance(void) {
+    uint32_t next = page_next(s_meta.head);
+
+    if (next == s_meta.tail) {
+        uint32_t lost = tail_drop_page();
+        s_meta.dropped += lost;
+        ESP_LOGW(TAG, "Backlog lleno: se pierden %lu registros viejos", (unsigned long)lost);
+    }
+    s_meta.head = next;
+    head_reset();
+}
+
+// Lee y valida una página (el head ya está en RAM). NULL si no se pudo
+static const backlog_page_t *page_get(uint32_t page) {
+    char key[8];
+    size_t len;
+
+    if (page == s_meta.head) return &s_head_pg;
+    if (s_read_idx == (int)page) return &s_read_pg;
+
+    s_read_idx = -1;
+    page_key(page, key);
+    if (!storage_data_load_var(BACKLOG_NVS_NS, key, &s_read_pg, sizeof(s_read_pg), &len) ||
+        len < PAGE_HDR_LEN || len != PAGE_HDR_LEN + s_read_pg.used) {
+        return NULL;
+    }
+
+    // Los registros tienen que cubrir justo lo usado
+    uint32_t off = 0, n = 0;
+    while (off + sizeof(backlog_hdr_t) <= s_read_pg.used) {
+        backlog_hdr_t hdr;
+        memcpy(&hdr, s_read_pg.data + off, sizeof(hdr));
+        off += sizeof(hdr) + hdr.len;
+        n++;
+    }
+    if (off != s_read_pg.used || n < s_meta.nrec[page]) return NULL;
+
+    s_read_idx = (int)page;
+    return &s_read_pg;
+}
+
+// Registro rec de una página válida: cabecera y puntero al cuerpo
+static const uint8_t *page_record(const backlog_page_t *pg, uint32_t rec, backlog_hdr_t *hdr) {
+    uint32_t off = 0;
+
+    for (uint32_t k = 0; ; k++) {
+        memcpy(hdr, pg->data + off, sizeof(*hdr));
+        if (k == rec) return pg->data + off + sizeof(*hdr);
+        off += sizeof(*hdr) + hdr->len;
+    }
+}
+
+uint32_t tlm_backlog_now(void) {
+    time_t now = time(NULL);
+    return (now >= (time_t)BACKLOG_TIME_VALID) ? (uint32_t)now : 0;
+}
+
+// Aviso de la tarea publicadora por cada mensaje BULK, en orden de encolado
+static void on_bulk_done(bool sent) {
+    xSemaphoreTake(s_lock, portMAX_DELAY);
+    if (s_inflight_n > 0) {
+        uint32_t seq = s_inflight[s_inflight_head];
+        s_inflight_head = (s_inflight_head + 1) % BACKLOG_INFLIGHT_MAX;
+        s_inflight_n--;
+
+        if (sent && seq == s_tail_seq && s_meta.count > 0) {
+            s_meta.tail_rec++;
+            s_meta.count--;
+            s_meta.replayed++;
+            s_tail_seq++;
+            tail_normalize();
+            s_meta_dirty = true;
+        } else if (!sent && (int32_t)(seq - s_tail_seq) >= 0) {
+            s_next_seq = s_tail_seq;   // Se perdió: volver a mandar desde el tail
+        }
+    }
+    xSemaphoreGive(s_lock);
+}
+
+static bool meta_valid(void) {
+    uint32_t count = 0;
+
+    if (s_meta.version != BACKLOG_VERSION || s_meta.head >= TLM_BACKLOG_PAGES ||
+        s_meta.tail >= TLM_BACKLOG_PAGES || s_meta.tail_rec > s_meta.nrec[s_meta.tail]) {
+        return false;
+    }
+    for (uint32_t p = s_meta.tail; ; p = page_next(p)) {
+        count += s_meta.nrec[p];
+        if (p == s_meta.head) break;
+    }
+    return count - s_meta.tail_rec == s_meta.count;
+}
+
+void tlm_backlog_init(void) {
+    size_t len;
+
+    s_lock = xSemaphoreCreateMutex();
+    s_boot = esp_random();
+
+    bool loaded = storage_data_load(BACKLOG_NVS_NS, BACKLOG_META_KEY, &s_meta, sizeof(s_meta));
+    if (!loaded || !meta_valid()) {
+        // Formato viejo o registro roto: liberar el espacio de las páginas
+        if (!loaded) storage_data_erase_ns(BACKLOG_NVS_NS);
+        memset(&s_meta, 0, sizeof(s_meta));
+        s_meta.version = BACKLOG_VERSION;
+    }
+
+    char key[8];
+    page_key(s_meta.head, key);
+    if (s_meta.count > 0 &&
+        (!storage_data_load_var(BACKLOG_NVS_NS, key, &s_head_pg, sizeof(s_head_pg), &len) ||
+         len != PAGE_HDR_LEN + s_head_pg.used)) {
+        // Página head ilegible: se pierde solo lo de esa página
+        s_errors++;
+        uint32_t lost = s_meta.nrec[s_meta.head] - (s_meta.tail == s_meta.head ? s_meta.tail_rec : 0);
+        s_meta.count -= lost;
+        if (s_meta.tail == s_meta.head) s_meta.tail_rec = 0;
+        head_reset();
+    } else if (s_meta.count == 0) {
+        head_reset();
+    }
+
+    ESP_LOGI(TAG, "Backlog: %lu registros pendientes (capacidad ~%d muestras)",
+             (unsigned long)s_meta.count, (int)BACKLOG_CAPACITY);
+
+    mqtt_app_set_done_callback(MQTT_PUB_BULK, on_bulk_done);
+
+    esp_sntp_setoperatingmode(SNTP_OPMODE_POLL);
+    esp_sntp_setservername(0, BACKLOG_SNTP_SERVER);
+    esp_sntp_init();
+}
+
+static bool push_record(uint8_t kind, const void *body, uint16_t len) {
+    backlog_hdr_t hdr = { .t = tlm_backlog_now(), .kind = kind, .len = len };
+
+    if (!s_lock || sizeof(hdr) + len > TLM_BACKLOG_PAGE_LEN) return false;
+    if (!hdr.t) {
+        hdr.t = (uint32_t)(esp_timer_get_time() / 1000000);
+        hdr.flags = BACKLOG_F_UPTIME;
+    }
+
+    xSemaphoreTake(s_lock, portMAX_DELAY);
+    if (s_meta.count == 0) {
+        // Todo reenviado: se vuelve a llenar la página head desde el principio
+        s_meta.tail = s_meta.head;
+        s_meta.tail_rec = 0;
+        s_next_seq = s_tail_seq;
+        head_reset();
+    } else if (s_head_pg.used + sizeof(hdr) + len > TLM_BACKLOG_PAGE_LEN ||
+               s_head_pg.boot != s_boot) {
+        head_advance();   // Página llena, o de otro arranque (el uptime no se compara)
+    }
+
+    memcpy(s_head_pg.data + s_head_pg.used, &hdr, sizeof(hdr));
+    memcpy(s_head_pg.data + s_head_pg.used + sizeof(hdr), body, len);
+    s_head_pg.used += sizeof(hdr) + len;
+
+    bool ok = head_save();
+    if (ok) {
+        s_meta.nrec[s_meta.head]++;
+        s_meta.count++;
+        s_meta.stored++;
+        meta_save();
+    } else {
+        s_head_pg.used -= sizeof(hdr) + len;
+        s_errors++;
+    }
+    xSemaphoreGive(s_lock);
+    return ok;
+}
+
+bool tlm_backlog_push_telemetry(const tlm_telemetry_t *t) {
+    float vals[TLM_KEY_COUNT];
+    int16_t q[TLM_KEY_COUNT];
+
+    tlm_telemetry_to_array(t, vals);
+    for (int k = 0; k < TLM_KEY_COUNT; k++) q[k] = tlm_pack_value(k, vals[k]);
+    return push_record(BACKLOG_KIND_TELEMETRY, q, sizeof(q));
+}
+
+bool tlm_backlog_push_window(const tlm_agg_t *agg, uint32_t period_s) {
+    backlog_window_t w = { .dt = period_s > UINT16_MAX ? UINT16_MAX : (uint16_t)period_s };
+    int n = 0;
+
+    for (int k = 0; k < TLM_KEY_COUNT; k++) {
+        const tlm_agg_field_t *f = &agg->f[k];
+        if (f->n == 0) continue;   // Sin muestras en la ventana: no ocupa lugar
+        w.mask |= 1u << k;
+        w.q[n][0] = tlm_pack_value(k, f->min);
+        w.q[n][1] = tlm_pack_value(k, f->max);
+        w.q[n][2] = tlm_pack_value(k, f->sum / f->n);
+        w.q[n][3] = tlm_pack_value(k, f->last);
+        n++;
+    }
+    return push_record(BACKLOG_KIND_WINDOW, &w, WINDOW_HDR_LEN + n * sizeof(w.q[0]));
+}
+
+// Ventana guardada → tlm_agg con una "muestra" por campo (suma = media)
+static bool window_unpack(const uint8_t *body, uint16_t len, tlm_agg_t *agg, uint32_t *dt) {
+    backlog_window_t w;
+    int n = 0;
+
+    if (len < WINDOW_HDR_LEN || len > sizeof(w)) return false;
+    memcpy(&w, body, len);
+    tlm_agg_reset(agg);
+    for (int k = 0; k < TLM_KEY_COUNT; k++) {
+        if (!(w.mask & (1u << k))) continue;
+        if (WINDOW_HDR_LEN + (n + 1) * sizeof(w.q[0]) > len) return false;
+        tlm_agg_field_t *f = &agg->f[k];
+        f->min = tlm_unpack_value(k, w.q[n][0]);
+        f->max = tlm_unpack_value(k, w.q[n][1]);
+        f->sum = tlm_unpack_value(k, w.q[n][2]);
+        f->last = tlm_unpack_value(k, w.q[n][3]);
+        f->n = 1;
+        n++;
+    }
+    *dt = w.dt;
+    return WINDOW_HDR_LEN + n * sizeof(w.q[0]) == len;
+}
+
+// Hora del registro: la guardada o, si fue en este mismo arranque antes de
+// sincronizar, la actual menos el tiempo transcurrido
+static uint32_t rec_time(const backlog_hdr_t *hdr, uint32_t boot) {
+    if (!(hdr->flags & BACKLOG_F_UPTIME)) return hdr->t;
+
+    uint32_t now = tlm_backlog_now();
+    uint32_t up = (uint32_t)(esp_timer_get_time() / 1000000);
+    if (now && boot == s_boot && up >= hdr->t) return now - (up - hdr->t);
+    return 0;
+}
+
+// JSON del registro (el mismo que en vivo) con "ts" al principio
+static size_t rec_to_json(const backlog_hdr_t *hdr, const uint8_t *body, uint32_t boot,
+                          const char **topic, char *msg, size_t len) {
+    static uint8_t json[MQTT_PUB_PAYLOAD_MAX];
+    size_t n = 0;
+
+    if (hdr->kind == BACKLOG_KIND_TELEMETRY && hdr->len == TLM_KEY_COUNT * sizeof(int16_t)) {
+        int16_t q[TLM_KEY_COUNT];
+        float vals[TLM_KEY_COUNT];
+        tlm_telemetry_t t;
+        memcpy(q, body, sizeof(q));
+        for (int k = 0; k < TLM_KEY_COUNT; k++) vals[k] = tlm_unpack_value(k, q[k]);
+        tlm_telemetry_from_array(vals, &t);
+        n = tlm_encode_telemetry(TLM_FMT_JSON, &t, json, sizeof(json));
+        *topic = MQTT_TOPIC_TELEMETRY "/historico";
+    } else if (hdr->kind == BACKLOG_KIND_WINDOW) {
+        static tlm_agg_t agg;
+        uint32_t dt;
+        if (window_unpack(body, hdr->len, &agg, &dt)) {
+            n = tlm_encode_window(TLM_FMT_JSON, &agg, dt, json, sizeof(json));
+            *topic = MQTT_TOPIC_TELEMETRY_WINDOW "/historico";
+        }
+    }
+    if (n < 2) return 0;
+
+    int m = snprintf(msg, len, "{\"ts\":%lu%s%s", (unsigned long)rec_time(hdr, boot),
+                     json[1] == '}' ? "" : ",", (const char *)json + 1);
+    return (m > 0 && (size_t)m < len) ? (size_t)m : 0;
+}
+
+int tlm_backlog_service(void) {
+    static char msg[MQTT_PUB_PAYLOAD_MAX];
+    int sent = 0;
+
+    int64_t now = esp_timer_get_time();
+    if (!s_lock || now - s_last_replay_us < (int64_t)BACKLOG_REPLAY_MS * 1000) return 0;
+    s_last_replay_us = now;
+
+    // Sin broker no se encola, pero los avisos que llegaron se guardan igual
+    bool connected = mqtt_app_is_connected();
+    xSemaphoreTake(s_lock, portMAX_DELAY);
+    while (connected && sent < BACKLOG_REPLAY_BATCH && s_inflight_n < BACKLOG_INFLIGHT_MAX &&
+           s_next_seq - s_tail_seq < s_meta.count) {
+        // Ubicar el registro s_next_seq desde el tail
+        uint32_t page = s_meta.tail;
+        uint32_t rec = s_meta.tail_rec + (s_next_seq - s_tail_seq);
+        while (rec >= s_meta.nrec[page] && page != s_meta.head) {
+            rec -= s_meta.nrec[page];
+            page = page_next(page);
+        }
+
+        backlog_hdr_t hdr;
+        const char *topic = NULL;
+        const backlog_page_t *pg = page_get(page);
+        size_t n = 0;
+        if (pg != NULL) n = rec_to_json(&hdr, page_record(pg, rec, &hdr), pg->boot, &topic, msg, sizeof(msg));
+        if (n == 0) {
+            // Página ilegible o registro desconocido: se descarta la página
+            // entera para no trabar el anillo
+            s_errors++;
+            page_discard(page);
+            continue;
+        }
+
+        // Clase de menor prioridad: si la cola está llena queda en flash
+        if (!mqtt_app_enqueue(MQTT_PUB_BULK, topic, msg, n, false)) break;
+        s_inflight[(s_inflight_head + s_inflight_n) % BACKLOG_INFLIGHT_MAX] = s_next_seq++;
+        s_inflight_n++;
+        sent++;
+    }
+    if (s_meta_dirty) meta_save();
+    xSemaphoreGive(s_lock);
+
+    if (s_meta.count == 0 && sent > 0) ESP_LOGI(TAG, "📤 Backlog reenviado completo");
+    return sent;
+}
+
+void tlm_backlog_get_stats(tlm_backlog_stats_t *out) {
+    if (s_lock) xSemaphoreTake(s_lock, portMAX_DELAY);
+    out->count = s_meta.count;
+    out->capacity = BACKLOG_CAPACITY;
+    out->stored = s_meta.stored;
+    out->replayed = s_meta.replayed;
+    out->dropped = s_meta.dropped;
+    out->errors = s_errors;
+    if (s_lock) xSemaphoreGive(s_lock);
+}
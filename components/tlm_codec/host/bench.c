@@ -0,0 +1,223 @@
+/*
+ * tlm_codec en el host:
+ *   - payloads de referencia byte a byte (orden de claves, escalas, decimales),
+ *   - sensor sin lectura (NaN) como null en JSON y 0xF6 en CBOR, nunca 0,
+ *   - forma compacta de 16 bits (backlog en flash) sin pérdida frente al CBOR,
+ *   - tamaño y tiempo de codificación JSON vs CBOR (telemetría, estado y
+ *     ventana agregada).
+ */
+#define _POSIX_C_SOURCE 199309L
+#include <math.h>
+#include <stdio.h>
+#include <string.h>
+#include <time.h>
+#include "tlm_agg.h"
+#include "tlm_codec.h"
+
+#define BENCH_REPS   20000
+#define BENCH_TRIALS 5
+
+static const tlm_telemetry_t SAMPLE = {
+    .v = 220.5f, .a = 3.25f, .w = 640.0f, .va = 715.0f, .var = -318.0f, .pf = 0.895f,
+    .hz = 50.02f, .thd = 12.3f, .h3 = 10.1f, .h5 = 5.2f, .h7 = 2.4f,
+    .amb = 24.56f, .out = 31.2f, .coil = 8.5f,
+};
+static const tlm_status_t STATUS = { .sys_on = true, .comp = true, .fan = 2, .mode = 1, .sp = 24.0f };
+
+static const char SAMPLE_JSON[] =
+    "{\"v\":220.5,\"a\":3.25,\"w\":640,\"va\":715,\"var\":-318,\"pf\":0.89,\"hz\":50.02,"
+    "\"thd\":12.3,\"h3\":10.1,\"h5\":5.2,\"h7\":2.4,\"amb\":24.56,\"out\":31.20,\"coil\":8.50}";
+static const char SAMPLE_CBOR[] =
+    "AE0019089D0119014502190280031902CB0439013D05185A0619138A07187B0818650918340A1818"
+    "0B1909980C190C300D190352";
+static const char STATUS_JSON[] = "{\"sys_on\":true,\"comp\":1,\"fan\":2,\"mode\":1,\"sp\":24.0}";
+static const char STATUS_CBOR[] = "A500F50101020203010418F0";
+static const char WINDOW_JSON[] = "{\"dt\":10,\"a\":[3.00,12.00,7.50,12.00],\"coil\":[6.25,6.25,6.25,6.25]}";
+static const char WINDOW_CBOR[] = "A3140A018419012C1904B01902EE1904B00D84190271190271190271190271";
+
+static uint64_t now_ns(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000ULL + (uint64_t)ts.tv_nsec;
+}
+
+static void to_hex(const uint8_t *data, size_t n, char *out) {
+    for (size_t k = 0; k < n; k++) sprintf(out + 2 * k, "%02X", data[k]);
+    out[2 * n] = '\0';
+}
+
+static bool check_payload(const char *what, const uint8_t *buf, size_t n, bool cbor, const char *want) {
+    char got[1024];
+
+    if (cbor) to_hex(buf, n, got);
+    else snprintf(got, sizeof(got), "%.*s", (int)n, (const char *)buf);
+
+    bool ok = n > 0 && strcmp(got, want) == 0;
+    printf("  %s %s (%zu B)\n", ok ? "✅" : "❌", what, n);
+    if (!ok) printf("     obtenido: %s\n     esperado: %s\n", got, want);
+    return ok;
+}
+
+static void window_sample(tlm_agg_t *agg) {
+    tlm_agg_reset(agg);
+    tlm_agg_add(agg, TLM_KEY_A, 3.0f);
+    tlm_agg_add(agg, TLM_KEY_A, 12.0f);
+    tlm_agg_add(agg, TLM_KEY_COIL, 6.25f);
+}
+
+static bool test_reference(void) {
+    uint8_t buf[512];
+    tlm_agg_t agg;
+    bool ok = true;
+
+    printf("📦 Payloads de referencia\n");
+    ok &= check_payload("telemetría JSON", buf, tlm_encode_telemetry(TLM_FMT_JSON, &SAMPLE, buf, sizeof(buf)),
+                        false, SAMPLE_JSON);
+    ok &= check_payload("telemetría CBOR", buf, tlm_encode_telemetry(TLM_FMT_CBOR, &SAMPLE, buf, sizeof(buf)),
+                        true, SAMPLE_CBOR);
+    ok &= check_payload("estado JSON", buf, tlm_encode_status(TLM_FMT_JSON, &STATUS, buf, sizeof(buf)),
+                        false, STATUS_JSON);
+    ok &= check_payload("estado CBOR", buf, tlm_encode_status(TLM_FMT_CBOR, &STATUS, buf, sizeof(buf)),
+                        true, STATUS_CBOR);
+    window_sample(&agg);
+    ok &= check_payload("ventana JSON", buf, tlm_encode_window(TLM_FMT_JSON, &agg, 10, buf, sizeof(buf)),
+                        false, WINDOW_JSON);
+    ok &= check_payload("ventana CBOR", buf, tlm_encode_window(TLM_FMT_CBOR, &agg, 10, buf, sizeof(buf)),
+                        true, WINDOW_CBOR);
+
+    // Buffer justo y uno menos: sin truncados
+    size_t n = strlen(SAMPLE_JSON);
+    bool exact = tlm_encode_telemetry(TLM_FMT_JSON, &SAMPLE, buf, n + 1) == n &&
+                 tlm_encode_telemetry(TLM_FMT_JSON, &SAMPLE, buf, n) == 0 &&
+                 tlm_encode_telemetry(TLM_FMT_CBOR, &SAMPLE, buf, strlen(SAMPLE_CBOR) / 2 - 1) == 0;
+    printf("  %s buffer corto devuelve 0\n", exact ? "✅" : "❌");
+    return ok && exact;
+}
+
+// Sensor sin lectura: null en los dos formatos (0 °C sería una lectura válida)
+static bool test_nan(void) {
+    uint8_t buf[512];
+    char json[512];
+    tlm_telemetry_t t = SAMPLE;
+    bool ok = true;
+
+    printf("🚫 Sensor sin lectura (NaN)\n");
+    t.out = NAN;
+    t.coil = INFINITY;
+
+    size_t n = tlm_encode_telemetry(TLM_FMT_JSON, &t, buf, sizeof(buf));
+    snprintf(json, sizeof(json), "%.*s", (int)n, (const char *)buf);
+    bool json_ok = n > 0 && strstr(json, "\"out\":null,\"coil\":null}") != NULL &&
+                   strstr(json, "nan") == NULL && strstr(json, "inf") == NULL;
+    printf("  %s JSON: %s\n", json_ok ? "✅" : "❌", json);
+    ok &= json_ok;
+
+    // Clave 12 (out) y 13 (coil) seguidas de null, al final del mapa
+    n = tlm_encode_telemetry(TLM_FMT_CBOR, &t, buf, sizeof(buf));
+    bool cbor_ok = n >= 4 && buf[n - 4] == TLM_KEY_OUT && buf[n - 3] == 0xF6 &&
+                   buf[n - 2] == TLM_KEY_COIL && buf[n - 1] == 0xF6;
+    printf("  %s CBOR: out y coil como 0xF6 (%zu B)\n", cbor_ok ? "✅" : "❌", n);
+    ok &= cbor_ok;
+
+    tlm_status_t s = STATUS;
+    s.sp = NAN;
+    n = tlm_encode_status(TLM_FMT_CBOR, &s, buf, sizeof(buf));
+    bool status_ok = n >= 2 && buf[n - 2] == TLM_KEY_SP && buf[n - 1] == 0xF6;
+    n = tlm_encode_status(TLM_FMT_JSON, &s, buf, sizeof(buf));
+    snprintf(json, sizeof(json), "%.*s", (int)n, (const char *)buf);
+    status_ok &= strstr(json, "\"sp\":null}") != NULL;
+    printf("  %s estado: sp null en JSON y CBOR\n", status_ok ? "✅" : "❌");
+    return ok && status_ok;
+}
+
+// Forma compacta: lo que vuelve de la flash se publica igual que el original
+static bool test_pack(void) {
+    uint8_t buf[512];
+    float vals[TLM_KEY_COUNT];
+    int16_t q[TLM_KEY_COUNT];
+    tlm_telemetry_t t;
+    bool ok = true;
+
+    printf("🗜️  Forma compacta (16 bits)\n");
+    tlm_telemetry_to_array(&SAMPLE, vals);
+    for (int k = 0; k < TLM_KEY_COUNT; k++) vals[k] = tlm_unpack_value(k, tlm_pack_value(k, vals[k]));
+    tlm_telemetry_from_array(vals, &t);
+    ok &= check_payload("ida y vuelta = CBOR original", buf,
+                        tlm_encode_telemetry(TLM_FMT_CBOR, &t, buf, sizeof(buf)), true, SAMPLE_CBOR);
+
+    for (int k = 0; k < TLM_KEY_COUNT; k++) q[k] = tlm_pack_value(k, NAN);
+    bool none_ok = isnan(tlm_unpack_value(TLM_KEY_COIL, q[TLM_KEY_COIL])) && q[TLM_KEY_V] == TLM_PACK_NONE;
+    printf("  %s NaN → TLM_PACK_NONE → NaN\n", none_ok ? "✅" : "❌");
+
+    bool sat_ok = tlm_pack_value(TLM_KEY_W, 1e6f) == INT16_MAX &&
+                  tlm_pack_value(TLM_KEY_W, -1e6f) == TLM_PACK_NONE + 1 &&
+                  tlm_pack_value(TLM_KEY_AMB, -12.34f) == -1234;
+    printf("  %s fuera de rango satura (sin caer en TLM_PACK_NONE)\n", sat_ok ? "✅" : "❌");
+    return ok && none_ok && sat_ok;
+}
+
+typedef size_t (*encode_fn)(tlm_format_t fmt, uint8_t *buf, size_t len);
+
+static size_t enc_telemetry(tlm_format_t fmt, uint8_t *buf, size_t len) {
+    return tlm_encode_telemetry(fmt, &SAMPLE, buf, len);
+}
+
+static size_t enc_status(tlm_format_t fmt, uint8_t *buf, size_t len) {
+    return tlm_encode_status(fmt, &STATUS, buf, len);
+}
+
+static tlm_agg_t s_window;
+
+static size_t enc_window(tlm_format_t fmt, uint8_t *buf, size_t len) {
+    return tlm_encode_window(fmt, &s_window, 10, buf, len);
+}
+
+// Mejor de BENCH_TRIALS intentos, en ns por payload
+static double bench_one(encode_fn fn, tlm_format_t fmt, size_t *bytes) {
+    uint8_t buf[512];
+    volatile size_t sink = 0;
+    double best = INFINITY;
+
+    for (int trial = 0; trial < BENCH_TRIALS; trial++) {
+        uint64_t t0 = now_ns();
+        for (int rep = 0; rep < BENCH_REPS; rep++) sink += fn(fmt, buf, sizeof(buf));
+        best = fmin(best, (double)(now_ns() - t0) / BENCH_REPS);
+    }
+    *bytes = fn(fmt, buf, sizeof(buf));
+    (void)sink;
+    return best;
+}
+
+static void bench(void) {
+    const char *names[] = { "telemetría", "estado", "ventana (2 campos)" };
+    const encode_fn fns[] = { enc_telemetry, enc_status, enc_window };
+
+    // Ventana completa: todos los campos con datos, como con el medidor andando
+    tlm_agg_reset(&s_window);
+    for (int k = 0; k < TLM_KEY_COUNT; k++) {
+        const float *f = &SAMPLE.v + k;
+        tlm_agg_add(&s_window, k, *f);
+        tlm_agg_add(&s_window, k, *f * 1.1f);
+    }
+    names[2] = "ventana (14 campos)";
+
+    printf("⏱️  JSON vs CBOR (host, mejor de %d × %d)\n", BENCH_TRIALS, BENCH_REPS);
+    for (size_t k = 0; k < sizeof(fns) / sizeof(fns[0]); k++) {
+        size_t bj, bc;
+        double tj = bench_one(fns[k], TLM_FMT_JSON, &bj);
+        double tc = bench_one(fns[k], TLM_FMT_CBOR, &bc);
+        printf("  %-20s JSON %3zu B %7.0f ns   CBOR %3zu B %5.0f ns   (%.0f %% del tamaño)\n",
+               names[k], bj, tj, bc, tc, 100.0 * bc / bj);
+    }
+}
+
+int main(void) {
+    bool ok = true;
+    ok &= test_reference();
+    ok &= test_nan();
+    ok &= test_pack();
+    bench();
+
+    printf("%s tlm_codec\n", ok ? "✅" : "❌");
+    return ok ? 0 : 1;
+}
@@ -0,0 +1,154 @@
+/*
+ * tlm_rbe en el host:
+ *   - banda absoluta vs relativa (gana la mayor),
+ *   - heartbeat: vence justo en hb_s y 0 lo desactiva,
+ *   - NaN ↔ valor cuenta como cambio, NaN → NaN no,
+ *   - tlm_rbe_reset fuerza la próxima,
+ *   - check no mueve la referencia: solo tlm_rbe_commit (envío aceptado),
+ *   - contadores de enviadas y suprimidas.
+ */
+#include <math.h>
+#include <stdio.h>
+#include <string.h>
+#include "tlm_rbe.h"
+
+#define SEC 1000000LL
+
+static const tlm_telemetry_t SAMPLE = {
+    .v = 220.0f, .a = 3.0f, .w = 1000.0f, .va = 1100.0f, .var = -300.0f, .pf = 0.9f,
+    .hz = 50.0f, .thd = 12.0f, .h3 = 10.0f, .h5 = 5.0f, .h7 = 2.0f,
+    .amb = 24.0f, .out = 31.0f, .coil = 8.0f,
+};
+
+static bool s_ok = true;
+
+static void expect(bool cond, const char *what) {
+    printf("  %s %s\n", cond ? "✅" : "❌", what);
+    s_ok &= cond;
+}
+
+// Base publicada en t=0 con SAMPLE
+static void start(tlm_rbe_t *r, tlm_rbe_config_t *cfg) {
+    memset(r, 0, sizeof(*r));
+    tlm_rbe_defaults(cfg);
+    tlm_rbe_check(r, cfg, &SAMPLE, 0);
+    tlm_rbe_commit(r, &SAMPLE, 0);
+}
+
+static bool moved(tlm_rbe_t *r, const tlm_rbe_config_t *cfg, const tlm_telemetry_t *t) {
+    return tlm_rbe_check(r, cfg, t, 1 * SEC);
+}
+
+static void test_bands(void) {
+    tlm_rbe_t r;
+    tlm_rbe_config_t cfg;
+    tlm_telemetry_t t;
+
+    printf("📏 Banda absoluta vs relativa\n");
+    start(&r, &cfg);
+
+    // w: abs 10, rel 2% de 1000 = 20 → manda la relativa
+    t = SAMPLE; t.w = 1015.0f;
+    expect(!moved(&r, &cfg, &t), "w +15 dentro del 2% (20 W) no sale");
+    t = SAMPLE; t.w = 1025.0f;
+    expect(moved(&r, &cfg, &t), "w +25 fuera del 2% sale");
+
+    // a: abs 0.05, rel 2% de 3 = 0.06 → relativa; con a chica manda la absoluta
+    t = SAMPLE; t.a = 3.055f;
+    expect(!moved(&r, &cfg, &t), "a +0.055 dentro del 2% (0.06 A) no sale");
+    cfg.rel[TLM_KEY_A] = 0.0f;
+    expect(moved(&r, &cfg, &t), "a +0.055 sin banda relativa sale (abs 0.05)");
+    cfg.rel[TLM_KEY_A] = 2.0f;
+
+    // Referencia en 0: la relativa da 0 y queda la absoluta
+    tlm_telemetry_t zero = SAMPLE;
+    zero.a = 0.0f;
+    tlm_rbe_commit(&r, &zero, 0);
+    t = zero; t.a = 0.04f;
+    expect(!moved(&r, &cfg, &t), "a 0 → 0.04 dentro de abs no sale");
+    t = zero; t.a = -0.06f;
+    expect(moved(&r, &cfg, &t), "a 0 → -0.06 fuera de abs sale (en los dos sentidos)");
+}
+
+static void test_heartbeat(void) {
+    tlm_rbe_t r;
+    tlm_rbe_config_t cfg;
+
+    printf("💓 Heartbeat\n");
+    start(&r, &cfg);
+    int64_t hb = (int64_t)cfg.heartbeat_s * SEC;
+    expect(!tlm_rbe_check(&r, &cfg, &SAMPLE, hb - 1), "sin cambios antes de hb_s no sale");
+    expect(tlm_rbe_check(&r, &cfg, &SAMPLE, hb), "sin cambios al cumplirse hb_s sale");
+
+    // El heartbeat cuenta desde la última publicada, no desde el último check
+    tlm_rbe_commit(&r, &SAMPLE, hb);
+    expect(!tlm_rbe_check(&r, &cfg, &SAMPLE, 2 * hb - 1), "se renueva con el commit");
+
+    cfg.heartbeat_s = 0;
+    expect(!tlm_rbe_check(&r, &cfg, &SAMPLE, 100 * hb), "hb_s 0 = sin heartbeat");
+}
+
+static void test_nan(void) {
+    tlm_rbe_t r;
+    tlm_rbe_config_t cfg;
+    tlm_telemetry_t t = SAMPLE;
+
+    printf("🚫 Sensor sin lectura (NaN)\n");
+    start(&r, &cfg);
+    t.coil = NAN;
+    expect(moved(&r, &cfg, &t), "valor → NaN sale");
+    tlm_rbe_commit(&r, &t, 0);
+    expect(!moved(&r, &cfg, &t), "NaN → NaN no sale");
+    t.coil = SAMPLE.coil;
+    expect(moved(&r, &cfg, &t), "NaN → valor sale");
+}
+
+static void test_reset_commit(void) {
+    tlm_rbe_t r;
+    tlm_rbe_config_t cfg;
+    tlm_telemetry_t t = SAMPLE;
+
+    printf("🔁 Reset y commit\n");
+    memset(&r, 0, sizeof(r));
+    tlm_rbe_defaults(&cfg);
+    expect(tlm_rbe_check(&r, &cfg, &SAMPLE, 0), "la primera muestra sale");
+    expect(tlm_rbe_check(&r, &cfg, &SAMPLE, 0), "sin commit la referencia no cambia (reintento)");
+    tlm_rbe_commit(&r, &SAMPLE, 0);
+    expect(!tlm_rbe_check(&r, &cfg, &SAMPLE, 0), "tras el commit la misma no sale");
+
+    t.w = 1500.0f;
+    expect(moved(&r, &cfg, &t), "cambio grande sale");
+    expect(moved(&r, &cfg, &t), "publicación fallida (sin commit): vuelve a salir");
+
+    tlm_rbe_reset(&r);
+    expect(tlm_rbe_check(&r, &cfg, &SAMPLE, 0), "tras reset sale aunque no cambie nada");
+}
+
+static void test_counters(void) {
+    tlm_rbe_t r;
+    tlm_rbe_config_t cfg;
+    tlm_telemetry_t t = SAMPLE;
+
+    printf("🔢 Contadores\n");
+    start(&r, &cfg);                                   // 1 enviada
+    for (int k = 0; k < 5; k++) moved(&r, &cfg, &SAMPLE);  // 5 suprimidas
+    t.w = 1500.0f;
+    if (moved(&r, &cfg, &t)) tlm_rbe_commit(&r, &t, 1 * SEC);  // 2 enviadas
+    moved(&r, &cfg, &SAMPLE);                          // Salió pero no se aceptó: ni una ni otra
+    tlm_rbe_reset(&r);
+    char what[64];
+    snprintf(what, sizeof(what), "enviadas %lu (2), suprimidas %lu (5)",
+             (unsigned long)r.sent, (unsigned long)r.suppressed);
+    expect(r.sent == 2 && r.suppressed == 5, what);
+}
+
+int main(void) {
+    test_bands();
+    test_heartbeat();
+    test_nan();
+    test_reset_commit();
+    test_counters();
+
+    printf("%s tlm_rbe\n", s_ok ? "✅" : "❌");
+    return s_ok ? 0 : 1;
+}
@@ -0,0 +1,43 @@
+#pragma once
+#include <stdint.h>
+#include "tlm_codec.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/*
+ * Agregador de telemetría por ventana: cada campo (clave TLM_KEY_*) lleva su
+ * propio mínimo, máximo, suma y último valor. Cada fuente aporta a su ritmo
+ * (el medidor cada 200 ms, los sensores cuando terminan una conversión), así
+ * los extremos cortos (picos de corriente, mínimo de la cañería) no se pierden
+ * aunque se publique una sola vez por ventana. Sin locks: lo protege quien
+ * lo comparte.
+ */
+
+typedef struct {
+    float min;
+    float max;
+    float sum;
+    float last;
+    uint32_t n;      // Muestras en la ventana (0 = campo sin datos)
+} tlm_agg_field_t;
+
+typedef struct tlm_agg {
+    tlm_agg_field_t f[TLM_KEY_COUNT];
+} tlm_agg_t;
+
+/**
+ * @brief Vacía la ventana.
+ */
+void tlm_agg_reset(tlm_agg_t *agg);
+
+/**
+ * @brief Suma una muestra de un campo. Ignora NaN (sensor sin lectura).
+ * @param key Clave TLM_KEY_* del campo
+ */
+void tlm_agg_add(tlm_agg_t *agg, int key, float value);
+
+#ifdef __cplusplus
+}
+#endif
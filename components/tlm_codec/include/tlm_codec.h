@@ -0,0 +1,148 @@
+#pragma once
+#include <stdint.h>
+#include <stdbool.h>
+#include <stddef.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/*
+ * Codificación de los payloads de telemetría y estado (sin dependencias de
+ * ESP-IDF: compila igual en el host).
+ *
+ * JSON: el formato de siempre, texto con decimales.
+ * CBOR: un mapa con claves enteras fijas (1 byte cada una) y valores enteros
+ *       escalados (ej. 24.56°C → 2456 con escala x100). Sin formateo de
+ *       floats; un payload típico ocupa menos de la mitad que el JSON.
+ *       El primer byte distingue los formatos: '{' (0x7B) es JSON, 0xA0-0xB7
+ *       es un mapa CBOR.
+ *
+ * Un valor NaN/inf (sensor sin lectura) sale como null en los dos formatos
+ * (0xF6 en CBOR), nunca como 0. Pruebas y benchmark en host/.
+ */
+
+typedef enum {
+    TLM_FMT_JSON = 0,
+    TLM_FMT_CBOR = 1,
+} tlm_format_t;
+
+// Claves CBOR de la telemetría (no reordenar: las decodifica Node-RED)
+enum {
+    TLM_KEY_V = 0,     // V x10
+    TLM_KEY_A,         // A x100
+    TLM_KEY_W,         // W x1
+    TLM_KEY_VA,        // VA x1
+    TLM_KEY_VAR,       // VAR x1
+    TLM_KEY_PF,        // x100
+    TLM_KEY_HZ,        // Hz x100
+    TLM_KEY_THD,       // % x10
+    TLM_KEY_H3,        // % x10
+    TLM_KEY_H5,        // % x10
+    TLM_KEY_H7,        // % x10
+    TLM_KEY_AMB,       // °C x100
+    TLM_KEY_OUT,       // °C x100
+    TLM_KEY_COIL,      // °C x100
+    TLM_KEY_COUNT
+};
+
+// Clave CBOR de la duración de una ventana agregada (s), fuera del rango de campos
+#define TLM_KEY_WINDOW_DT 20
+
+// Claves CBOR del estado
+enum {
+    TLM_KEY_SYS_ON = 0, // bool
+    TLM_KEY_COMP,       // 0/1
+    TLM_KEY_FAN,        // 0-3
+    TLM_KEY_MODE,       // MODE_*
+    TLM_KEY_SP,         // °C x10
+    TLM_KEY_STATUS_COUNT
+};
+
+// Muestra de telemetría (solo mediciones)
+typedef struct {
+    float v, a, w, va, var, pf, hz;
+    float thd, h3, h5, h7;
+    float amb, out, coil;
+} tlm_telemetry_t;
+
+// Configuración actual del equipo
+typedef struct {
+    bool sys_on;
+    bool comp;
+    int fan;
+    int mode;
+    float sp;
+} tlm_status_t;
+
+/**
+ * @brief Pasa la muestra a un arreglo indexado por clave TLM_KEY_*.
+ */
+void tlm_telemetry_to_array(const tlm_telemetry_t *t, float vals[TLM_KEY_COUNT]);
+
+/**
+ * @brief Arma la muestra desde un arreglo indexado por clave TLM_KEY_*.
+ */
+void tlm_telemetry_from_array(const float vals[TLM_KEY_COUNT], tlm_telemetry_t *t);
+
+/*
+ * Forma compacta para guardar en flash: cada campo como entero de 16 bits con
+ * la escala CBOR (sin pérdida respecto de lo publicado; fuera de rango se
+ * satura). Sin lectura (NaN/inf) = TLM_PACK_NONE.
+ */
+#define TLM_PACK_NONE INT16_MIN
+
+/**
+ * @brief Escala y redondea un valor del campo key (TLM_KEY_*).
+ */
+int16_t tlm_pack_value(int key, float v);
+
+/**
+ * @brief Inversa de tlm_pack_value(); TLM_PACK_NONE vuelve como NaN.
+ */
+float tlm_unpack_value(int key, int16_t q);
+
+/**
+ * @brief Clave TLM_KEY_* de un campo por su nombre JSON ("amb", "a", ...).
+ * @return La clave, -1 si el nombre no existe
+ */
+int tlm_field_key(const char *name);
+
+/**
+ * @brief Codifica la telemetría en el formato pedido.
+ * @param buf Destino; en JSON queda terminado en '\0'
+ * @return Bytes del payload (sin el '\0'), 0 si no entra en buf
+ */
+size_t tlm_encode_telemetry(tlm_format_t fmt, const tlm_telemetry_t *t, uint8_t *buf, size_t len);
+
+struct tlm_agg;
+
+/**
+ * @brief Codifica una ventana agregada (tlm_agg): por campo [min, max, media,
+ *        último], con los mismos nombres/claves y escalas que la muestra
+ *        suelta. Los campos sin muestras en la ventana se omiten.
+ * @param period_s Duración real de la ventana (campo "dt")
+ * @return Bytes del payload (sin el '\0'), 0 si no entra en buf
+ */
+size_t tlm_encode_window(tlm_format_t fmt, const struct tlm_agg *agg, uint32_t period_s,
+                         uint8_t *buf, size_t len);
+
+/**
+ * @brief Codifica el estado en el formato pedido (igual que la telemetría).
+ */
+size_t tlm_encode_status(tlm_format_t fmt, const tlm_status_t *s, uint8_t *buf, size_t len);
+
+/**
+ * @brief Nombre del formato ("json" / "cbor").
+ */
+const char *tlm_format_name(tlm_format_t fmt);
+
+/**
+ * @brief Interpreta "json" o "cbor" (config por MQTT).
+ * @return true si el nombre es válido
+ */
+bool tlm_format_parse(const char *name, tlm_format_t *out);
+
+#ifdef __cplusplus
+}
+#endif
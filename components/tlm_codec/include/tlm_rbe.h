@@ -0,0 +1,66 @@
+#pragma once
+#include <stdint.h>
+#include <stdbool.h>
+#include "tlm_codec.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/*
+ * Report-by-exception de la telemetría: una muestra se publica solo si algún
+ * campo se movió más allá de su banda muerta respecto de lo último publicado,
+ * o si pasó el máximo de silencio (heartbeat). Sin locks ni ESP-IDF.
+ *
+ * Banda de un campo = max(abs, rel% · |último publicado|): abs es el piso de
+ * ruido del sensor y rel escala con el valor (ej. potencia).
+ */
+
+typedef struct {
+    float abs[TLM_KEY_COUNT];   // Banda absoluta (unidades del campo)
+    float rel[TLM_KEY_COUNT];   // Banda relativa (% del último publicado)
+    uint32_t heartbeat_s;       // Máximo silencio; 0 = sin heartbeat
+} tlm_rbe_config_t;
+
+typedef struct {
+    bool has_last;              // false = la próxima muestra sale sí o sí
+    float last[TLM_KEY_COUNT];  // Último valor publicado por campo
+    int64_t last_us;
+    uint32_t sent;
+    uint32_t suppressed;
+} tlm_rbe_t;
+
+/**
+ * @brief Bandas por defecto (algo más que el ruido de cada medición).
+ */
+void tlm_rbe_defaults(tlm_rbe_config_t *cfg);
+
+/**
+ * @brief Olvida lo último publicado: la próxima muestra sale (ej. al
+ *        reconectar, para dejar una base nueva en el broker).
+ */
+void tlm_rbe_reset(tlm_rbe_t *r);
+
+/**
+ * @brief Decide si la muestra se publica. No toca la referencia: si hay que
+ *        publicarla, llamar a tlm_rbe_commit() recién cuando el envío se
+ *        aceptó; si no, cuenta una suprimida.
+ * @return true si hay que publicarla
+ */
+bool tlm_rbe_check(tlm_rbe_t *r, const tlm_rbe_config_t *cfg,
+                   const tlm_telemetry_t *t, int64_t now_us);
+
+/**
+ * @brief La muestra se publicó: queda como la nueva referencia y cuenta
+ *        una enviada. Si el envío falló no se llama y la próxima se reintenta.
+ */
+void tlm_rbe_commit(tlm_rbe_t *r, const tlm_telemetry_t *t, int64_t now_us);
+
+/**
+ * @brief Compara dos estados campo por campo.
+ */
+bool tlm_status_equal(const tlm_status_t *a, const tlm_status_t *b);
+
+#ifdef __cplusplus
+}
+#endif
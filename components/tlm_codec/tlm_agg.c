@@ -0,0 +1,18 @@
+#include <string.h>
+#include <math.h>
+#include "tlm_agg.h"
+
+void tlm_agg_reset(tlm_agg_t *agg) {
+    memset(agg, 0, sizeof(*agg));
+}
+
+void tlm_agg_add(tlm_agg_t *agg, int key, float value) {
+    if (key < 0 || key >= TLM_KEY_COUNT || isnan(value)) return;
+
+    tlm_agg_field_t *f = &agg->f[key];
+    if (f->n == 0 || value < f->min) f->min = value;
+    if (f->n == 0 || value > f->max) f->max = value;
+    f->sum += value;
+    f->last = value;
+    f->n++;
+}
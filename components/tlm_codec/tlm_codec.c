@@ -0,0 +1,292 @@
+#include <stdarg.h>
+#include <stdio.h>
+#include <string.h>
+#include <math.h>
+#include "tlm_codec.h"
+#include "tlm_agg.h"
+
+// Tipos mayores de CBOR (RFC 8949) usados acá
+#define CBOR_UINT   0x00
+#define CBOR_NEGINT 0x20
+#define CBOR_ARRAY  0x80
+#define CBOR_MAP    0xA0
+#define CBOR_FALSE  0xF4
+#define CBOR_TRUE   0xF5
+#define CBOR_NULL   0xF6
+
+// Escritor secuencial: si se queda sin lugar marca el error y no escribe más
+typedef struct {
+    uint8_t *buf;
+    size_t len;
+    size_t pos;
+    bool overflow;
+} cbor_writer_t;
+
+static void cbor_put(cbor_writer_t *w, const uint8_t *data, size_t n) {
+    if (w->overflow || w->pos + n > w->len) {
+        w->overflow = true;
+        return;
+    }
+    memcpy(w->buf + w->pos, data, n);
+    w->pos += n;
+}
+
+// Cabecera con el argumento en la forma más corta (0-23 va en el mismo byte)
+static void cbor_head(cbor_writer_t *w, uint8_t major, uint32_t arg) {
+    uint8_t b[5];
+    size_t n;
+
+    if (arg < 24) {
+        b[0] = major | (uint8_t)arg;
+        n = 1;
+    } else if (arg <= 0xFF) {
+        b[0] = major | 24;
+        b[1] = (uint8_t)arg;
+        n = 2;
+    } else if (arg <= 0xFFFF) {
+        b[0] = major | 25;
+        b[1] = (uint8_t)(arg >> 8);
+        b[2] = (uint8_t)arg;
+        n = 3;
+    } else {
+        b[0] = major | 26;
+        b[1] = (uint8_t)(arg >> 24);
+        b[2] = (uint8_t)(arg >> 16);
+        b[3] = (uint8_t)(arg >> 8);
+        b[4] = (uint8_t)arg;
+        n = 5;
+    }
+    cbor_put(w, b, n);
+}
+
+static void cbor_int(cbor_writer_t *w, int32_t v) {
+    if (v >= 0) cbor_head(w, CBOR_UINT, (uint32_t)v);
+    else cbor_head(w, CBOR_NEGINT, (uint32_t)(-1 - v));   // -1 - n, sin desborde
+}
+
+// Valor escalado y redondeado (finito; los extremos se saturan)
+static int32_t scaled_int(float v, float scale) {
+    float x = roundf(v * scale);
+
+    if (x >= 2147483520.0f) return INT32_MAX;
+    if (x <= -2147483648.0f) return INT32_MIN;
+    return (int32_t)x;
+}
+
+// Un valor escalado; NaN/inf (sensor sin lectura) va como null, no como 0
+static void cbor_num(cbor_writer_t *w, float v, float scale) {
+    static const uint8_t null = CBOR_NULL;
+
+    if (!isfinite(v)) cbor_put(w, &null, 1);
+    else cbor_int(w, scaled_int(v, scale));
+}
+
+static void cbor_scaled(cbor_writer_t *w, uint8_t key, float v, float scale) {
+    cbor_head(w, CBOR_UINT, key);
+    cbor_num(w, v, scale);
+}
+
+// Escritor JSON equivalente: si se queda sin lugar marca el error
+typedef struct {
+    char *buf;
+    size_t len;
+    size_t pos;
+    bool overflow;
+} json_writer_t;
+
+static void json_printf(json_writer_t *w, const char *fmt, ...) {
+    va_list ap;
+
+    if (w->overflow) return;
+    va_start(ap, fmt);
+    int n = vsnprintf(w->buf + w->pos, w->len - w->pos, fmt, ap);
+    va_end(ap);
+    if (n < 0 || (size_t)n >= w->len - w->pos) w->overflow = true;
+    else w->pos += (size_t)n;
+}
+
+// Separador y número; printf daría "nan", que no es JSON: sin lectura va null
+static void json_num(json_writer_t *w, char sep, float v, int decimals) {
+    if (!isfinite(v)) json_printf(w, "%cnull", sep);
+    else json_printf(w, "%c%.*f", sep, decimals, (double)v);
+}
+
+// Campo "nombre":valor en una sola llamada (el camino de cada muestra)
+static void json_field(json_writer_t *w, char sep, const char *name, float v, int decimals) {
+    if (!isfinite(v)) json_printf(w, "%c\"%s\":null", sep, name);
+    else json_printf(w, "%c\"%s\":%.*f", sep, name, decimals, (double)v);
+}
+
+// Campos de telemetría: nombre JSON, escala CBOR y decimales JSON (por clave)
+typedef struct {
+    const char *name;
+    float scale;
+    int decimals;
+} tlm_field_t;
+
+static const tlm_field_t TLM_FIELDS[TLM_KEY_COUNT] = {
+    [TLM_KEY_V]    = { "v",    10.0f,  1 },
+    [TLM_KEY_A]    = { "a",    100.0f, 2 },
+    [TLM_KEY_W]    = { "w",    1.0f,   0 },
+    [TLM_KEY_VA]   = { "va",   1.0f,   0 },
+    [TLM_KEY_VAR]  = { "var",  1.0f,   0 },
+    [TLM_KEY_PF]   = { "pf",   100.0f, 2 },
+    [TLM_KEY_HZ]   = { "hz",   100.0f, 2 },
+    [TLM_KEY_THD]  = { "thd",  10.0f,  1 },
+    [TLM_KEY_H3]   = { "h3",   10.0f,  1 },
+    [TLM_KEY_H5]   = { "h5",   10.0f,  1 },
+    [TLM_KEY_H7]   = { "h7",   10.0f,  1 },
+    [TLM_KEY_AMB]  = { "amb",  100.0f, 2 },
+    [TLM_KEY_OUT]  = { "out",  100.0f, 2 },
+    [TLM_KEY_COIL] = { "coil", 100.0f, 2 },
+};
+
+static size_t cbor_finish(const cbor_writer_t *w) {
+    return w->overflow ? 0 : w->pos;
+}
+
+static size_t json_finish(const json_writer_t *w) {
+    return (w->overflow || w->len == 0) ? 0 : w->pos;
+}
+
+void tlm_telemetry_to_array(const tlm_telemetry_t *t, float vals[TLM_KEY_COUNT]) {
+    const float v[TLM_KEY_COUNT] = {
+        t->v, t->a, t->w, t->va, t->var, t->pf, t->hz,
+        t->thd, t->h3, t->h5, t->h7, t->amb, t->out, t->coil,
+    };
+    memcpy(vals, v, sizeof(v));
+}
+
+void tlm_telemetry_from_array(const float vals[TLM_KEY_COUNT], tlm_telemetry_t *t) {
+    t->v = vals[TLM_KEY_V];     t->a = vals[TLM_KEY_A];     t->w = vals[TLM_KEY_W];
+    t->va = vals[TLM_KEY_VA];   t->var = vals[TLM_KEY_VAR]; t->pf = vals[TLM_KEY_PF];
+    t->hz = vals[TLM_KEY_HZ];   t->thd = vals[TLM_KEY_THD]; t->h3 = vals[TLM_KEY_H3];
+    t->h5 = vals[TLM_KEY_H5];   t->h7 = vals[TLM_KEY_H7];   t->amb = vals[TLM_KEY_AMB];
+    t->out = vals[TLM_KEY_OUT]; t->coil = vals[TLM_KEY_COIL];
+}
+
+int16_t tlm_pack_value(int key, float v) {
+    if (!isfinite(v)) return TLM_PACK_NONE;
+    int32_t q = scaled_int(v, TLM_FIELDS[key].scale);
+    if (q > INT16_MAX) return INT16_MAX;
+    if (q <= TLM_PACK_NONE) return TLM_PACK_NONE + 1;   // El mínimo queda para "sin lectura"
+    return (int16_t)q;
+}
+
+float tlm_unpack_value(int key, int16_t q) {
+    return (q == TLM_PACK_NONE) ? NAN : q / TLM_FIELDS[key].scale;
+}
+
+int tlm_field_key(const char *name) {
+    for (int k = 0; k < TLM_KEY_COUNT; k++) {
+        if (strcmp(TLM_FIELDS[k].name, name) == 0) return k;
+    }
+    return -1;
+}
+
+size_t tlm_encode_telemetry(tlm_format_t fmt, const tlm_telemetry_t *t, uint8_t *buf, size_t len) {
+    float vals[TLM_KEY_COUNT];
+    tlm_telemetry_to_array(t, vals);
+
+    if (fmt == TLM_FMT_JSON) {
+        // Mismo orden que las claves CBOR (v, a, w, ..., coil)
+        json_writer_t w = { .buf = (char *)buf, .len = len, .overflow = len == 0 };
+        for (int k = 0; k < TLM_KEY_COUNT; k++) {
+            json_field(&w, k ? ',' : '{', TLM_FIELDS[k].name, vals[k], TLM_FIELDS[k].decimals);
+        }
+        json_printf(&w, "}");
+        return json_finish(&w);
+    }
+
+    cbor_writer_t w = { .buf = buf, .len = len };
+    cbor_head(&w, CBOR_MAP, TLM_KEY_COUNT);
+    for (int k = 0; k < TLM_KEY_COUNT; k++) {
+        cbor_scaled(&w, (uint8_t)k, vals[k], TLM_FIELDS[k].scale);
+    }
+    return cbor_finish(&w);
+}
+
+size_t tlm_encode_window(tlm_format_t fmt, const tlm_agg_t *agg, uint32_t period_s,
+                         uint8_t *buf, size_t len) {
+    if (fmt == TLM_FMT_JSON) {
+        json_writer_t w = { .buf = (char *)buf, .len = len, .overflow = len == 0 };
+        json_printf(&w, "{\"dt\":%lu", (unsigned long)period_s);
+        for (int k = 0; k < TLM_KEY_COUNT; k++) {
+            const tlm_agg_field_t *f = &agg->f[k];
+            int d = TLM_FIELDS[k].decimals;
+            if (f->n == 0) continue;   // Sin muestras en la ventana (ej. sensor lento)
+            float mean = f->sum / f->n;
+            if (isfinite(f->min) && isfinite(f->max) && isfinite(mean) && isfinite(f->last)) {
+                json_printf(&w, ",\"%s\":[%.*f,%.*f,%.*f,%.*f]", TLM_FIELDS[k].name,
+                            d, (double)f->min, d, (double)f->max, d, (double)mean, d, (double)f->last);
+                continue;
+            }
+            // tlm_agg descarta NaN, pero la suma puede desbordar
+            json_printf(&w, ",\"%s\":", TLM_FIELDS[k].name);
+            json_num(&w, '[', f->min, d);
+            json_num(&w, ',', f->max, d);
+            json_num(&w, ',', mean, d);
+            json_num(&w, ',', f->last, d);
+            json_printf(&w, "]");
+        }
+        json_printf(&w, "}");
+        return json_finish(&w);
+    }
+
+    uint32_t fields = 0;
+    for (int k = 0; k < TLM_KEY_COUNT; k++) if (agg->f[k].n) fields++;
+
+    cbor_writer_t w = { .buf = buf, .len = len };
+    cbor_head(&w, CBOR_MAP, fields + 1);
+    cbor_head(&w, CBOR_UINT, TLM_KEY_WINDOW_DT);
+    cbor_head(&w, CBOR_UINT, period_s);
+    for (int k = 0; k < TLM_KEY_COUNT; k++) {
+        const tlm_agg_field_t *f = &agg->f[k];
+        float scale = TLM_FIELDS[k].scale;
+        if (f->n == 0) continue;
+        cbor_head(&w, CBOR_UINT, (uint8_t)k);
+        cbor_head(&w, CBOR_ARRAY, 4);
+        // Mismo escalado que la muestra suelta; la clave ya va en el mapa
+        cbor_num(&w, f->min, scale);
+        cbor_num(&w, f->max, scale);
+        cbor_num(&w, f->sum / f->n, scale);
+        cbor_num(&w, f->last, scale);
+    }
+    return cbor_finish(&w);
+}
+
+size_t tlm_encode_status(tlm_format_t fmt, const tlm_status_t *s, uint8_t *buf, size_t len) {
+    if (fmt == TLM_FMT_JSON) {
+        json_writer_t w = { .buf = (char *)buf, .len = len, .overflow = len == 0 };
+        json_printf(&w, "{\"sys_on\":%s,\"comp\":%d,\"fan\":%d,\"mode\":%d",
+                    s->sys_on ? "true" : "false", s->comp ? 1 : 0, s->fan, s->mode);
+        json_field(&w, ',', "sp", s->sp, 1);
+        json_printf(&w, "}");
+        return json_finish(&w);
+    }
+
+    static const uint8_t cbor_bool[2] = { CBOR_FALSE, CBOR_TRUE };
+    cbor_writer_t w = { .buf = buf, .len = len };
+    cbor_head(&w, CBOR_MAP, TLM_KEY_STATUS_COUNT);
+    cbor_head(&w, CBOR_UINT, TLM_KEY_SYS_ON);
+    cbor_put(&w, &cbor_bool[s->sys_on ? 1 : 0], 1);
+    cbor_head(&w, CBOR_UINT, TLM_KEY_COMP);
+    cbor_int(&w, s->comp ? 1 : 0);
+    cbor_head(&w, CBOR_UINT, TLM_KEY_FAN);
+    cbor_int(&w, s->fan);
+    cbor_head(&w, CBOR_UINT, TLM_KEY_MODE);
+    cbor_int(&w, s->mode);
+    cbor_scaled(&w, TLM_KEY_SP, s->sp, 10.0f);
+    return cbor_finish(&w);
+}
+
+const char *tlm_format_name(tlm_format_t fmt) {
+    return (fmt == TLM_FMT_CBOR) ? "cbor" : "json";
+}
+
+bool tlm_format_parse(const char *name, tlm_format_t *out) {
+    if (strcmp(name, "json") == 0) *out = TLM_FMT_JSON;
+    else if (strcmp(name, "cbor") == 0) *out = TLM_FMT_CBOR;
+    else return false;
+    return true;
+}
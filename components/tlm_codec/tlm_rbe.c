@@ -0,0 +1,69 @@
+#include <math.h>
+#include "tlm_rbe.h"
+
+// Bandas por defecto: { abs, rel % }
+static const float RBE_DEFAULTS[TLM_KEY_COUNT][2] = {
+    [TLM_KEY_V]    = { 2.0f,  0.0f },
+    [TLM_KEY_A]    = { 0.05f, 2.0f },
+    [TLM_KEY_W]    = { 10.0f, 2.0f },
+    [TLM_KEY_VA]   = { 10.0f, 2.0f },
+    [TLM_KEY_VAR]  = { 10.0f, 2.0f },
+    [TLM_KEY_PF]   = { 0.02f, 0.0f },
+    [TLM_KEY_HZ]   = { 0.05f, 0.0f },
+    [TLM_KEY_THD]  = { 1.0f,  0.0f },
+    [TLM_KEY_H3]   = { 1.0f,  0.0f },
+    [TLM_KEY_H5]   = { 1.0f,  0.0f },
+    [TLM_KEY_H7]   = { 1.0f,  0.0f },
+    [TLM_KEY_AMB]  = { 0.2f,  0.0f },   // 12 bits: 0.0625°C por paso
+    [TLM_KEY_OUT]  = { 0.3f,  0.0f },
+    [TLM_KEY_COIL] = { 0.3f,  0.0f },   // 10 bits: 0.25°C por paso
+};
+
+#define RBE_HEARTBEAT_S 60
+
+void tlm_rbe_defaults(tlm_rbe_config_t *cfg) {
+    for (int k = 0; k < TLM_KEY_COUNT; k++) {
+        cfg->abs[k] = RBE_DEFAULTS[k][0];
+        cfg->rel[k] = RBE_DEFAULTS[k][1];
+    }
+    cfg->heartbeat_s = RBE_HEARTBEAT_S;
+}
+
+void tlm_rbe_reset(tlm_rbe_t *r) {
+    r->has_last = false;
+}
+
+bool tlm_status_equal(const tlm_status_t *a, const tlm_status_t *b) {
+    return a->sys_on == b->sys_on && a->comp == b->comp && a->fan == b->fan &&
+           a->mode == b->mode && a->sp == b->sp;
+}
+
+static bool field_moved(float last, float now, float abs_db, float rel_db) {
+    if (isnan(last) || isnan(now)) return isnan(last) != isnan(now);
+    float band = fabsf(last) * rel_db / 100.0f;
+    if (abs_db > band) band = abs_db;
+    return fabsf(now - last) > band;
+}
+
+bool tlm_rbe_check(tlm_rbe_t *r, const tlm_rbe_config_t *cfg,
+                   const tlm_telemetry_t *t, int64_t now_us) {
+    float vals[TLM_KEY_COUNT];
+    bool publish = !r->has_last;
+
+    tlm_telemetry_to_array(t, vals);
+    if (!publish && cfg->heartbeat_s &&
+        now_us - r->last_us >= (int64_t)cfg->heartbeat_s * 1000000) publish = true;
+    for (int k = 0; k < TLM_KEY_COUNT && !publish; k++) {
+        publish = field_moved(r->last[k], vals[k], cfg->abs[k], cfg->rel[k]);
+    }
+
+    if (!publish) r->suppressed++;
+    return publish;
+}
+
+void tlm_rbe_commit(tlm_rbe_t *r, const tlm_telemetry_t *t, int64_t now_us) {
+    tlm_telemetry_to_array(t, r->last);
+    r->last_us = now_us;
+    r->has_last = true;
+    r->sent++;
+}
@@ -1,5 +1,6 @@
 #include <stdio.h>
 #include <string.h>
+#include <math.h>
 #include "freertos/FreeRTOS.h"
 #include "freertos/task.h"
 #include "freertos/semphr.h" // 👈 Mutex para seguridad
@@ -7,7 +8,6 @@
 #include "esp_timer.h"
 #include "esp_task_wdt.h" 
 #include "driver/gpio.h"
-#include "driver/i2c.h"
 
 // Librerías
 #include "esp_wifi.h"       
@@ -20,33 +20,62 @@
 #include "ac_config.h"      
 #include "ac_meter.h" 
 #include "ac_storage.h"      // 👈 Para guardar config (Persistence)      
+#include "ac_energy.h"       // 👈 Energía acumulada (kWh)
 #include "ds18b20.h"        
+#include "ac_sensors.h"       // 👈 Tabla rol→ROM de sensores (NVS + SEARCH ROM)
 #include "i2c_lcd.h"
 #include "mqtt_connector.h"
+#include "tlm_backlog.h"     // 👈 Telemetría en flash mientras no hay broker
+#include "tlm_codec.h"       // 👈 Payloads en JSON o CBOR
+#include "tlm_agg.h"         // 👈 Telemetría agregada por ventana
+#include "tlm_rbe.h"         // 👈 Publicación por excepción (bandas muertas)
 #include "power_control.h"   // 👈 Control de botón y LEDs 
 
 static const char *TAG = "MAIN_SYSTEM";
 
 // --- PINES ---
-#define PIN_ONEWIRE GPIO_NUM_4  
 #define PIN_ZMPT    GPIO_NUM_34 
 #define PIN_SCT     GPIO_NUM_35 
 #define PIR_LCD_TIMEOUT_MS 20000
-#define LCD_FORCE_REINIT_MS 60000
-#define LCD_BUS_RECOVERY_BASE_MS 2000
-#define LCD_BUS_RECOVERY_MAX_MS 60000
-
-// IDs Sensores (Hardcodeados)
-const ds18b20_addr_t ID_COIL = { {0x28, 0xF4, 0xD6, 0x57, 0x04, 0xE1, 0x3C, 0x1E} };
-const ds18b20_addr_t ID_AMB  = { {0x28, 0xB5, 0x6C, 0x54, 0x00, 0x00, 0x00, 0x14} };
-const ds18b20_addr_t ID_OUT  = { {0x28, 0xB9, 0x31, 0x55, 0x00, 0x00, 0x00, 0x9F} };
+#define ENERGY_PUBLISH_MS 60000
+#define BACKLOG_STORE_MS 10000    // Sin broker: una muestra de telemetría a flash cada 10 s
+#define CLIMATE_REPORT_MS 1000    // Telemetría, estado y log del sistema (como el lazo original)
+#define CLIMATE_MIN_SLEEP_MS 10
+#define AGG_PERIOD_MIN_S  5       // Ventana de telemetría agregada (config "agg_s")
+#define AGG_PERIOD_MAX_S  3600
+#define RBE_HEARTBEAT_MAX_S 3600  // Máximo silencio configurable (config "hb_s")
+#define RBE_NVS_NS        "tlm"   // Bandas muertas en la partición de datos
+#define RBE_NVS_KEY       "rbe"
+
+// Períodos de lectura por sensor según el estado (entre conversiones, 0 = continuo)
+#define COIL_PERIOD_IDLE_MS  10000   // Compresor parado: no hay riesgo de hielo
+#define OUT_PERIOD_MS        30000   // Exterior: solo telemetría, cambia lento
+#define AMB_PERIOD_NEAR_MS   0       // Cerca del setpoint: cada lectura decide
+#define AMB_PERIOD_MID_MS    3000
+#define AMB_PERIOD_FAR_MS    10000   // Lejos del setpoint o sin termostato
+#define AMB_NEAR_C           1.5f    // Histéresis del termostato (±1°C) + margen
+#define AMB_MID_C            4.0f
+
+// Sensores de temperatura: rol, bus, resolución, CRC y dirección por defecto.
+// La tabla rol→ROM real vive en NVS (ac_sensors) y se reasigna por MQTT.
+// La cañería (protección hielo) va rápida, siempre con CRC y en su propio bus:
+// cada bus tiene su tarea, así una sonda en corto en ambiente/exterior no
+// deja ciega a la protección de hielo. El resto fino y en modo rápido.
+enum { SENSOR_AMB, SENSOR_OUT, SENSOR_COIL, SENSOR_COUNT };
+static const ac_sensor_def_t SENSOR_DEFS[SENSOR_COUNT] = {
+    [SENSOR_AMB]  = { "amb",  PIN_DS18B20_AMB,  12, false, { {0x28, 0xB5, 0x6C, 0x54, 0x00, 0x00, 0x00, 0x14} } }, // 0.0625°C en 750 ms
+    [SENSOR_OUT]  = { "out",  PIN_DS18B20_AMB,  12, false, { {0x28, 0xB9, 0x31, 0x55, 0x00, 0x00, 0x00, 0x9F} } },
+    [SENSOR_COIL] = { "coil", PIN_DS18B20_COIL, 10, true,  { {0x28, 0xF4, 0xD6, 0x57, 0x04, 0xE1, 0x3C, 0x1E} } }, // 0.25°C en 188 ms
+};
 
 // Mutex para proteger la variable sys
 static SemaphoreHandle_t xMutexSys = NULL;
 
 struct SystemState {
     float t_amb, t_out, t_coil;
-    float volt, amp, watt;
+    float volt, amp, watt, hz;
+    float va, var, pf;
+    ac_meter_harmonics_t harm; // Armónicos de la corriente del compresor
     
     // Configuración persistente (coincide con ac_storage.h)
     sys_config_t cfg; 
@@ -54,6 +83,14 @@ struct SystemState {
     bool comp_active, freeze_mode, protection_wait;
 } sys;
 
+// Ventana de telemetría en curso (protegida por xMutexSys, fuera de sys para
+// que las copias de la UI no la arrastren). El medidor aporta cada 200 ms y
+// los sensores en cada conversión.
+static tlm_agg_t s_agg;
+
+// Bandas muertas y heartbeat de la telemetría (protegidas por xMutexSys)
+static tlm_rbe_config_t s_rbe_cfg;
+
 int64_t last_comp_stop_time = - (SAFETY_DELAY_MIN * 60 * 1000000LL);
 
 // Variables para manejo del botón
@@ -61,19 +98,6 @@ static bool button_last_state = false;  // false = no presionado
 static int button_stable_count = 0;
 
 // --- AUXILIARES ---
-static esp_err_t i2c_master_init(void) {
-    i2c_config_t conf = {
-        .mode = I2C_MODE_MASTER,
-        .sda_io_num = PIN_I2C_SDA, 
-        .scl_io_num = PIN_I2C_SCL, 
-        .sda_pullup_en = GPIO_PULLUP_ENABLE,
-        .scl_pullup_en = GPIO_PULLUP_ENABLE,
-        .master.clk_speed = 10000, 
-    };
-    i2c_param_config(I2C_NUM_0, &conf);
-    return i2c_driver_install(I2C_NUM_0, conf.mode, 0, 0, 0);
-}
-
 bool is_safe_to_start() {
     int64_t now = esp_timer_get_time();
     int64_t safe_time = SAFETY_DELAY_MIN * 60 * 1000000LL;
@@ -83,6 +107,13 @@ bool is_safe_to_start() {
 }
 
 void set_relays(bool comp, int fan_speed) {
+    static bool comp_on = false;
+    // Flanco de encendido del compresor: capturar la corriente de arranque
+    if (comp && !comp_on) ac_meter_trigger_inrush();
+    comp_on = comp;
+    // Sin cargas el medidor reduce su ciclo de trabajo; cualquier cambio lo despierta
+    ac_meter_set_loads(comp || fan_speed > 0);
+
     gpio_set_level(PIN_COMPRESOR, comp ? 0 : 1);
     gpio_set_level(PIN_FAN_L, (fan_speed == 1) ? 0 : 1);
     gpio_set_level(PIN_FAN_M, (fan_speed == 2) ? 0 : 1);
@@ -118,6 +149,20 @@ void mqtt_data_handler(const char *topic, int topic_len, const char *data, int d
             cJSON *j_fan = cJSON_GetObjectItem(root, "fan");
             cJSON *j_sp = cJSON_GetObjectItem(root, "sp");
 
+            // Sensores: no tocan sys, se atienden fuera del mutex
+            cJSON *j_role = cJSON_GetObjectItem(root, "sensor_role");
+            cJSON *j_rom = cJSON_GetObjectItem(root, "rom");
+            if (cJSON_IsString(j_role) && cJSON_IsString(j_rom)) {
+                esp_err_t err = ac_sensors_assign(j_role->valuestring, j_rom->valuestring);
+                ESP_LOGI(TAG, "📡 Node-RED CMD: Sensor '%s' → %s (%s)",
+                    j_role->valuestring, j_rom->valuestring, esp_err_to_name(err));
+            }
+            cJSON *j_scan = cJSON_GetObjectItem(root, "sensor_scan");
+            if (j_scan && cJSON_IsTrue(j_scan)) {
+                ac_sensors_request_scan();
+                ESP_LOGI(TAG, "📡 Node-RED CMD: Escaneo de sensores");
+            }
+
             // 🛡️ ZONA SEGURA (MUTEX)
             if (xSemaphoreTake(xMutexSys, pdMS_TO_TICKS(200)) == pdTRUE) {
                 
@@ -154,6 +199,57 @@ void mqtt_data_handler(const char *topic, int topic_len, const char *data, int d
                     }
                 }
 
+                // Formato de los payloads de telemetría/estado ("json" / "cbor")
+                cJSON *j_fmt = cJSON_GetObjectItem(root, "fmt");
+                tlm_format_t fmt;
+                if (cJSON_IsString(j_fmt) && tlm_format_parse(j_fmt->valuestring, &fmt)) {
+                    sys.cfg.tlm_format = fmt;
+                    ESP_LOGI(TAG, "📡 Node-RED CMD: Formato de telemetría = %s", tlm_format_name(fmt));
+                }
+
+                // Ventana de telemetría agregada en segundos (0 = muestra suelta)
+                cJSON *j_agg = cJSON_GetObjectItem(root, "agg_s");
+                if (cJSON_IsNumber(j_agg)) {
+                    int agg = j_agg->valueint;
+                    if (agg == 0 || (agg >= AGG_PERIOD_MIN_S && agg <= AGG_PERIOD_MAX_S)) {
+                        sys.cfg.agg_period_s = agg;
+                        ESP_LOGI(TAG, "📡 Node-RED CMD: Ventana de telemetría = %ds", agg);
+                    }
+                }
+
+                // Bandas muertas por campo: {"db": {"amb": [abs, rel%], ...}}
+                bool rbe_changed = false;
+                cJSON *j_db = cJSON_GetObjectItem(root, "db");
+                cJSON *j_field;
+                if (cJSON_IsObject(j_db)) {
+                    cJSON_ArrayForEach(j_field, j_db) {
+                        int k = tlm_field_key(j_field->string);
+                        cJSON *j_abs = cJSON_GetArrayItem(j_field, 0);
+                        cJSON *j_rel = cJSON_GetArrayItem(j_field, 1);
+                        if (k >= 0 && cJSON_IsNumber(j_abs) && cJSON_IsNumber(j_rel) &&
+                            j_abs->valuedouble >= 0 && j_rel->valuedouble >= 0) {
+                            s_rbe_cfg.abs[k] = j_abs->valuedouble;
+                            s_rbe_cfg.rel[k] = j_rel->valuedouble;
+                            rbe_changed = true;
+                            ESP_LOGI(TAG, "📡 Node-RED CMD: Banda '%s' = %.3f / %.1f%%",
+                                j_field->string, s_rbe_cfg.abs[k], s_rbe_cfg.rel[k]);
+                        }
+                    }
+                }
+                cJSON *j_hb = cJSON_GetObjectItem(root, "hb_s");
+                if (cJSON_IsNumber(j_hb) && j_hb->valueint >= 0 && j_hb->valueint <= RBE_HEARTBEAT_MAX_S) {
+                    s_rbe_cfg.heartbeat_s = j_hb->valueint;
+                    rbe_changed = true;
+                    ESP_LOGI(TAG, "📡 Node-RED CMD: Heartbeat de telemetría = %ds", j_hb->valueint);
+                }
+                if (rbe_changed) storage_data_save(RBE_NVS_NS, RBE_NVS_KEY, &s_rbe_cfg, sizeof(s_rbe_cfg));
+
+                cJSON *j_ereset = cJSON_GetObjectItem(root, "energy_reset");
+                if (j_ereset && cJSON_IsTrue(j_ereset)) {
+                    ac_energy_reset_period();
+                    ESP_LOGI(TAG, "📡 Node-RED CMD: Reinicio de período de energía");
+                }
+
                 bool was_comp_active = sys.comp_active;
                 bool force_comp_off = (!sys.cfg.system_on) || (sys.cfg.mode != MODE_COOL);
                 if (force_comp_off) {
@@ -196,80 +292,41 @@ void mqtt_data_handler(const char *topic, int topic_len, const char *data, int d
 }
 
 // --- UI 20x4 ---
+// Solo arma los cuadros: el I2C (envío por diferencias, recuperación del bus)
+// lo hace el servicio de i2c_lcd, así esta tarea nunca se traba en el bus.
 void task_ui(void *pv) {
     char buffer[32];
     struct SystemState sys_copy = {0}; // Copia local para no trabar el sistema
+    i2c_lcd_frame_t frame;
     int64_t last_motion_time = -1;
-    int64_t last_lcd_reset = -1;
-    int64_t lcd_bus_block_until = 0;
-    uint32_t lcd_bus_backoff_ms = LCD_BUS_RECOVERY_BASE_MS;
     bool backlight_on = false;
 
-    i2c_master_init();
-    i2c_lcd_init(I2C_lcd_addr);
-    i2c_lcd_set_backlight(false);
-    i2c_lcd_clear();
-    i2c_lcd_write_text(0, 0, "   GADD CLIMA v7.0  ");
+    i2c_lcd_start(PIN_I2C_SDA, PIN_I2C_SCL, I2C_lcd_addr);
+    i2c_lcd_frame_clear(&frame);
+    i2c_lcd_frame_write(&frame, 0, 0, "   GADD CLIMA v7.0  ");
+    frame.backlight = true;   // Con el backlight apagado el servicio no dibuja
+    i2c_lcd_submit(&frame);
     vTaskDelay(pdMS_TO_TICKS(1500));
-    i2c_lcd_clear();
-    last_lcd_reset = esp_timer_get_time();
 
     while(1) {
         int64_t now = esp_timer_get_time();
         bool motion = gpio_get_level(PIN_PIR) == 1;
         if (motion) {
             last_motion_time = now;
-            if (!backlight_on) {
-                i2c_lcd_reinit();
-                backlight_on = true;
-                i2c_lcd_set_backlight(true);
-                last_lcd_reset = now;
-            }
+            backlight_on = true;
         } else if (backlight_on && last_motion_time >= 0) {
             int64_t elapsed_ms = (now - last_motion_time) / 1000;
-            if (elapsed_ms > PIR_LCD_TIMEOUT_MS) {
-                backlight_on = false;
-                i2c_lcd_set_backlight(false);
-            }
+            if (elapsed_ms > PIR_LCD_TIMEOUT_MS) backlight_on = false;
         }
 
-        bool lcd_ok = (i2c_lcd_is_alive() == ESP_OK);
-        if (!lcd_ok) {
-            if (now >= lcd_bus_block_until) {
-                ESP_LOGW(TAG, "LCD bus recovery");
-                i2c_driver_delete(I2C_NUM_0);
-                vTaskDelay(pdMS_TO_TICKS(100));
-                i2c_master_init();
-                i2c_lcd_init(I2C_lcd_addr);
-                if (!backlight_on) {
-                    i2c_lcd_set_backlight(false);
-                }
-                last_lcd_reset = now;
-                if (lcd_bus_backoff_ms < LCD_BUS_RECOVERY_MAX_MS) {
-                    lcd_bus_backoff_ms *= 2;
-                    if (lcd_bus_backoff_ms > LCD_BUS_RECOVERY_MAX_MS) {
-                        lcd_bus_backoff_ms = LCD_BUS_RECOVERY_MAX_MS;
-                    }
-                }
-                lcd_bus_block_until = now + (int64_t)lcd_bus_backoff_ms * 1000;
-            }
-            vTaskDelay(pdMS_TO_TICKS(200));
+        // Con el backlight apagado no se arma el cuadro (el servicio tampoco dibuja)
+        frame.backlight = backlight_on;
+        if (!backlight_on) {
+            i2c_lcd_submit(&frame);
+            vTaskDelay(pdMS_TO_TICKS(1000));
             continue;
         }
 
-        if (lcd_bus_backoff_ms != LCD_BUS_RECOVERY_BASE_MS) {
-            lcd_bus_backoff_ms = LCD_BUS_RECOVERY_BASE_MS;
-            lcd_bus_block_until = 0;
-        }
-
-        if (backlight_on && last_lcd_reset >= 0) {
-            int64_t reset_elapsed_ms = (now - last_lcd_reset) / 1000;
-            if (reset_elapsed_ms > LCD_FORCE_REINIT_MS) {
-                i2c_lcd_reinit();
-                last_lcd_reset = now;
-            }
-        }
-
         // 📸 FOTO INSTANTÁNEA DE LOS DATOS (Thread-Safe)
         if (xSemaphoreTake(xMutexSys, pdMS_TO_TICKS(100)) == pdTRUE) {
             memcpy(&sys_copy, &sys, sizeof(struct SystemState));
@@ -279,68 +336,144 @@ void task_ui(void *pv) {
         int wifi_state = get_wifi_status();
         bool mqtt_ok = mqtt_app_is_connected(); 
 
+        // Se arma el cuadro; al LCD van solo las celdas que cambian
+        i2c_lcd_frame_clear(&frame);
+
         // Renglón 0
-        if (sys_copy.freeze_mode) i2c_lcd_write_text(0, 0, "ALERTA: CONGELADO!  ");
+        if (sys_copy.freeze_mode) i2c_lcd_frame_write(&frame, 0, 0, "ALERTA: CONGELADO!  ");
         else if (sys_copy.protection_wait) {
              int wait = (SAFETY_DELAY_MIN * 60) - ((esp_timer_get_time() - last_comp_stop_time) / 1000000);
              if (wait < 0) wait = 0;
              snprintf(buffer, 32, "ESPERA: %ds          ", wait);
-             i2c_lcd_write_text(0, 0, buffer);
+             i2c_lcd_frame_write(&frame, 0, 0, buffer);
         } else if (sys_copy.cfg.system_on) {
              if (sys_copy.cfg.mode == MODE_FAN) {
                  snprintf(buffer, 32, "VENT FAN:%d          ", sys_copy.cfg.fan_speed);
              } else {
                  snprintf(buffer, 32, "FRIO:%s FAN:%d SP:%.0f", sys_copy.comp_active?"ON ":"OFF", sys_copy.cfg.fan_speed, sys_copy.cfg.setpoint);
              }
-             i2c_lcd_write_text(0, 0, buffer);
-        } else i2c_lcd_write_text(0, 0, "SISTEMA APAGADO     ");
+             i2c_lcd_frame_write(&frame, 0, 0, buffer);
+        } else i2c_lcd_frame_write(&frame, 0, 0, "SISTEMA APAGADO     ");
 
         // Renglón 1
         snprintf(buffer, 32, "Amb:%.1f  Coil:%.1f ", sys_copy.t_amb, sys_copy.t_coil);
-        i2c_lcd_write_text(1, 0, buffer);
+        i2c_lcd_frame_write(&frame, 1, 0, buffer);
 
         // Renglón 2
         snprintf(buffer, 32, "%.1fV %.1fA %.0fW    ", sys_copy.volt, sys_copy.amp, sys_copy.watt);
-        i2c_lcd_write_text(2, 0, buffer);
+        i2c_lcd_frame_write(&frame, 2, 0, buffer);
 
         // Renglón 3
+        ac_energy_t energy;
+        ac_energy_get(&energy);
         char w = (wifi_state==1)?'*':'!'; if(wifi_state==2) w='C';
-        snprintf(buffer, 32, "WiFi:%c MQTT:%c OK    ", w, mqtt_ok?'M':' ');
-        i2c_lcd_write_text(3, 0, buffer);
+        snprintf(buffer, 32, "W:%c M:%c E:%6.1fkWh ", w, mqtt_ok?'M':' ', energy.total_kwh);
+        i2c_lcd_frame_write(&frame, 3, 0, buffer);
+
+        i2c_lcd_submit(&frame);   // Nunca bloquea
 
         vTaskDelay(pdMS_TO_TICKS(1000));
     }
 }
 
+// Ventana de alarma de la cañería según el estado: fuera de modo hielo
+// alarma al bajar de FREEZE_LIMIT_C, en modo hielo al superar FREEZE_RESET_C.
+// El sensor compara la parte entera (nunca se pierde un cruce, puede avisar
+// antes); la lectura completa que dispara confirma con el valor real.
+static void coil_alarm_arm(bool freeze_mode) {
+    if (freeze_mode) ac_sensors_set_alarm(SENSOR_COIL, INT8_MIN, (int8_t)floor(FREEZE_RESET_C));
+    else ac_sensors_set_alarm(SENSOR_COIL, (int8_t)ceil(FREEZE_LIMIT_C) - 1, INT8_MAX);
+}
+
+// Totales de las colas del publicador MQTT: contadores sumados; profundidad
+// máxima, tiempos máximos y espera media, los de la peor clase
+static void mqtt_pub_totals(mqtt_pub_stats_t *t) {
+    memset(t, 0, sizeof(*t));
+    for (int c = 0; c < MQTT_PUB_CLASS_COUNT; c++) {
+        mqtt_pub_stats_t s;
+        mqtt_app_get_stats((mqtt_pub_class_t)c, &s);
+        t->depth += s.depth;
+        t->capacity += s.capacity;
+        t->enqueued += s.enqueued;
+        t->dropped += s.dropped;
+        t->sent += s.sent;
+        t->failed += s.failed;
+        if (s.depth_max > t->depth_max) t->depth_max = s.depth_max;
+        if (s.enqueue_max_us > t->enqueue_max_us) t->enqueue_max_us = s.enqueue_max_us;
+        if (s.wait_max_us > t->wait_max_us) t->wait_max_us = s.wait_max_us;
+        if (s.wait_avg_us > t->wait_avg_us) t->wait_avg_us = s.wait_avg_us;
+    }
+}
+
+// Cada sensor se lee al ritmo que el estado justifica: la cañería rápido con
+// el compresor andando, el exterior lento y el ambiente según cuán cerca está
+// del punto donde el termostato conmuta. Llamar con xMutexSys tomado.
+static void sensor_periods_update(void) {
+    ac_sensors_set_period(SENSOR_COIL, (sys.comp_active || sys.freeze_mode) ? 0 : COIL_PERIOD_IDLE_MS);
+    ac_sensors_set_period(SENSOR_OUT, OUT_PERIOD_MS);
+
+    uint32_t amb = AMB_PERIOD_FAR_MS;
+    if (sys.cfg.system_on && sys.cfg.mode == MODE_COOL) {
+        float dist = fabsf(sys.t_amb - sys.cfg.setpoint);
+        if (dist < AMB_NEAR_C) amb = AMB_PERIOD_NEAR_MS;
+        else if (dist < AMB_MID_C) amb = AMB_PERIOD_MID_MS;
+    }
+    ac_sensors_set_period(SENSOR_AMB, amb);
+}
+
 // --- CLIMA + MQTT ---
 void task_climate(void *pv) {
-    ds18b20_init_bus(PIN_ONEWIRE);
+    ac_sensors_init(SENSOR_DEFS, SENSOR_COUNT);
+    bool alarm_freeze = false;
+    coil_alarm_arm(alarm_freeze);
     esp_task_wdt_add(NULL);
-    char json[120];       // JSON telemetría (solo sensores)
-    char estado_json[150]; // JSON estado (config actual)
+    tlm_telemetry_t tlm = {0};  // Muestra de telemetría (solo sensores)
+    tlm_status_t estado = {0};  // Estado (config actual)
+    tlm_format_t fmt = TLM_FMT_JSON;
+    bool agg_on = false;        // Telemetría por ventana en lugar de muestra suelta
+    tlm_rbe_t rbe = {0};        // Por excepción: última telemetría publicada
+    tlm_rbe_config_t rbe_cfg;
+    tlm_status_t estado_pub;    // Último estado publicado (retenido)
+    bool estado_sent = false;   // false = publicar el estado en la próxima vuelta
+    uint32_t estado_pubs = 0, estado_sup = 0;
+    bool was_connected = false;
+    char diag_json[256];        // JSON contadores de publicación
+    uint8_t payload[256];       // Telemetría o estado codificados (JSON o CBOR)
+    static tlm_agg_t window;    // Ventana cerrada, se codifica fuera del mutex
+    static uint8_t window_buf[512];
+    uint32_t window_s = 0;      // Duración de la ventana cerrada (0 = nada que publicar)
+    int64_t last_window = esp_timer_get_time();
+    char energia_json[160]; // JSON energía acumulada
+    char arranque_json[128]; // JSON evento de arranque del compresor
+    ac_meter_inrush_t inrush_ev;  // Arranque tomado del medidor
+    bool inrush_pending = false;  // inrush_ev todavía no entró en la cola
+    char sensores_json[512]; // JSON tabla de sensores
     bool payload_ready = false;
-
-    json[0] = '\0';
-    estado_json[0] = '\0';
+    int64_t last_energy_pub = 0;
+    int64_t last_backlog_store = 0;
+    int64_t last_report = esp_timer_get_time(); // Primer reporte con las conversiones ya hechas
 
     while(1) {
-        // 1. Lectura Sensores (Lenta, afuera del mutex)
-        if (ds18b20_convert_all(PIN_ONEWIRE) == ESP_OK) {
-            float ta=0, to=0, tc=0;
-            bool ok_amb = false;
-            bool ok_out = false;
-            bool ok_coil = false;
-
-            vTaskDelay(pdMS_TO_TICKS(750));
-            ok_amb = (ds18b20_read_one(PIN_ONEWIRE, ID_AMB, &ta) == ESP_OK);
-            ok_out = (ds18b20_read_one(PIN_ONEWIRE, ID_OUT, &to) == ESP_OK);
-            ok_coil = (ds18b20_read_one(PIN_ONEWIRE, ID_COIL, &tc) == ESP_OK);
+        // 1. Lectura Sensores (afuera del mutex): cada uno convierte a su ritmo
+        //    y se lee apenas termina, sin bloquear el lazo
+        float temps[SENSOR_COUNT];
+        uint32_t fresh = ac_sensors_poll(temps);
+        bool ok_amb = fresh & (1u << SENSOR_AMB);
+        bool ok_out = fresh & (1u << SENSOR_OUT);
+        bool ok_coil = fresh & (1u << SENSOR_COIL);
 
+        int64_t now = esp_timer_get_time();
+        bool report_due = (now - last_report) >= (int64_t)CLIMATE_REPORT_MS * 1000;
+
+        if (ok_amb || ok_out || ok_coil || report_due) {
             // 2. Lógica de Control (Rápida, con Mutex)
             if (xSemaphoreTake(xMutexSys, pdMS_TO_TICKS(500)) == pdTRUE) {
-                if (ok_amb) sys.t_amb = ta;
-                if (ok_out) sys.t_out = to;
-                if (ok_coil) sys.t_coil = tc;
+                if (ok_amb) sys.t_amb = temps[SENSOR_AMB];
+                if (ok_out) sys.t_out = temps[SENSOR_OUT];
+                if (ok_coil) sys.t_coil = temps[SENSOR_COIL];
+                if (ok_amb) tlm_agg_add(&s_agg, TLM_KEY_AMB, sys.t_amb);
+                if (ok_out) tlm_agg_add(&s_agg, TLM_KEY_OUT, sys.t_out);
+                if (ok_coil) tlm_agg_add(&s_agg, TLM_KEY_COIL, sys.t_coil);
                 bool was_comp_active = sys.comp_active;
 
                 // Lógica de termostato y protecciones
@@ -383,57 +516,239 @@ void task_climate(void *pv) {
                     set_relays(false, 0);
                     sys.protection_wait = false;
                 }
+
+                // La alarma del sensor de cañería sigue al modo hielo
+                if (sys.freeze_mode != alarm_freeze) {
+                    alarm_freeze = sys.freeze_mode;
+                    coil_alarm_arm(alarm_freeze);
+                }
+                sensor_periods_update();
                 
                 // Actualizar LEDs según estado del sistema
                 power_control_update_leds(sys.cfg.system_on);
                 
-                // JSON de telemetría (SOLO sensores - datos de medición)
-                snprintf(json, sizeof(json), 
-                    "{\"v\":%.1f,\"a\":%.2f,\"amb\":%.2f,\"out\":%.2f,\"coil\":%.2f}", 
-                    sys.volt, sys.amp, sys.t_amb, sys.t_out, sys.t_coil);
-                
-                // JSON de estado (configuración actual del sistema)
-                snprintf(estado_json, sizeof(estado_json),
-                    "{\"sys_on\":%s,\"comp\":%d,\"fan\":%d,\"mode\":%d,\"sp\":%.1f}",
-                    sys.cfg.system_on ? "true" : "false",
-                    sys.comp_active,
-                    sys.cfg.fan_speed,
-                    sys.cfg.mode,
-                    sys.cfg.setpoint);
-                payload_ready = true;
+                if (report_due) {
+                    last_report = now;
+
+                    // Foto de telemetría (SOLO sensores) y estado: se codifican
+                    // fuera del mutex, en el formato configurado
+                    tlm = (tlm_telemetry_t){
+                        .v = sys.volt, .a = sys.amp, .w = sys.watt, .va = sys.va,
+                        .var = sys.var, .pf = sys.pf, .hz = sys.hz,
+                        .thd = sys.harm.thd, .h3 = sys.harm.h3, .h5 = sys.harm.h5, .h7 = sys.harm.h7,
+                        .amb = sys.t_amb, .out = sys.t_out, .coil = sys.t_coil,
+                    };
+                    estado = (tlm_status_t){
+                        .sys_on = sys.cfg.system_on, .comp = sys.comp_active,
+                        .fan = sys.cfg.fan_speed, .mode = sys.cfg.mode, .sp = sys.cfg.setpoint,
+                    };
+                    fmt = (tlm_format_t)sys.cfg.tlm_format;
+                    agg_on = sys.cfg.agg_period_s != 0;
+                    rbe_cfg = s_rbe_cfg;
+                    payload_ready = true;
                 
-                // 📊 LOG COMPLETO DEL SISTEMA
-                const char *mode_names[] = {"OFF", "FRIO", "VENTILACION"};
-                ESP_LOGI(TAG, "═══════════════════════════════════════════════════════════");
-                ESP_LOGI(TAG, "⚡ Tensión: %.1fV | Intensidad: %.2fA | Potencia: %.0fW", sys.volt, sys.amp, sys.watt);
-                ESP_LOGI(TAG, "🌡️  T.Ambiente: %.1f°C | T.Cañería: %.1f°C | T.Exterior: %.1f°C", sys.t_amb, sys.t_coil, sys.t_out);
-                ESP_LOGI(TAG, "🎯 Modo: %s | Objetivo: %.1f°C | Fan: %d | Compresor: %s", 
-                    mode_names[sys.cfg.mode], sys.cfg.setpoint, sys.cfg.fan_speed, sys.comp_active?"ON":"OFF");
-                ESP_LOGI(TAG, "═══════════════════════════════════════════════════════════");
+                    // 📊 LOG COMPLETO DEL SISTEMA
+                    const char *mode_names[] = {"OFF", "FRIO", "VENTILACION"};
+                    ESP_LOGI(TAG, "═══════════════════════════════════════════════════════════");
+                    ESP_LOGI(TAG, "⚡ Tensión: %.1fV | Intensidad: %.2fA | Potencia: %.0fW | Red: %.2fHz", sys.volt, sys.amp, sys.watt, sys.hz);
+                    ESP_LOGI(TAG, "⚡ Aparente: %.0fVA | Reactiva: %.0fVAR | FP: %.2f", sys.va, sys.var, sys.pf);
+                    ESP_LOGI(TAG, "〰️  THD I: %.1f%% | H3: %.1f%% | H5: %.1f%% | H7: %.1f%%",
+                        sys.harm.thd, sys.harm.h3, sys.harm.h5, sys.harm.h7);
+                    ESP_LOGI(TAG, "🌡️  T.Ambiente: %.1f°C | T.Cañería: %.1f°C | T.Exterior: %.1f°C", sys.t_amb, sys.t_coil, sys.t_out);
+                    ds18b20_stats_t ow;
+                    ds18b20_get_stats(&ow);
+                    ESP_LOGI(TAG, "🧵 OneWire: IRQ off máx %luus | Lecturas: %lu | Reintentos: %lu | CRC: %lu | Fallas: %lu",
+                        (unsigned long)ds18b20_irq_off_max_us(), (unsigned long)ow.reads,
+                        (unsigned long)ow.retries, (unsigned long)ow.crc_errors, (unsigned long)ow.failures);
+                    tlm_backlog_stats_t bl;
+                    tlm_backlog_get_stats(&bl);
+                    ESP_LOGI(TAG, "💾 Backlog: %lu/%lu | Guardados: %lu | Reenviados: %lu | Perdidos: %lu | Errores flash: %lu",
+                        (unsigned long)bl.count, (unsigned long)bl.capacity, (unsigned long)bl.stored,
+                        (unsigned long)bl.replayed, (unsigned long)bl.dropped, (unsigned long)bl.errors);
+                    ESP_LOGI(TAG, "📉 Por excepción: telemetría %lu enviadas / %lu suprimidas | estado %lu / %lu",
+                        (unsigned long)rbe.sent, (unsigned long)rbe.suppressed,
+                        (unsigned long)estado_pubs, (unsigned long)estado_sup);
+                    mqtt_pub_stats_t q;
+                    mqtt_pub_totals(&q);
+                    ESP_LOGI(TAG, "📮 Cola MQTT: %lu/%lu (máx %lu) | Enviados: %lu | Descartados: %lu | Fallidos: %lu | Encolar máx %luus | Espera máx %lums",
+                        (unsigned long)q.depth, (unsigned long)q.capacity, (unsigned long)q.depth_max,
+                        (unsigned long)q.sent, (unsigned long)q.dropped, (unsigned long)q.failed,
+                        (unsigned long)q.enqueue_max_us, (unsigned long)(q.wait_max_us / 1000));
+                    ESP_LOGI(TAG, "🎯 Modo: %s | Objetivo: %.1f°C | Fan: %d | Compresor: %s", 
+                        mode_names[sys.cfg.mode], sys.cfg.setpoint, sys.cfg.fan_speed, sys.comp_active?"ON":"OFF");
+                    ESP_LOGI(TAG, "═══════════════════════════════════════════════════════════");
+                }
+
+                // Cierre de la ventana agregada (sin agregación se vacía en
+                // cada reporte para no acumular de más)
+                int64_t agg_us = (int64_t)sys.cfg.agg_period_s * 1000000;
+                if (agg_us ? (now - last_window) >= agg_us : report_due) {
+                    if (agg_us) {
+                        window = s_agg;
+                        window_s = (uint32_t)((now - last_window + 500000) / 1000000);
+                    }
+                    tlm_agg_reset(&s_agg);
+                    last_window = now;
+                }
                 
                 xSemaphoreGive(xMutexSys); // 🔓
             }
         }
 
-        // 3. Enviar Telemetría (sensores) y Estado (config) por separado
-        if (payload_ready && mqtt_app_is_connected()) {
-            mqtt_app_publish(MQTT_TOPIC_TELEMETRY, json);   // Solo sensores
-            mqtt_app_publish(MQTT_TOPIC_STATUS, estado_json); // Config actual
+        // 3. Enviar Telemetría (sensores) y Estado (config) por separado.
+        //    Sin broker la telemetría se fecha y se guarda en flash (espaciada,
+        //    compacta): el reenvío la publica en JSON con el campo "ts"
+        //    Con agregación la telemetría sale una vez por ventana (min/max/
+        //    media/último) en lugar de una muestra por reporte; sin broker la
+        //    ventana entera va a flash en lugar de las muestras espaciadas
+        //    Por excepción: la telemetría sale si algún campo salió de su banda
+        //    muerta o venció el heartbeat; el estado (retenido) solo si cambió.
+        //    Al reconectar salen los dos para dejar una base nueva en el broker
+        bool connected = mqtt_app_is_connected();
+        if (connected && !was_connected) {
+            tlm_rbe_reset(&rbe);
+            estado_sent = false;
+        }
+        was_connected = connected;
+
+        if (window_s && connected) {
+            size_t n = tlm_encode_window(fmt, &window, window_s, window_buf, sizeof(window_buf));
+            if (n) mqtt_app_publish_bin(MQTT_TOPIC_TELEMETRY_WINDOW, window_buf, n);
+        } else if (window_s) {
+            tlm_backlog_push_window(&window, window_s);   // Sin broker: la ventana entera a flash
+        }
+        window_s = 0;
+        if (report_due && payload_ready && connected) {
+            size_t n = 0;
+            if (!agg_on && tlm_rbe_check(&rbe, &rbe_cfg, &tlm, now)) {
+                n = tlm_encode_telemetry(fmt, &tlm, payload, sizeof(payload));
+            }
+            // Solo sensores. La base cambia recién si la cola aceptó el
+            // mensaje; si no, la muestra se vuelve a evaluar en el próximo
+            if (n && mqtt_app_publish_bin(MQTT_TOPIC_TELEMETRY, payload, n)) {
+                tlm_rbe_commit(&rbe, &tlm, now);
+            }
+
+            if (!estado_sent || !tlm_status_equal(&estado, &estado_pub)) {
+                n = tlm_encode_status(fmt, &estado, payload, sizeof(payload));
+                if (n && mqtt_app_publish_retained(MQTT_TOPIC_STATUS, payload, n)) {  // Config actual
+                    estado_pub = estado;
+                    estado_sent = true;
+                    estado_pubs++;
+                }
+            } else {
+                estado_sup++;
+            }
+        } else if (!agg_on && report_due && payload_ready &&
+                   (now - last_backlog_store) >= (int64_t)BACKLOG_STORE_MS * 1000) {
+            tlm_backlog_push_telemetry(&tlm);
+            last_backlog_store = now;
+        }
+
+        // 4. Energía acumulada (cambia lento: una vez por minuto)
+        if (mqtt_app_is_connected() && (now - last_energy_pub) >= (int64_t)ENERGY_PUBLISH_MS * 1000) {
+            ac_energy_t e;
+            ac_energy_get(&e);
+            snprintf(energia_json, sizeof(energia_json),
+                "{\"kwh\":%.3f,\"kwh_on\":%.3f,\"kwh_off\":%.3f,"
+                "\"p_kwh\":%.3f,\"p_on\":%.3f,\"p_off\":%.3f}",
+                e.total_kwh, e.total_on_kwh, e.total_off_kwh,
+                e.period_kwh, e.period_on_kwh, e.period_off_kwh);
+            mqtt_app_publish(MQTT_TOPIC_ENERGY, energia_json);
+
+            // Contadores de publicación por excepción (ahorro de mensajes) y
+            // de la cola del publicador
+            mqtt_pub_stats_t q;
+            mqtt_pub_totals(&q);
+            snprintf(diag_json, sizeof(diag_json),
+                "{\"tlm_pub\":%lu,\"tlm_sup\":%lu,\"st_pub\":%lu,\"st_sup\":%lu,"
+                "\"q_max\":%lu,\"q_drop\":%lu,\"q_fail\":%lu,\"enq_max_us\":%lu,"
+                "\"wait_max_ms\":%lu,\"wait_avg_ms\":%lu,\"adc_ok\":%d}",
+                (unsigned long)rbe.sent, (unsigned long)rbe.suppressed,
+                (unsigned long)estado_pubs, (unsigned long)estado_sup,
+                (unsigned long)q.depth_max, (unsigned long)q.dropped, (unsigned long)q.failed,
+                (unsigned long)q.enqueue_max_us, (unsigned long)(q.wait_max_us / 1000),
+                (unsigned long)(q.wait_avg_us / 1000), ac_meter_is_ok() ? 1 : 0);
+            mqtt_app_publish(MQTT_TOPIC_DIAG, diag_json);
+            last_energy_pub = now;
+        }
+
+        // 5. Arranque del compresor (un evento por encendido). El evento se
+        //    toma del medidor una vez y se guarda hasta que entra en la cola
+        //    de alarmas: sin broker o con la cola llena se reintenta.
+        if (!inrush_pending && ac_meter_get_inrush(&inrush_ev)) {
+            inrush_pending = true;
+            ESP_LOGI(TAG, "🚀 Arranque compresor: pico %.1fA | %.1fA RMS máx | régimen %.2fA en %lums | I²t %.1fA²s",
+                inrush_ev.peak_a, inrush_ev.peak_rms_a, inrush_ev.steady_a,
+                (unsigned long)inrush_ev.settle_ms, inrush_ev.i2t);
+        }
+        if (inrush_pending && mqtt_app_is_connected()) {
+            // Tras el reposo el ADC venía detenido: sin carga previa medida
+            char pre[12] = "null";
+            if (inrush_ev.pre_valid) snprintf(pre, sizeof(pre), "%.2f", inrush_ev.pre_a);
+            snprintf(arranque_json, sizeof(arranque_json),
+                "{\"pk\":%.1f,\"pk_rms\":%.1f,\"ss\":%.2f,\"pre\":%s,"
+                "\"settle_ms\":%lu,\"i2t\":%.1f}",
+                inrush_ev.peak_a, inrush_ev.peak_rms_a, inrush_ev.steady_a, pre,
+                (unsigned long)inrush_ev.settle_ms, inrush_ev.i2t);
+            if (mqtt_app_enqueue(MQTT_PUB_ALARM, MQTT_TOPIC_INRUSH, arranque_json,
+                                 strlen(arranque_json), false)) {
+                inrush_pending = false;
+            }
         }
         
+        // 6. Tabla de sensores (al arrancar, tras un escaneo o una reasignación)
+        if (mqtt_app_is_connected() && ac_sensors_take_report(sensores_json, sizeof(sensores_json))) {
+            if (!mqtt_app_enqueue(MQTT_PUB_STATUS, MQTT_TOPIC_SENSORS, sensores_json,
+                                  strlen(sensores_json), false)) {
+                ac_sensors_report_failed();   // Cola llena o broker caído: otra vuelta
+            }
+        }
+
+        // 7. Reenvío del backlog: un lote chico por segundo, después de lo en vivo
+        tlm_backlog_service();
+
+        // 8. Esperar una lectura nueva de cualquier bus o el próximo reporte
+        uint32_t sleep_ms = CLIMATE_REPORT_MS - (uint32_t)((esp_timer_get_time() - last_report) / 1000);
+        if (sleep_ms > CLIMATE_REPORT_MS) sleep_ms = 0;
+        if (sleep_ms < CLIMATE_MIN_SLEEP_MS) sleep_ms = CLIMATE_MIN_SLEEP_MS;
+
         esp_task_wdt_reset();
-        vTaskDelay(pdMS_TO_TICKS(1000));
+        ac_sensors_wait(sleep_ms);
     }
 }
 
 void task_meter(void *pv) {
-    float v, i, w;
+    ac_meter_reading_t r;
+    ac_meter_harmonics_t harm;
+    bool comp_on = false;
     while(1) {
-        ac_meter_read_rms(&v, &i, &w);
+        ac_meter_get_reading(&r);
+        ac_meter_get_harmonics(&harm);
         if (xSemaphoreTake(xMutexSys, pdMS_TO_TICKS(50)) == pdTRUE) {
-            sys.volt = v; sys.amp = i; sys.watt = w;
+            sys.volt = r.v; sys.amp = r.i; sys.watt = r.w; sys.hz = r.hz;
+            sys.va = r.va; sys.var = r.var; sys.pf = r.pf;
+            sys.harm = harm;
+            comp_on = sys.comp_active;
+
+            // Ventana agregada: los picos de corriente se ven a 200 ms
+            tlm_agg_add(&s_agg, TLM_KEY_V, r.v);
+            tlm_agg_add(&s_agg, TLM_KEY_A, r.i);
+            tlm_agg_add(&s_agg, TLM_KEY_W, r.w);
+            tlm_agg_add(&s_agg, TLM_KEY_VA, r.va);
+            tlm_agg_add(&s_agg, TLM_KEY_VAR, r.var);
+            tlm_agg_add(&s_agg, TLM_KEY_PF, r.pf);
+            tlm_agg_add(&s_agg, TLM_KEY_HZ, r.hz);
+            if (harm.valid) {
+                tlm_agg_add(&s_agg, TLM_KEY_THD, harm.thd);
+                tlm_agg_add(&s_agg, TLM_KEY_H3, harm.h3);
+                tlm_agg_add(&s_agg, TLM_KEY_H5, harm.h5);
+                tlm_agg_add(&s_agg, TLM_KEY_H7, harm.h7);
+            }
             xSemaphoreGive(xMutexSys);
         }
+        // Integración de energía (checkpoint a flash espaciado, no en cada muestra)
+        ac_energy_add(r.w, comp_on, esp_timer_get_time());
         vTaskDelay(pdMS_TO_TICKS(200));
     }
 }
@@ -518,6 +833,10 @@ void app_main(void) {
     gpio_install_isr_service(0);
     ac_meter_init(PIN_ZMPT, PIN_SCT);
     storage_init(); // Iniciar sistema de guardado
+    ac_energy_init(); // Restaurar contadores de energía
+    if (!storage_data_load(RBE_NVS_NS, RBE_NVS_KEY, &s_rbe_cfg, sizeof(s_rbe_cfg))) {
+        tlm_rbe_defaults(&s_rbe_cfg); // Bandas muertas por defecto
+    }
 
     gpio_reset_pin(PIN_COMPRESOR); gpio_set_direction(PIN_COMPRESOR, GPIO_MODE_OUTPUT);
     gpio_reset_pin(PIN_FAN_L); gpio_set_direction(PIN_FAN_L, GPIO_MODE_OUTPUT);
@@ -542,9 +861,13 @@ void app_main(void) {
     if (sys.cfg.fan_speed < 0 || sys.cfg.fan_speed > 3) sys.cfg.fan_speed = 1;
     if (sys.cfg.setpoint < 16.0 || sys.cfg.setpoint > 30.0) sys.cfg.setpoint = 24.0;
     if (sys.cfg.mode < MODE_OFF || sys.cfg.mode > MODE_FAN) sys.cfg.mode = MODE_COOL;
+    if (sys.cfg.tlm_format != TLM_FMT_CBOR) sys.cfg.tlm_format = TLM_FMT_JSON;
+    if (sys.cfg.agg_period_s != 0 &&
+        (sys.cfg.agg_period_s < AGG_PERIOD_MIN_S || sys.cfg.agg_period_s > AGG_PERIOD_MAX_S)) sys.cfg.agg_period_s = 0;
     sys.t_amb = 25.0; sys.t_coil = 20.0; sys.t_out = 20.0;
 
     wifi_portal_init(); 
+    tlm_backlog_init(); // Backlog de telemetría (necesita red para SNTP)
     
     // 4. Configurar MQTT con el Callback (EL ESLABÓN PERDIDO)
     mqtt_app_set_rx_callback(mqtt_data_handler); 
@@ -553,7 +876,7 @@ void app_main(void) {
     esp_task_wdt_config_t wdt_conf = { .timeout_ms = WDT_TIMEOUT_MS, .trigger_panic = true };
     if (esp_task_wdt_status(NULL) != ESP_OK) esp_task_wdt_init(&wdt_conf);
     
-    xTaskCreate(task_climate, "Climate", 4096, NULL, 5, NULL);
+    xTaskCreate(task_climate, "Climate", 5120, NULL, 5, NULL);
     xTaskCreate(task_meter, "Meter", 4096, NULL, 3, NULL);
     xTaskCreate(task_ui, "UI", 4096, NULL, 2, NULL);
     xTaskCreate(task_power_button, "PowerBtn", 2048, NULL, 4, NULL); // 🔘 Tarea del botón